@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core
+QT       += core network serialport
 
 QT       -= gui
 
@@ -23,7 +23,34 @@ INCLUDEPATH += C:\Users\Christian\Documents\GitHub\Qt\DynamixelControl
 
 SOURCES += main.cpp \
     sensorcontrol.cpp \
-    actuatorcontrol.cpp
+    actuatorcontrol.cpp \
+    dynamixelbus.cpp \
+    busarbiter.cpp \
+    devicehealth.cpp \
+    soundsampler.cpp \
+    statepoller.cpp \
+    fleetprovisioner.cpp \
+    asyncbus.cpp \
+    kinematicchain.cpp \
+    inversekinematics.cpp \
+    poseestimator.cpp \
+    wheelodometry.cpp \
+    jointcontroller.cpp \
+    collisiondetector.cpp \
+    sharedtelemetry.cpp \
+    busdaemon.cpp \
+    busclient.cpp \
+    packetcache.cpp \
+    statuspacketparser.cpp \
+    serialtransport.cpp \
+    busengine.cpp \
+    telemetrystore.cpp \
+    telemetrycodec.cpp \
+    safetywatchdog.cpp \
+    busdriver.cpp \
+    telemetrypublisher.cpp \
+    buscapture.cpp \
+    bustrafficanalyzer.cpp
 
 OTHER_FILES += \
     dynamixel.lib \
@@ -34,4 +61,31 @@ OTHER_FILES += \
 HEADERS += \
     dynamixel_control.h \
     sensorcontrol.h \
-    actuatorcontrol.h
+    actuatorcontrol.h \
+    dynamixelbus.h \
+    busarbiter.h \
+    devicehealth.h \
+    soundsampler.h \
+    statepoller.h \
+    fleetprovisioner.h \
+    asyncbus.h \
+    kinematicchain.h \
+    inversekinematics.h \
+    poseestimator.h \
+    wheelodometry.h \
+    jointcontroller.h \
+    collisiondetector.h \
+    sharedtelemetry.h \
+    busdaemon.h \
+    busclient.h \
+    packetcache.h \
+    statuspacketparser.h \
+    serialtransport.h \
+    busengine.h \
+    telemetrystore.h \
+    telemetrycodec.h \
+    safetywatchdog.h \
+    busdriver.h \
+    telemetrypublisher.h \
+    buscapture.h \
+    bustrafficanalyzer.h
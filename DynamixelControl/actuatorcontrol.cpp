@@ -1,5 +1,6 @@
 #include "ActuatorControl.h"
 #include "dynamixel_control.h"
+#include "dynamixelbus.h"
 #include <QMap>
 #include <QList>
 #include <QString>
@@ -115,9 +116,10 @@ void ActuatorControl::terminate(){
 * Reads a byte or word from the Dynamixel actuator
 * @param id Dynamixel actuator ID
 * @param address Memory address to read from (see Control Table)
-* @return Value at the memory address
+* @return Value at the memory address, -1 if the address is unknown (negative)
 */
 int ActuatorControl::readFromDxl(int id, int address){
+    if (address < 0) return -1;
     if (isSingleByteAddress(address)) return readByteFromDxl(id, address);
     else return readWordFromDxl(id, address);
 }
@@ -129,20 +131,90 @@ int ActuatorControl::readFromDxl(int id, int address){
 * @param id Dynamixel actuator ID
 * @param address Memory address to write to (see Control Table)
 * @param value Value to write
+* @return Write acknowledgement, COMM_TXERROR without sending if the address is unknown (negative)
 */
-void ActuatorControl::writeToDxl(int id, int address, int value){
+WriteResult ActuatorControl::writeToDxl(int id, int address, int value){
+    if (address < 0){
+        WriteResult refused = { id, COMM_TXERROR, 0 };
+        return refused;
+    }
     if (isSingleByteAddress(address)) return writeByteToDxl(id, address, value);
     else return writeWordToDxl(id, address, value);
 }
 
 
+/**
+* Writes one register on several Dynamixel actuators in a single packet,
+* see DynamixelBus::writeFleet (broadcast when every device on the bus gets the same value)
+* @param address Memory address
+* @param values Dynamixel actuator ID -> value
+* @return One acknowledgement per ID, COMM_TXERROR without sending if the address is unknown (negative)
+*/
+QList<WriteResult> ActuatorControl::writeToDxls(int address, const QMap<int, int> &values){
+    if (address < 0){
+        QList<WriteResult> refused;
+        foreach (int id, values.keys()){
+            WriteResult result = { id, COMM_TXERROR, 0 };
+            refused << result;
+        }
+        return refused;
+    }
+    int length = isSingleByteAddress(address) ? 1 : 2;
+    QMap<int, QVector<int> > data;
+    QMap<int, int>::const_iterator it;
+    for (it = values.constBegin(); it != values.constEnd(); ++it){
+        QVector<int> bytes(length);
+        bytes[0] = it.value() & 0xFF;
+        if (length == 2) bytes[1] = (it.value() >> 8) & 0xFF;
+        data.insert(it.key(), bytes);
+    }
+    return DynamixelBus::writeFleet(address, length, data);
+}
+
+
+/**
+* Writes the same value into one register of several Dynamixel actuators in a single packet
+* @param address Memory address
+* @param ids Dynamixel actuator IDs
+* @param value New value
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> ActuatorControl::writeToDxls(int address, const QList<int> &ids, int value){
+    QMap<int, int> values;
+    foreach (int id, ids) values.insert(id, value);
+    return writeToDxls(address, values);
+}
+
+
+/**
+* Reads address ranges from several Dynamixel actuators, one READ per request
+* (see DynamixelBus::bulkRead); the bus is released between the READs, so the
+* replies are not taken at one instant
+* @param requests (ID, start address, length) per actuator
+* @return One decoded reply per request, in request order
+*/
+QList<BulkReadReply> ActuatorControl::bulkReadFromDxl(const QList<BulkReadRequest> &requests){
+    return DynamixelBus::bulkRead(requests);
+}
+
+
+/**
+* Returns the memory address of a control table parameter
+* @param name Parameter name as used in the control table dictionary, e.g. "present position(l)"
+* @return Memory address, -1 if the name is unknown
+*/
+int ActuatorControl::controlTableAddress(const QString &name){
+    return controlTableDictionary.value(name, -1);
+}
+
+
 /**
 * Returns the model number of the Dynamixel
 * @param id Dynamixel actuator ID
 * @return Model number
 */
 int ActuatorControl::getModelNumber(int id){
-    return readFromDxl(id, controlTableDictionary["version of firmware"]);
+    return readFromDxl(id, controlTableAddress("version of firmware"));
 }
 
 
@@ -152,7 +224,7 @@ int ActuatorControl::getModelNumber(int id){
 * @return Firmware version
 */
 int ActuatorControl::getVersionOfFirmware(int id){
-    return readFromDxl(id, controlTableDictionary["model number(l)"]);
+    return readFromDxl(id, controlTableAddress("model number(l)"));
 }
 
 
@@ -163,7 +235,7 @@ int ActuatorControl::getVersionOfFirmware(int id){
 * @return Dynamixel actuator ID, range: 0-254
 */
 int ActuatorControl::getID(int id){
-    return readFromDxl(id, controlTableDictionary["id"]);
+    return readFromDxl(id, controlTableAddress("id"));
 }
 
 
@@ -172,11 +244,12 @@ int ActuatorControl::getID(int id){
 * 254 is the Broadcast ID
 * @param id Dynamixel actuator ID
 * @param newID New ID value, range: 0-254
+* @return Write acknowledgement
 */
-void ActuatorControl::setID(int id, int newID){
+WriteResult ActuatorControl::setID(int id, int newID){
     if (newID < 0) newID = 0;
     if (newID > 254) newID = 254;
-    writeToDxl(id, controlTableDictionary["id"], newID);
+    return writeToDxl(id, controlTableAddress("id"), newID);
 }
 
 
@@ -187,7 +260,7 @@ void ActuatorControl::setID(int id, int newID){
 * @return Baudrate, range: 0-254
 */
 int ActuatorControl::getBaudrate(int id){
-    return readFromDxl(id, controlTableDictionary["baud rate"]);
+    return readFromDxl(id, controlTableAddress("baud rate"));
 }
 
 
@@ -197,11 +270,12 @@ int ActuatorControl::getBaudrate(int id){
 *
 * @param id Dynamixel actuator ID
 * @param newBaud New baudrate value, range: 0-254
+* @return Write acknowledgement
 */
-void ActuatorControl::setBaudrate(int id, int newBaud){
+WriteResult ActuatorControl::setBaudrate(int id, int newBaud){
     if (newBaud < 0) newBaud = 0;
     if (newBaud > 254) newBaud = 254;
-    writeToDxl(id, controlTableDictionary["baud rate"], newBaud);
+    return writeToDxl(id, controlTableAddress("baud rate"), newBaud);
 }
 
 
@@ -214,7 +288,7 @@ void ActuatorControl::setBaudrate(int id, int newBaud){
    * @return Return Delay Time, range: 0-254
    */
 int ActuatorControl::getReturnDelayTime(int id){
-    return readFromDxl(id, controlTableDictionary["return delay time"]);
+    return readFromDxl(id, controlTableAddress("return delay time"));
 }
 
 
@@ -225,11 +299,12 @@ int ActuatorControl::getReturnDelayTime(int id){
     * Unit: 2 usec
     * @param id Dynamixel actuator ID
     * @param newReturnDelayTime New Return Delay Time value, range: 0-254
+    * @return Write acknowledgement
     */
-void ActuatorControl::setReturnDelayTime(int id, int newReturnDelayTime){
+WriteResult ActuatorControl::setReturnDelayTime(int id, int newReturnDelayTime){
     if (newReturnDelayTime < 0) newReturnDelayTime = 0;
     if (newReturnDelayTime > 254) newReturnDelayTime = 254;
-    writeToDxl(id, controlTableDictionary["return delay time"], newReturnDelayTime);
+    return writeToDxl(id, controlTableAddress("return delay time"), newReturnDelayTime);
 }
 
 
@@ -240,7 +315,7 @@ void ActuatorControl::setReturnDelayTime(int id, int newReturnDelayTime){
 * @return CW Angle Limit
 */
 int ActuatorControl::getCWAngleLimit(int id){
-    return readFromDxl(id, controlTableDictionary["cw angle limit(l)"]);
+    return readFromDxl(id, controlTableAddress("cw angle limit(l)"));
 }
 
 
@@ -249,11 +324,12 @@ int ActuatorControl::getCWAngleLimit(int id){
 * If value is set to 0, Wheel Mode is chosen. Other values, Joint Mode (servo)
 * @param id Dynamixel actuator ID
 * @param newCWAngleLimit New CW Angle Limit value
+* @return Write acknowledgement
 */
-void ActuatorControl::setCWAngleLimit(int id, int newCWAngleLimit){
+WriteResult ActuatorControl::setCWAngleLimit(int id, int newCWAngleLimit){
     // Only checks if the input values are too low, values over 2047 may be used to enter Multi-turn Mode:
     if (newCWAngleLimit < 0) newCWAngleLimit = 0;
-    writeToDxl(id, controlTableDictionary["cw angle limit(l)"], newCWAngleLimit);
+    return writeToDxl(id, controlTableAddress("cw angle limit(l)"), newCWAngleLimit);
 }
 
 
@@ -264,7 +340,7 @@ void ActuatorControl::setCWAngleLimit(int id, int newCWAngleLimit){
 * @return CCW Angle Limit
 */
 int ActuatorControl::getCCWAngleLimit(int id){
-    return readFromDxl(id, controlTableDictionary["ccw angle limit(l)"]);
+    return readFromDxl(id, controlTableAddress("ccw angle limit(l)"));
 }
 
 
@@ -273,11 +349,12 @@ int ActuatorControl::getCCWAngleLimit(int id){
 * If value is set to 0, Wheel Mode is chosen. Other values, Joint Mode.
 * @param id Dynamixel actuator ID
 * @param newCCWAngleLimit New CCW Angle Limit value
+* @return Write acknowledgement
 */
-void ActuatorControl::setCCWAngleLimit(int id, int newCCWAngleLimit){
+WriteResult ActuatorControl::setCCWAngleLimit(int id, int newCCWAngleLimit){
     // Only checks if the input values are too low, values over 2047 may be used to enter Multi-turn Mode:
     if (newCCWAngleLimit < 0) newCCWAngleLimit = 0;
-    writeToDxl(id, controlTableDictionary["ccw angle limit(l)"], newCCWAngleLimit);
+    return writeToDxl(id, controlTableAddress("ccw angle limit(l)"), newCCWAngleLimit);
 }
 
 
@@ -288,7 +365,7 @@ void ActuatorControl::setCCWAngleLimit(int id, int newCCWAngleLimit){
 * @return Highest Limit Temperature
 */
 int ActuatorControl::getTheHighestLimitTemperature(int id){
-    return readFromDxl(id, controlTableDictionary["the highest limit temperature"]);
+    return readFromDxl(id, controlTableAddress("the highest limit temperature"));
 }
 
 
@@ -297,9 +374,10 @@ int ActuatorControl::getTheHighestLimitTemperature(int id){
 * NB! Should not be changed from its default value (70).
 * @param id Dynamixel actuator ID
 * @param valu New Highest Limit Temperature value
+* @return Write acknowledgement
 */
-void ActuatorControl::setTheHighestLimitTemperature(int id, int value){
-    writeToDxl(id, controlTableDictionary["the highest limit temperature"], value);
+WriteResult ActuatorControl::setTheHighestLimitTemperature(int id, int value){
+    return writeToDxl(id, controlTableAddress("the highest limit temperature"), value);
 }
 
 
@@ -312,7 +390,7 @@ void ActuatorControl::setTheHighestLimitTemperature(int id, int value){
 * @return Lowest Limit Voltage
 */
 int ActuatorControl::getTheLowestLimitVoltage(int id){
-    return readFromDxl(id, controlTableDictionary["the lowest limit voltage"]);
+    return readFromDxl(id, controlTableAddress("the lowest limit voltage"));
 }
 
 
@@ -323,11 +401,12 @@ int ActuatorControl::getTheLowestLimitVoltage(int id){
 * Unit: 0.1V
 * @param id Dynamixel actuator ID
 * @param value New Lowest Limit Voltage value, range: 50-250
+* @return Write acknowledgement
 */
-void ActuatorControl::setTheLowestLimitVoltage(int id, int value){
+WriteResult ActuatorControl::setTheLowestLimitVoltage(int id, int value){
     if (value < 50) value = 50;
     if (value > 250) value = 250;
-    writeToDxl(id, controlTableDictionary["the lowest limit voltage"], value);
+    return writeToDxl(id, controlTableAddress("the lowest limit voltage"), value);
 }
 
 
@@ -340,7 +419,7 @@ void ActuatorControl::setTheLowestLimitVoltage(int id, int value){
 * @return Highest Limit Voltage
 */
 int ActuatorControl::getTheHighestLimitVoltage(int id){
-   return readFromDxl(id, controlTableDictionary["the highest limit voltage"]);
+   return readFromDxl(id, controlTableAddress("the highest limit voltage"));
 }
 
 
@@ -351,11 +430,12 @@ int ActuatorControl::getTheHighestLimitVoltage(int id){
 * Unit: 0.1V
 * @param id Dynamixel actuator ID
 * @param value New Highest Limit Voltage value, range: 50-250
+* @return Write acknowledgement
 */
-void ActuatorControl::setTheHighestLimitVoltage(int id, int value){
+WriteResult ActuatorControl::setTheHighestLimitVoltage(int id, int value){
     if (value < 50) value = 50;
     if (value > 250) value = 250;
-    writeToDxl(id, controlTableDictionary["the highest limit voltage"], value);
+    return writeToDxl(id, controlTableAddress("the highest limit voltage"), value);
 }
 
 
@@ -367,7 +447,7 @@ void ActuatorControl::setTheHighestLimitVoltage(int id, int value){
 * @return Max Torque, range: 0-1023
 */
 int ActuatorControl::getMaxTorque(int id){
-   return readFromDxl(id, controlTableDictionary["max torque(l)"]);
+   return readFromDxl(id, controlTableAddress("max torque(l)"));
 }
 
 
@@ -377,11 +457,12 @@ int ActuatorControl::getMaxTorque(int id){
 * Valid values: 0 - 1023 (0% - 100%).
 * @param id Dynamixel actuator ID
 * @param value New Max Torque value, range: 0-1023
+* @return Write acknowledgement
 */
-void ActuatorControl::setMaxTorque(int id, int value){
+WriteResult ActuatorControl::setMaxTorque(int id, int value){
    if (value < 0) value = 0;
    if (value > 1023) value = 1023;
-   writeToDxl(id, controlTableDictionary["max torque(l)"], value);
+   return writeToDxl(id, controlTableAddress("max torque(l)"), value);
 }
 
 
@@ -395,7 +476,7 @@ void ActuatorControl::setMaxTorque(int id, int value){
 * @return Status Return Level, 0, 1 or 2
 */
 int ActuatorControl::getStatusReturnLevel(int id){
-    return readFromDxl(id, controlTableDictionary["status return level"]);
+    return readFromDxl(id, controlTableAddress("status return level"));
 }
 
 
@@ -407,10 +488,11 @@ int ActuatorControl::getStatusReturnLevel(int id){
 * Value 2: Return for all commands
 * @param id Dynamixel actuator ID
 * @param value New Status Return Level value, 0, 1 or 2
+* @return Write acknowledgement
 */
-void ActuatorControl::setStatusReturnLevel(int id, int value){
-    if (value < 0 || value > 3) return;
-    else writeToDxl(id, controlTableDictionary["status return level"], value);
+WriteResult ActuatorControl::setStatusReturnLevel(int id, int value){
+    if (value < 0 || value > 3) return rangeError(id);
+    else return writeToDxl(id, controlTableAddress("status return level"), value);
 }
 
 
@@ -420,7 +502,7 @@ void ActuatorControl::setStatusReturnLevel(int id, int value){
 * @return 0 if off, 1 else
 */
 int ActuatorControl::getAlarmLED(int id){
-    return readFromDxl(id, controlTableDictionary["alarm led"]);
+    return readFromDxl(id, controlTableAddress("alarm led"));
 }
 
 
@@ -429,10 +511,24 @@ int ActuatorControl::getAlarmLED(int id){
 * Off: 0, on: 1
 * @param id Dynamixel actuator ID
 * @param value New Alarm LED status value, 0 or 1
+* @return Write acknowledgement
 */
-void ActuatorControl::setAlarmLED(int id, int value){
-    if (value != 0 || value != 1) return;
-    else writeToDxl(id, controlTableDictionary["alarm led"], value);
+WriteResult ActuatorControl::setAlarmLED(int id, int value){
+    if (value != 0 && value != 1) return rangeError(id);
+    else return writeToDxl(id, controlTableAddress("alarm led"), value);
+}
+
+
+/**
+* Sets the Alarm LED of several actuators in a single packet
+* Off: 0, on: 1
+* @param ids Dynamixel actuator IDs
+* @param value New Alarm LED status value, 0 or 1
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> ActuatorControl::setAlarmLED(const QList<int> &ids, int value){
+    if (value != 0 && value != 1) return rangeErrors(ids);
+    else return writeToDxls(controlTableAddress("alarm led"), ids, value);
 }
 
 
@@ -457,7 +553,7 @@ void ActuatorControl::setAlarmLED(int id, int value){
 * @return See description
 */
 int ActuatorControl::getAlarmShutdown(int id){
-    return readFromDxl(id, controlTableDictionary["alarm shutdown"]);
+    return readFromDxl(id, controlTableAddress("alarm shutdown"));
 }
 
 
@@ -480,9 +576,10 @@ int ActuatorControl::getAlarmShutdown(int id){
 * Example: 0X05 (00000101) will turn on both Input voltage error and Overheating error.
 * @param id Dynamixel actuator ID
 * @param value New Alarm Shutdown value (see description)
+* @return Write acknowledgement
 */
-void ActuatorControl::setAlarmShutdown(int id, int value){
-    writeToDxl(id, controlTableDictionary["alarm shutdown"], value);
+WriteResult ActuatorControl::setAlarmShutdown(int id, int value){
+    return writeToDxl(id, controlTableAddress("alarm shutdown"), value);
 }
 
 
@@ -492,7 +589,7 @@ void ActuatorControl::setAlarmShutdown(int id, int value){
 * @return Off: 0, on: 1
 */
 int ActuatorControl::getTorqueEnable(int id){
-    return readFromDxl(id, controlTableDictionary["torque enable"]);
+    return readFromDxl(id, controlTableAddress("torque enable"));
 }
 
 
@@ -500,10 +597,23 @@ int ActuatorControl::getTorqueEnable(int id){
 * Sets the Torque Enable status
 * @param id Dynamixel actuator ID
 * @param value Off: 0, on: 1
+* @return Write acknowledgement
+*/
+WriteResult ActuatorControl::setTorqueEnable(int id, int value){
+    if (value != 0 && value != 1) return rangeError(id);
+    else return writeToDxl(id, controlTableAddress("torque enable"), value);
+}
+
+
+/**
+* Sets the Torque Enable status of several actuators in a single packet
+* @param ids Dynamixel actuator IDs
+* @param value Off: 0, on: 1
+* @return One acknowledgement per ID
 */
-void ActuatorControl::setTorqueEnable(int id, int value){
-    if (value != 0 || value != 1) return;
-    else writeToDxl(id, controlTableDictionary["torque enable"], value);
+QList<WriteResult> ActuatorControl::setTorqueEnable(const QList<int> &ids, int value){
+    if (value != 0 && value != 1) return rangeErrors(ids);
+    else return writeToDxls(controlTableAddress("torque enable"), ids, value);
 }
 
 
@@ -514,7 +624,7 @@ void ActuatorControl::setTorqueEnable(int id, int value){
 * @return Bit 2: BLUE LED, Bit 1: GREEN, Bit 0: RED LED
 */
 int ActuatorControl::getLED(int id){
-    return readFromDxl(id, controlTableDictionary["led"]);
+    return readFromDxl(id, controlTableAddress("led"));
 }
 
 
@@ -523,9 +633,22 @@ int ActuatorControl::getLED(int id){
 * Based on values in a byte (logic OR on each bit)
 * @param id Dynamixel actuator ID
 * @param value Bit 2: BLUE LED, Bit 1: GREEN, Bit 0: RED LED
+* @return Write acknowledgement
 */
-void ActuatorControl::setLED(int id, int value){
-    writeToDxl(id, controlTableDictionary["led"], value);
+WriteResult ActuatorControl::setLED(int id, int value){
+    return writeToDxl(id, controlTableAddress("led"), value);
+}
+
+
+/**
+* Sets the LED status of several actuators in a single packet
+* Based on values in a byte (logic OR on each bit)
+* @param ids Dynamixel actuator IDs
+* @param value Bit 2: BLUE LED, Bit 1: GREEN, Bit 0: RED LED
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> ActuatorControl::setLED(const QList<int> &ids, int value){
+    return writeToDxls(controlTableAddress("led"), ids, value);
 }
 
 
@@ -536,7 +659,7 @@ void ActuatorControl::setLED(int id, int value){
 * @return CW Compliance Margin, range: 0-255
 */
 int ActuatorControl::getCWComplianceMargin(int id){
-    return readFromDxl(id, controlTableDictionary["cw compliance margin"]);
+    return readFromDxl(id, controlTableAddress("cw compliance margin"));
 }
 
 
@@ -545,11 +668,23 @@ int ActuatorControl::getCWComplianceMargin(int id){
 * The margin designates the area around the goal position that receives no torque
 * @param id Dynamixel actuator ID
 * @param value New CW Compliance Margin value, range: 0-255
+* @return Write acknowledgement
 */
-void ActuatorControl::setCWComplianceMargin(int id, int value){
+WriteResult ActuatorControl::setCWComplianceMargin(int id, int value){
     if (value < 0) value = 0;
     if (value > 255) value = 255;
-    writeToDxl(id, controlTableDictionary["cw compliance margin"], value);
+    return writeToDxl(id, controlTableAddress("cw compliance margin"), value);
+}
+
+
+/**
+* Sets the CW Compliance Margin of several actuators in a single packet
+* @param ids Dynamixel actuator IDs
+* @param value New CW Compliance Margin value, range: 0-255
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> ActuatorControl::setCWComplianceMargin(const QList<int> &ids, int value){
+    return writeToDxls(controlTableAddress("cw compliance margin"), ids, qBound(0, value, 255));
 }
 
 
@@ -560,7 +695,7 @@ void ActuatorControl::setCWComplianceMargin(int id, int value){
 * @return CCW Compliance Margin, range: 0-255
 */
 int ActuatorControl::getCCWComplianceMargin(int id){
-    return readFromDxl(id, controlTableDictionary["ccw compliance margin"]);
+    return readFromDxl(id, controlTableAddress("ccw compliance margin"));
 }
 
 
@@ -569,11 +704,23 @@ int ActuatorControl::getCCWComplianceMargin(int id){
 * The margin designates the area around the goal position that receives no torque
 * @param id Dynamixel actuator ID
 * @param value New CCW Compliance Margin value, range: 0-255
+* @return Write acknowledgement
 */
-void ActuatorControl::setCCWComplianceMargin(int id, int value){
+WriteResult ActuatorControl::setCCWComplianceMargin(int id, int value){
     if (value < 0) value = 0;
     if (value > 255) value = 255;
-    writeToDxl(id, controlTableDictionary["ccw compliance margin"], value);
+    return writeToDxl(id, controlTableAddress("ccw compliance margin"), value);
+}
+
+
+/**
+* Sets the CCW Compliance Margin of several actuators in a single packet
+* @param ids Dynamixel actuator IDs
+* @param value New CCW Compliance Margin value, range: 0-255
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> ActuatorControl::setCCWComplianceMargin(const QList<int> &ids, int value){
+    return writeToDxls(controlTableAddress("ccw compliance margin"), ids, qBound(0, value, 255));
 }
 
 
@@ -588,7 +735,7 @@ void ActuatorControl::setCCWComplianceMargin(int id, int value){
 * @return CW Compliance Slope (see description)
 */
 int ActuatorControl::getCWComplianceSlope(int id){
-    return readFromDxl(id, controlTableDictionary["cw compliance slope"]);
+    return readFromDxl(id, controlTableAddress("cw compliance slope"));
 }
 
 /**
@@ -599,11 +746,23 @@ int ActuatorControl::getCWComplianceSlope(int id){
 * 2, 4, 8, 16, 32, 64, 128
 * @param id Dynamixel actuator ID
 * @param value New CW Compliance Slope value (2, 4, 8, 16, 32, 64, 128)
+* @return Write acknowledgement
 */
-void ActuatorControl::setCWComplianceSlope(int id, int value){
+WriteResult ActuatorControl::setCWComplianceSlope(int id, int value){
     if (value < 0) value = 0;
     if (value > 255) value = 254;
-    writeToDxl(id, controlTableDictionary["cw compliance slope"], value);
+    return writeToDxl(id, controlTableAddress("cw compliance slope"), value);
+}
+
+
+/**
+* Sets the CW Compliance Slope of several actuators in a single packet
+* @param ids Dynamixel actuator IDs
+* @param value New CW Compliance Slope value (2, 4, 8, 16, 32, 64, 128)
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> ActuatorControl::setCWComplianceSlope(const QList<int> &ids, int value){
+    return writeToDxls(controlTableAddress("cw compliance slope"), ids, qBound(0, value, 254));
 }
 
 
@@ -617,7 +776,7 @@ void ActuatorControl::setCWComplianceSlope(int id, int value){
 * @return CCW Compliance Slope (see description)
 */
 int ActuatorControl::getCCWComplianceSlope(int id){
-    return readFromDxl(id, controlTableDictionary["ccw compliance slope"]);
+    return readFromDxl(id, controlTableAddress("ccw compliance slope"));
 }
 
 
@@ -629,11 +788,23 @@ int ActuatorControl::getCCWComplianceSlope(int id){
 * 2, 4, 8, 16, 32, 64, 128
 * @param id Dynamixel actuator ID
 * @param value New CCW Compliance Slope value (2, 4, 8, 16, 32, 64, 128)
+* @return Write acknowledgement
 */
-void ActuatorControl::setCCWComplianceSlope(int id, int value){
+WriteResult ActuatorControl::setCCWComplianceSlope(int id, int value){
    if (value < 0) value = 0;
    if (value > 255) value = 254;
-   writeToDxl(id, controlTableDictionary["ccw compliance slope"], value);
+   return writeToDxl(id, controlTableAddress("ccw compliance slope"), value);
+}
+
+
+/**
+* Sets the CCW Compliance Slope of several actuators in a single packet
+* @param ids Dynamixel actuator IDs
+* @param value New CCW Compliance Slope value (2, 4, 8, 16, 32, 64, 128)
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> ActuatorControl::setCCWComplianceSlope(const QList<int> &ids, int value){
+    return writeToDxls(controlTableAddress("ccw compliance slope"), ids, qBound(0, value, 254));
 }
 
 
@@ -648,7 +819,7 @@ void ActuatorControl::setCCWComplianceSlope(int id, int value){
 * @return Goal Position, range: 0-1023
 */
 int ActuatorControl::getGoalPosition(int id){
-    return readFromDxl(id, controlTableDictionary["goal position(l)"]);
+    return readFromDxl(id, controlTableAddress("goal position(l)"));
 }
 
 
@@ -659,11 +830,25 @@ int ActuatorControl::getGoalPosition(int id){
 * Alarm LED/Alarm Shutdown will be executed.
 * @param id Dynamixel actuator ID
 * <param value New Goal Position value, range: 0-1023
+* @return Write acknowledgement
 */
-void ActuatorControl::setGoalPosition(int id, int value){
+WriteResult ActuatorControl::setGoalPosition(int id, int value){
     if (value < 0) value = 0;
     if (value > 1023) value = 1023;
-    writeToDxl(id, controlTableDictionary["goal position(l)"], value);
+    return writeToDxl(id, controlTableAddress("goal position(l)"), value);
+}
+
+
+/**
+* Sets the Goal Position of several actuators in a single packet
+* @param values Dynamixel actuator ID -> Goal Position, range: 0-1023
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> ActuatorControl::setGoalPositions(const QMap<int, int> &values){
+    QMap<int, int> clamped;
+    QMap<int, int>::const_iterator it;
+    for (it = values.constBegin(); it != values.constEnd(); ++it) clamped.insert(it.key(), qBound(0, it.value(), 1023));
+    return writeToDxls(controlTableAddress("goal position(l)"), clamped);
 }
 
 
@@ -677,7 +862,7 @@ void ActuatorControl::setGoalPosition(int id, int value){
 * @return Moving Speed (see description)
 */
 int ActuatorControl::getMovingSpeed(int id){
-    return readFromDxl(id, controlTableDictionary["moving speed(l)"]);
+    return readFromDxl(id, controlTableAddress("moving speed(l)"));
 }
 
 
@@ -689,8 +874,9 @@ int ActuatorControl::getMovingSpeed(int id){
 * WHEEL MODE - range: 0-2047 (0-1023 CCW, 1024-2047 CW), unit: 0.1%
 * @param id Dynamixel actuator ID
 * <param value New Moving Speed value (see description)
+* @return Write acknowledgement
 */
-void ActuatorControl::setMovingSpeed(int id, int value){
+WriteResult ActuatorControl::setMovingSpeed(int id, int value){
     if (value < 0) value = 0;
     else{
         if (getMovementMode(id) == 0){ // WHEEL MODE
@@ -700,10 +886,30 @@ void ActuatorControl::setMovingSpeed(int id, int value){
             if(value < 1023) value = 1023;
         }
     }
-    writeToDxl(id, controlTableDictionary["moving speed(l)"], value);
+    return writeToDxl(id, controlTableAddress("moving speed(l)"), value);
     }
 
 
+/**
+* Sets the Moving Speed of several actuators in a single packet
+* Range and unit of the value varies, depending on operation mode:
+*
+* JOINT MODE - range: 0-1023, unit: 0.111rpm, example: value 300 --> 33.3rpm
+* WHEEL MODE - range: 0-2047 (0-1023 CCW, 1024-2047 CW), unit: 0.1%
+*
+* Values are clamped to 0-2047 only; reading every actuator's mode would cost a
+* transaction per ID.
+* @param values Dynamixel actuator ID -> Moving Speed (see description)
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> ActuatorControl::setMovingSpeeds(const QMap<int, int> &values){
+    QMap<int, int> clamped;
+    QMap<int, int>::const_iterator it;
+    for (it = values.constBegin(); it != values.constEnd(); ++it) clamped.insert(it.key(), qBound(0, it.value(), 2047));
+    return writeToDxls(controlTableAddress("moving speed(l)"), clamped);
+}
+
+
 /**
 * Returns the Torque Limit
 * Range: 0-1023, unit: 0.1%
@@ -711,7 +917,7 @@ void ActuatorControl::setMovingSpeed(int id, int value){
 * @return Torque Limit
 */
 int ActuatorControl::getTorqueLimit(int id){
-    return readFromDxl(id, controlTableDictionary["torque limit(l)"]);
+    return readFromDxl(id, controlTableAddress("torque limit(l)"));
 }
 
 
@@ -720,11 +926,25 @@ int ActuatorControl::getTorqueLimit(int id){
 * Range: 0-1023, unit: 0.1%
 * @param id Dynamixel actuator ID
 * <param value New Torque Limit value, range: 0-1023
+* @return Write acknowledgement
 */
-void ActuatorControl::setTorqueLimit(int id, int value){
+WriteResult ActuatorControl::setTorqueLimit(int id, int value){
     if (value < 0) value = 0;
     if (value > 1023) value = 1023;
-    writeToDxl(id, controlTableDictionary["torque limit(l)"], value);
+    return writeToDxl(id, controlTableAddress("torque limit(l)"), value);
+}
+
+
+/**
+* Sets the Torque Limit of several actuators in a single packet
+* @param values Dynamixel actuator ID -> Torque Limit, range: 0-1023
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> ActuatorControl::setTorqueLimits(const QMap<int, int> &values){
+    QMap<int, int> clamped;
+    QMap<int, int>::const_iterator it;
+    for (it = values.constBegin(); it != values.constEnd(); ++it) clamped.insert(it.key(), qBound(0, it.value(), 1023));
+    return writeToDxls(controlTableAddress("torque limit(l)"), clamped);
 }
 
 
@@ -735,7 +955,7 @@ void ActuatorControl::setTorqueLimit(int id, int value){
 * @return Present Position
 */
 int ActuatorControl::getPresentPosition(int id){
-    return readFromDxl(id, controlTableDictionary["present position(l)"]);
+    return readFromDxl(id, controlTableAddress("present position(l)"));
 }
 
 
@@ -747,7 +967,7 @@ int ActuatorControl::getPresentPosition(int id){
 * @return Present Speed (see description)
 */
 int ActuatorControl::getPresentSpeed(int id){
-    return readFromDxl(id, controlTableDictionary["present speed(l)"]);
+    return readFromDxl(id, controlTableAddress("present speed(l)"));
 }
 
 
@@ -759,19 +979,18 @@ int ActuatorControl::getPresentSpeed(int id){
 * @return Present Load
 */
 int ActuatorControl::getPresentLoad(int id){
-    return readFromDxl(id, controlTableDictionary["present load(l)"]);
+    return readFromDxl(id, controlTableAddress("present load(l)"));
 }
 
 
 /**
-* Returns the Present Load
-* Range: 0-2047 (0-1023 CCW, 1024-2047 CW)
-* Unit: 0.1%
+* Returns the Present Voltage
+* Unit: 0.1V, example: value 95 --> 9.5V
 * @param id Dynamixel actuator ID
-* @return Present Load
+* @return Present Voltage
 */
 int ActuatorControl::getPresentVoltage(int id){
-    return readFromDxl(id, controlTableDictionary["present "]);
+    return readFromDxl(id, controlTableAddress("present voltage"));
 }
 
 
@@ -783,7 +1002,7 @@ int ActuatorControl::getPresentVoltage(int id){
 * @return Present Temperature
 */
 int ActuatorControl::getPresentTemperature(int id){
-    return readFromDxl(id, controlTableDictionary["present temperature"]);
+    return readFromDxl(id, controlTableAddress("present temperature"));
 }
 
 
@@ -793,7 +1012,7 @@ int ActuatorControl::getPresentTemperature(int id){
 * @return False: 0, true: 1
 */
 int ActuatorControl::getRegistered(int id){
-    return readFromDxl(id, controlTableDictionary["registered"]);
+    return readFromDxl(id, controlTableAddress("registered"));
 }
 
 
@@ -803,7 +1022,7 @@ int ActuatorControl::getRegistered(int id){
 * @return False: 0, true: 1
 */
 int ActuatorControl::getMoving(int id){
-    return readFromDxl(id, controlTableDictionary["moving"]);
+    return readFromDxl(id, controlTableAddress("moving"));
 }
 
 
@@ -814,7 +1033,7 @@ int ActuatorControl::getMoving(int id){
 * @return False: 0, true: 1
 */
 int ActuatorControl::getLock(int id){
-    return readFromDxl(id, controlTableDictionary["lock"]);
+    return readFromDxl(id, controlTableAddress("lock"));
 }
 
 
@@ -823,10 +1042,11 @@ int ActuatorControl::getLock(int id){
 * EEPROM is a memory area (addresses 0-18) that can be locked from modification
 * @param id Dynamixel actuator ID
 * @param value Lock: 1, unlock: 0
+* @return Write acknowledgement
 */
-void ActuatorControl::setLock(int id, int value){
-    if (value != 0 || value != 1) return;
-    else writeToDxl(id, controlTableDictionary["lock"], value);
+WriteResult ActuatorControl::setLock(int id, int value){
+    if (value != 0 && value != 1) return rangeError(id);
+    else return writeToDxl(id, controlTableAddress("lock"), value);
 }
 
 
@@ -839,7 +1059,7 @@ void ActuatorControl::setLock(int id, int value){
 * @return Punch
 */
 int ActuatorControl::getPunch(int id){
-    return readFromDxl(id, controlTableDictionary["punch(l)"]);
+    return readFromDxl(id, controlTableAddress("punch(l)"));
 }
 
 
@@ -850,11 +1070,23 @@ int ActuatorControl::getPunch(int id){
 * Default value: 32
 * @param id
 * @param value New Punch value, range: 32-1023
+* @return Write acknowledgement
 */
-void ActuatorControl::setPunch(int id, int value){
+WriteResult ActuatorControl::setPunch(int id, int value){
     if (value < 32) value = 32;
     if (value > 1023) value = 1023;
-    writeToDxl(id, controlTableDictionary["punch(l)"], value);
+    return writeToDxl(id, controlTableAddress("punch(l)"), value);
+}
+
+
+/**
+* Sets the Punch of several actuators in a single packet
+* @param ids Dynamixel actuator IDs
+* @param value New Punch value, range: 32-1023
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> ActuatorControl::setPunch(const QList<int> &ids, int value){
+    return writeToDxls(controlTableAddress("punch(l)"), ids, qBound(32, value, 1023));
 }
 
 
@@ -864,11 +1096,12 @@ void ActuatorControl::setPunch(int id, int value){
 /**
 * Toggles the Torque on or off
 * @param id Dynamixel actuator ID
+* @return Write acknowledgement
 */
-void ActuatorControl::torqueEnableSwitch(int id){
+WriteResult ActuatorControl::torqueEnableSwitch(int id){
     int status = getTorqueEnable(id);
-    if (status > 0) setTorqueEnable(id, 0); // if on, turn off
-    else setTorqueEnable(id, 1); // if off, turn on
+    if (status > 0) return setTorqueEnable(id, 0); // if on, turn off
+    else return setTorqueEnable(id, 1); // if off, turn on
 }
 
 
@@ -907,10 +1140,12 @@ bool ActuatorControl::isEEPROMLocked(int id){
 * Turns on WHEEL MODE on the Dynamixel actuator
 * WHEEL MODE: The actuator rotates 360 degrees like a regular motor
 * @param id
+* @return Acknowledgement of the first write that failed, otherwise of the last one
 */
-void ActuatorControl::toggleWheelMode(int id){
-    setCWAngleLimit(id, 0);
-    setCCWAngleLimit(id, 0);
+WriteResult ActuatorControl::toggleWheelMode(int id){
+    WriteResult cw = setCWAngleLimit(id, 0);
+    WriteResult ccw = setCCWAngleLimit(id, 0);
+    return cw.succeeded() ? ccw : cw;
 }
 
 
@@ -920,10 +1155,12 @@ void ActuatorControl::toggleWheelMode(int id){
 * @param id Dynamixel actuator ID
 * @param newCWAngleLimit New CW Angle Limit
 * @param newCCWAngleLimit New CCW Angle Limit
+* @return Acknowledgement of the first write that failed, otherwise of the last one
 */
-void ActuatorControl::toggleJointMode(int id, int newCWAngleLimit, int newCCWAngleLimit){
-    setCWAngleLimit(id, newCWAngleLimit);
-    setCCWAngleLimit(id, newCCWAngleLimit);
+WriteResult ActuatorControl::toggleJointMode(int id, int newCWAngleLimit, int newCCWAngleLimit){
+    WriteResult cw = setCWAngleLimit(id, newCWAngleLimit);
+    WriteResult ccw = setCCWAngleLimit(id, newCCWAngleLimit);
+    return cw.succeeded() ? ccw : cw;
 }
 
 
@@ -941,9 +1178,10 @@ int ActuatorControl::getGoalPositionAngular(int id){
 * Sets the goal position based on angular input
 * @param id Dynamixel actuator ID
 * @param angularPosition Angular goal position value
+* @return Write acknowledgement
 */
-void ActuatorControl::setGoalPositionAngular(int id, int angularPosition){
-    setGoalPosition(id, angularValueToDxlValue(angularPosition));
+WriteResult ActuatorControl::setGoalPositionAngular(int id, int angularPosition){
+    return setGoalPosition(id, angularValueToDxlValue(angularPosition));
 }
 
 
@@ -968,23 +1206,56 @@ int ActuatorControl::getMovementMode(int id){
 }
 
 
+/**
+* Returns the present position of several actuators, one READ per actuator
+* (see bulkReadFromDxl), so the positions are not taken at one instant
+* Range: 0-1023, unit: 0.29 degrees
+* @param ids Dynamixel actuator IDs
+* @return Present position per ID; IDs that did not answer are left out
+*/
+QMap<int, int> ActuatorControl::getPresentPositions(const QList<int> &ids){
+    QList<BulkReadRequest> requests;
+    foreach (int id, ids){
+        BulkReadRequest request = { id, controlTableAddress("present position(l)"), 2 };
+        requests << request;
+    }
+
+    QMap<int, int> positions;
+    foreach (const BulkReadReply &reply, bulkReadFromDxl(requests)){
+        if (reply.data.size() == 2) positions[reply.id] = reply.data.at(0) | (reply.data.at(1) << 8);
+    }
+    return positions;
+}
+
+
 
 // INTERNAL SUBROUTINES (private) ******************************************************************
 
-void ActuatorControl::writeByteToDxl(int id, int address, int value){
-    dxl_write_byte(id, address, value);
+WriteResult ActuatorControl::writeByteToDxl(int id, int address, int value){
+    return DynamixelBus::writeByte(id, address, value);
+}
+
+WriteResult ActuatorControl::writeWordToDxl(int id, int address, int value){
+    return DynamixelBus::writeWord(id, address, value);
+}
+
+WriteResult ActuatorControl::rangeError(int id){
+    WriteResult refused = { id, COMM_RANGEERROR, 0 };     // not sent, so no device error bits to report
+    return refused;
 }
 
-void ActuatorControl::writeWordToDxl(int id, int address, int value){
-    dxl_write_word(id, address, value);
+QList<WriteResult> ActuatorControl::rangeErrors(const QList<int> &ids){
+    QList<WriteResult> refused;
+    foreach (int id, ids) refused << rangeError(id);
+    return refused;
 }
 
 int ActuatorControl::readByteFromDxl(int id, int address){
-    return dxl_read_byte(id, address);
+    return DynamixelBus::readByte(id, address, DynamixelBus::readPriority(address));
 }
 
 int ActuatorControl::readWordFromDxl(int id, int address){
-    return dxl_read_word(id, address);
+    return DynamixelBus::readWord(id, address, DynamixelBus::readPriority(address));
 }
 
 int ActuatorControl::angularValueFromDxlValue(int value){
@@ -3,6 +3,7 @@
 #include <QMap>
 #include <QList>
 #include <QString>
+#include "dynamixelbus.h"
 #include <iterator>
 #include <algorithm>
 
@@ -15,51 +16,65 @@ public:
     static int initialize(void);
     static void terminate(void);
     static int readFromDxl(int id, int address);
-    static void writeToDxl(int id, int address, int value);
+    static WriteResult writeToDxl(int id, int address, int value);
+    static QList<WriteResult> writeToDxls(int address, const QMap<int, int> &values);
+    static QList<WriteResult> writeToDxls(int address, const QList<int> &ids, int value);
+    static int controlTableAddress(const QString &name);
+    static QList<BulkReadReply> bulkReadFromDxl(const QList<BulkReadRequest> &requests);
     static int getModelNumber(int id);
     static int getVersionOfFirmware(int id);
     static int getID(int id);
-    static void setID(int id, int newID);
+    static WriteResult setID(int id, int newID);
     static int getBaudrate(int id);
-    static void setBaudrate(int id, int newBaud);
+    static WriteResult setBaudrate(int id, int newBaud);
     static int getReturnDelayTime(int id);
-    static void setReturnDelayTime(int id, int newReturnDelayTime);
+    static WriteResult setReturnDelayTime(int id, int newReturnDelayTime);
     static int getCWAngleLimit(int id);
-    static void setCWAngleLimit(int id, int newCWAngleLimit);
+    static WriteResult setCWAngleLimit(int id, int newCWAngleLimit);
     static int getCCWAngleLimit(int id);
-    static void setCCWAngleLimit(int id, int newCCWAngleLimit);
+    static WriteResult setCCWAngleLimit(int id, int newCCWAngleLimit);
     static int getTheHighestLimitTemperature(int id);
-    static void setTheHighestLimitTemperature(int id, int value);
+    static WriteResult setTheHighestLimitTemperature(int id, int value);
     static int getTheLowestLimitVoltage(int id);
-    static void setTheLowestLimitVoltage(int id, int value);
+    static WriteResult setTheLowestLimitVoltage(int id, int value);
     static int getTheHighestLimitVoltage(int id);
-    static void setTheHighestLimitVoltage(int id, int value);
+    static WriteResult setTheHighestLimitVoltage(int id, int value);
     static int getMaxTorque(int id);
-    static void setMaxTorque(int id, int value);
+    static WriteResult setMaxTorque(int id, int value);
     static int getStatusReturnLevel(int id);
-    static void setStatusReturnLevel(int id, int value);
+    static WriteResult setStatusReturnLevel(int id, int value);
     static int getAlarmLED(int id);
-    static void setAlarmLED(int id, int value);
+    static WriteResult setAlarmLED(int id, int value);
+    static QList<WriteResult> setAlarmLED(const QList<int> &ids, int value);
     static int getAlarmShutdown(int id);
-    static void setAlarmShutdown(int id, int value);
+    static WriteResult setAlarmShutdown(int id, int value);
     static int getTorqueEnable(int id);
-    static void setTorqueEnable(int id, int value);
+    static WriteResult setTorqueEnable(int id, int value);
+    static QList<WriteResult> setTorqueEnable(const QList<int> &ids, int value);
     static int getLED(int id);
-    static void setLED(int id, int value);
+    static WriteResult setLED(int id, int value);
+    static QList<WriteResult> setLED(const QList<int> &ids, int value);
     static int getCWComplianceMargin(int id);
-    static void setCWComplianceMargin(int id, int value);
+    static WriteResult setCWComplianceMargin(int id, int value);
+    static QList<WriteResult> setCWComplianceMargin(const QList<int> &ids, int value);
     static int getCCWComplianceMargin(int id);
-    static void setCCWComplianceMargin(int id, int value);
+    static WriteResult setCCWComplianceMargin(int id, int value);
+    static QList<WriteResult> setCCWComplianceMargin(const QList<int> &ids, int value);
     static int getCWComplianceSlope(int id);
-    static void setCWComplianceSlope(int id, int value);
+    static WriteResult setCWComplianceSlope(int id, int value);
+    static QList<WriteResult> setCWComplianceSlope(const QList<int> &ids, int value);
     static int getCCWComplianceSlope(int id);
-    static void setCCWComplianceSlope(int id, int value);
+    static WriteResult setCCWComplianceSlope(int id, int value);
+    static QList<WriteResult> setCCWComplianceSlope(const QList<int> &ids, int value);
     static int getGoalPosition(int id);
-    static void setGoalPosition(int id, int value);
+    static WriteResult setGoalPosition(int id, int value);
+    static QList<WriteResult> setGoalPositions(const QMap<int, int> &values);
     static int getMovingSpeed(int id);
-    static void setMovingSpeed(int id, int value);
+    static WriteResult setMovingSpeed(int id, int value);
+    static QList<WriteResult> setMovingSpeeds(const QMap<int, int> &values);
     static int getTorqueLimit(int id);
-    static void setTorqueLimit(int id, int value);
+    static WriteResult setTorqueLimit(int id, int value);
+    static QList<WriteResult> setTorqueLimits(const QMap<int, int> &values);
     static int getPresentPosition(int id);
     static int getPresentSpeed(int id);
     static int getPresentVoltage(int id);
@@ -67,24 +82,28 @@ public:
     static int getRegistered(int id);
     static int getMoving(int id);
     static int getLock(int id);
-    static void setLock(int id, int value);
+    static WriteResult setLock(int id, int value);
     static int getPunch(int id);
-    static void setPunch(int id, int value);
-    static void torqueEnableSwitch(int id);
+    static WriteResult setPunch(int id, int value);
+    static QList<WriteResult> setPunch(const QList<int> &ids, int value);
+    static WriteResult torqueEnableSwitch(int id);
     static bool isInstructionRegistered(int id);
     static bool isMoving(int id);
     static int getPresentLoad(int id);
     static bool isEEPROMLocked(int id);
-    static void toggleWheelMode(int id);
-    static void toggleJointMode(int id, int newCWAngleLimit, int newCCWAngleLimit);
+    static WriteResult toggleWheelMode(int id);
+    static WriteResult toggleJointMode(int id, int newCWAngleLimit, int newCCWAngleLimit);
     static int getGoalPositionAngular(int id);
-    static void setGoalPositionAngular(int id, int angularPosition);
+    static WriteResult setGoalPositionAngular(int id, int angularPosition);
     static int getPresentPositionAngular(int id);
     static int getMovementMode(int id);
+    static QMap<int, int> getPresentPositions(const QList<int> &ids);
 
 private:
-    static void writeByteToDxl(int id, int address, int value);
-    static void writeWordToDxl(int id, int address, int value);
+    static WriteResult writeByteToDxl(int id, int address, int value);
+    static WriteResult writeWordToDxl(int id, int address, int value);
+    static WriteResult rangeError(int id);
+    static QList<WriteResult> rangeErrors(const QList<int> &ids);
     static int readByteFromDxl(int id, int address);
     static int readWordFromDxl(int id, int address);
 
@@ -0,0 +1,339 @@
+#include "asyncbus.h"
+#include "dynamixel_control.h"
+#include <QMutexLocker>
+#include <QMetaObject>
+
+
+// OPERATION: ******************************************************************
+
+BusOperation::BusOperation(Type type, BusArbiter::Priority priority) :
+    QObject(0),
+    operationType(type),
+    priority(priority),
+    dxlId(BROADCAST_ID),
+    startAddress(0),
+    length(0),
+    communicationResult(COMM_TXFAIL),
+    statusError(0),
+    done(false),
+    deleteWhenFinished(true)
+{
+}
+
+
+/**
+* Returns the transaction type
+* @return Read, Write, SyncWrite, BulkRead or Transmit
+*/
+BusOperation::Type BusOperation::type(void) const{
+    return operationType;
+}
+
+
+/**
+* Returns the addressed ID (BROADCAST_ID for SyncWrite and BulkRead)
+* @return Dynamixel ID
+*/
+int BusOperation::id(void) const{
+    return dxlId;
+}
+
+
+/**
+* Returns the first memory address (0 for BulkRead)
+* @return Memory address
+*/
+int BusOperation::address(void) const{
+    return startAddress;
+}
+
+
+/**
+* Returns whether the transaction has run
+* @return true/false
+*/
+bool BusOperation::isFinished(void) const{
+    return done;
+}
+
+
+/**
+* Returns the communication result (valid once finished)
+* @return COMM_* result
+*/
+int BusOperation::result(void) const{
+    return communicationResult;
+}
+
+
+/**
+* Returns the status packet error bits of a Read or Write (valid once finished)
+* @return Error bits (ERRBIT_*), 0 when no status packet was received
+*/
+int BusOperation::error(void) const{
+    return statusError;
+}
+
+
+/**
+* Returns the bytes read by a Read (valid once finished)
+* @return One entry per byte, empty on failure
+*/
+QVector<int> BusOperation::data(void) const{
+    return bytes;
+}
+
+
+/**
+* Returns the bytes read by a Read as one little-endian value,
+* e.g. a word for a two byte read
+* @return Value, -1 on failure
+*/
+int BusOperation::value(void) const{
+    if (operationType != Read || bytes.isEmpty()) return -1;
+    int result = 0;
+    for (int i = bytes.size() - 1; i >= 0; i--) result = (result << 8) | bytes.at(i);
+    return result;
+}
+
+
+/**
+* Returns the replies of a BulkRead (valid once finished)
+* @return One reply per request
+*/
+QList<BulkReadReply> BusOperation::replies(void) const{
+    return bulkReplies;
+}
+
+
+/**
+* Returns whether the operation deletes itself after finished()
+* @return true/false
+*/
+bool BusOperation::autoDelete(void) const{
+    return deleteWhenFinished;
+}
+
+
+/**
+* Sets whether the operation deletes itself after finished() (default: true)
+* @param enabled true/false
+*/
+void BusOperation::setAutoDelete(bool enabled){
+    deleteWhenFinished = enabled;
+}
+
+
+/**
+* Delivered by the bus I/O thread (queued) once the transaction has run
+*/
+void BusOperation::complete(void){
+    done = true;
+    emit finished(this);
+    if (deleteWhenFinished) deleteLater();
+}
+
+
+
+// BUS: ******************************************************************
+
+/**
+* Creates the bus front end and starts its I/O thread
+* @param parent Parent object
+*/
+AsyncBus::AsyncBus(QObject *parent) :
+    QThread(parent),
+    stopping(false)
+{
+    start(HighPriority);
+}
+
+
+/**
+* Stops the I/O thread
+*/
+AsyncBus::~AsyncBus(){
+    stop();
+}
+
+
+/**
+* Queues a block READ
+* @param id Dynamixel ID
+* @param address First memory address to read
+* @param length Number of bytes, range: 1-MAXNUM_RXPARAM
+* @param priority Bus priority class
+* @return Pending operation
+*/
+BusOperation *AsyncBus::read(int id, int address, int length, BusArbiter::Priority priority){
+    BusOperation *operation = new BusOperation(BusOperation::Read, priority);
+    operation->dxlId = id;
+    operation->startAddress = address;
+    operation->length = length;
+    return enqueue(operation);
+}
+
+
+/**
+* Queues a block WRITE
+* @param id Dynamixel ID
+* @param address First memory address to write
+* @param data One entry per byte
+* @param priority Bus priority class
+* @return Pending operation
+*/
+BusOperation *AsyncBus::write(int id, int address, const QVector<int> &data, BusArbiter::Priority priority){
+    BusOperation *operation = new BusOperation(BusOperation::Write, priority);
+    operation->dxlId = id;
+    operation->startAddress = address;
+    operation->bytes = data;
+    return enqueue(operation);
+}
+
+
+/**
+* Queues a SYNC_WRITE
+* @param address First memory address to write
+* @param length Bytes per device
+* @param data Bytes per ID
+* @param priority Bus priority class
+* @return Pending operation
+*/
+BusOperation *AsyncBus::syncWrite(int address, int length, const QMap<int, QVector<int> > &data, BusArbiter::Priority priority){
+    BusOperation *operation = new BusOperation(BusOperation::SyncWrite, priority);
+    operation->startAddress = address;
+    operation->length = length;
+    operation->syncData = data;
+    return enqueue(operation);
+}
+
+
+/**
+* Queues a bulk read
+* @param requests Devices and address ranges
+* @param priority Bus priority class
+* @return Pending operation
+*/
+BusOperation *AsyncBus::bulkRead(const QList<BulkReadRequest> &requests, BusArbiter::Priority priority){
+    BusOperation *operation = new BusOperation(BusOperation::BulkRead, priority);
+    operation->requests = requests;
+    return enqueue(operation);
+}
+
+
+/**
+* Returns the number of queued operations
+* @return Count
+*/
+int AsyncBus::pendingCount(void) const{
+    QMutexLocker locker(&queueMutex);
+    int count = 0;
+    for (int i = 0; i < BusArbiter::PriorityCount; i++) count += queues[i].size();
+    return count;
+}
+
+
+/**
+* Starts the I/O thread again after stop() (the constructor already starts it)
+* @param priority Thread priority
+*/
+void AsyncBus::start(Priority priority){
+    {
+        QMutexLocker locker(&queueMutex);
+        if (isRunning()) return;
+        stopping = false;
+    }
+    QThread::start(priority);
+}
+
+
+/**
+* Stops the I/O thread after the running transaction and waits for it.
+* Operations still queued, and operations queued until start() is called again,
+* finish with COMM_TXFAIL.
+*/
+void AsyncBus::stop(void){
+    {
+        QMutexLocker locker(&queueMutex);
+        stopping = true;
+        queueNotEmpty.wakeAll();
+    }
+    wait();
+
+    // Whatever is still queued finishes with COMM_TXFAIL
+    QMutexLocker locker(&queueMutex);
+    for (int i = 0; i < BusArbiter::PriorityCount; i++){
+        while (!queues[i].isEmpty()) QMetaObject::invokeMethod(queues[i].takeFirst(), "complete", Qt::QueuedConnection);
+    }
+}
+
+
+/**
+* Bus I/O loop
+*/
+void AsyncBus::run(){
+    forever{
+        BusOperation *operation = 0;
+        {
+            QMutexLocker locker(&queueMutex);
+            while (!stopping && operation == 0){
+                for (int i = 0; i < BusArbiter::PriorityCount && operation == 0; i++){
+                    if (!queues[i].isEmpty()) operation = queues[i].takeFirst();
+                }
+                if (operation == 0) queueNotEmpty.wait(&queueMutex);
+            }
+            if (stopping) return;
+        }
+
+        execute(operation);
+        QMetaObject::invokeMethod(operation, "complete", Qt::QueuedConnection);
+    }
+}
+
+
+BusOperation *AsyncBus::enqueue(BusOperation *operation){
+    QMutexLocker locker(&queueMutex);
+    if (stopping){
+        // no I/O thread to run it; complete it from the event loop like any other
+        QMetaObject::invokeMethod(operation, "complete", Qt::QueuedConnection);
+        return operation;
+    }
+    queues[operation->priority].append(operation);
+    queueNotEmpty.wakeOne();
+    return operation;
+}
+
+
+/**
+* Runs one operation on the bus (I/O thread)
+* @param operation Operation to run
+*/
+void AsyncBus::execute(BusOperation *operation){
+    switch (operation->operationType){
+    case BusOperation::Read:
+        operation->communicationResult = DynamixelBus::readBlock(operation->dxlId, operation->startAddress,
+                                                                 operation->length, operation->bytes, operation->priority,
+                                                                 &operation->statusError);
+        break;
+    case BusOperation::Write:
+        operation->communicationResult = DynamixelBus::writeBlock(operation->dxlId, operation->startAddress,
+                                                                  operation->bytes, operation->priority,
+                                                                  &operation->statusError);
+        break;
+    case BusOperation::SyncWrite:
+        operation->communicationResult = DynamixelBus::syncWrite(operation->startAddress, operation->length,
+                                                                 operation->syncData, operation->priority);
+        break;
+    case BusOperation::BulkRead:
+        operation->bulkReplies = DynamixelBus::bulkRead(operation->requests, operation->priority);
+        operation->communicationResult = COMM_RXSUCCESS;
+        foreach (const BulkReadReply &reply, operation->bulkReplies){
+            if (reply.result != COMM_RXSUCCESS) operation->communicationResult = reply.result;
+        }
+        break;
+    case BusOperation::Transmit:
+        foreach (const InstructionPacket &packet, operation->packets)
+            operation->communicationResult = DynamixelBus::transmitPacket(packet, operation->priority);
+        break;
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef ASYNCBUS_H
+#define ASYNCBUS_H
+#include "dynamixelbus.h"
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QMap>
+#include <QVector>
+
+
+/**
+ * @brief The BusOperation class : One asynchronous bus transaction.
+ * Created by AsyncBus; emits finished() in the thread that created it once the
+ * transaction has run. Deletes itself after finished() unless autoDelete is turned off.
+ */
+class BusOperation : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    enum Type {
+        Read,
+        Write,
+        SyncWrite,
+        BulkRead,
+        Transmit        // pre-encoded packets, see BusDriver::transmit
+    };
+
+    Type type(void) const;
+    int id(void) const;
+    int address(void) const;
+    bool isFinished(void) const;
+    int result(void) const;
+    int error(void) const;
+    QVector<int> data(void) const;
+    int value(void) const;
+    QList<BulkReadReply> replies(void) const;
+    bool autoDelete(void) const;
+    void setAutoDelete(bool enabled);
+
+signals:
+
+    void finished(BusOperation *operation);
+
+private slots:
+
+    void complete(void);
+
+private:
+
+    friend class AsyncBus;
+    friend class BusDriver;
+
+    BusOperation(Type type, BusArbiter::Priority priority);
+
+    Type operationType;
+    BusArbiter::Priority priority;
+    int dxlId;
+    int startAddress;
+    int length;
+    QVector<int> bytes;
+    QMap<int, QVector<int> > syncData;
+    QList<BulkReadRequest> requests;
+    QList<BulkReadReply> bulkReplies;
+    QList<InstructionPacket> packets;
+    int communicationResult;
+    int statusError;
+    bool done;
+    bool deleteWhenFinished;
+
+};
+
+
+/**
+ * @brief The AsyncBus class : Non-blocking front end to DynamixelBus.
+ * Transactions are queued (highest priority class first, FIFO within a class) and
+ * run on one bus I/O thread; results come back as BusOperation::finished() in the
+ * caller's event loop. Any number of logical tasks (joint supervisors, sensor
+ * watchers, ...) can keep transactions in flight from a single thread this way:
+ *
+ *     BusOperation *op = bus.read(4, ActuatorControl::controlTableAddress("present position(l)"), 2);
+ *     connect(op, SIGNAL(finished(BusOperation*)), this, SLOT(onPosition(BusOperation*)));
+ */
+class AsyncBus : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    explicit AsyncBus(QObject *parent = 0);
+    ~AsyncBus();
+
+    BusOperation *read(int id, int address, int length,
+                       BusArbiter::Priority priority = BusArbiter::Telemetry);
+    BusOperation *write(int id, int address, const QVector<int> &data,
+                        BusArbiter::Priority priority = BusArbiter::Control);
+    BusOperation *syncWrite(int address, int length, const QMap<int, QVector<int> > &data,
+                            BusArbiter::Priority priority = BusArbiter::Control);
+    BusOperation *bulkRead(const QList<BulkReadRequest> &requests,
+                           BusArbiter::Priority priority = BusArbiter::Telemetry);
+    int pendingCount(void) const;
+    void start(Priority priority = HighPriority);
+    void stop(void);
+
+protected:
+
+    void run();
+
+private:
+
+    BusOperation *enqueue(BusOperation *operation);
+    static void execute(BusOperation *operation);
+
+    mutable QMutex queueMutex;
+    QWaitCondition queueNotEmpty;
+    QList<BusOperation *> queues[BusArbiter::PriorityCount];
+    bool stopping;
+
+};
+
+#endif // ASYNCBUS_H
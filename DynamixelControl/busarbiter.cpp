@@ -0,0 +1,183 @@
+#include "busarbiter.h"
+#include <QMutexLocker>
+#include <QThread>
+
+const int DEFAULT_QUEUE_LIMITS[BusArbiter::PriorityCount] = { 16, 16, 8, 4 };
+const int DEFAULT_SHARES[BusArbiter::PriorityCount] = { 0, 8, 3, 1 }; // Safety is never rationed
+
+
+BusArbiter::BusArbiter() :
+    owner(0),
+    ownerPriority(Diagnostics),
+    depth(0),
+    preemptions(0)
+{
+    for (int i = 0; i < PriorityCount; i++){
+        limits[i] = DEFAULT_QUEUE_LIMITS[i];
+        shares[i] = DEFAULT_SHARES[i];
+        credits[i] = DEFAULT_SHARES[i];
+        rejected[i] = 0;
+    }
+}
+
+
+/**
+* Waits until the bus is granted to the calling thread. For the thread that
+* already holds it this is a preemption point: a waiting Safety request runs first.
+* @param priority Priority class of the transaction(s) to run
+* @return true if granted, false if the class queue was full
+*/
+bool BusArbiter::acquire(Priority priority){
+    Qt::HANDLE self = QThread::currentThreadId();
+    QMutexLocker locker(&mutex);
+
+    if (owner == self){
+        if (ownerPriority != Safety && !queues[Safety].isEmpty()){
+            Ticket ticket;
+            ticket.thread = self;
+            ticket.granted = false;
+            ticket.priority = ownerPriority;
+            ticket.depth = depth;
+            preempted.append(&ticket);
+            preemptions++;
+            owner = 0;
+            grantNext();
+            while (!ticket.granted) grantedCondition.wait(&mutex);
+        }
+        depth++;
+        return true;
+    }
+
+    bool queuesEmpty = preempted.isEmpty();
+    for (int i = 0; i < PriorityCount; i++) queuesEmpty = queuesEmpty && queues[i].isEmpty();
+    if (owner == 0 && queuesEmpty){
+        owner = self;
+        ownerPriority = priority;
+        depth = 1;
+        return true;
+    }
+
+    if (queues[priority].size() >= limits[priority]){
+        rejected[priority]++;
+        return false;
+    }
+
+    Ticket ticket;
+    ticket.thread = self;
+    ticket.granted = false;
+    ticket.priority = priority;
+    ticket.depth = 1;
+    queues[priority].append(&ticket);
+    while (!ticket.granted) grantedCondition.wait(&mutex);
+    return true;
+}
+
+
+/**
+* Releases one level of ownership; the bus goes to the next waiter when the
+* outermost acquire() is released
+*/
+void BusArbiter::release(void){
+    QMutexLocker locker(&mutex);
+    if (owner != QThread::currentThreadId() || --depth > 0) return;
+
+    owner = 0;
+    grantNext();
+}
+
+
+/**
+* Returns the maximum number of waiting transactions for a class
+* @param priority Priority class
+* @return Queue limit
+*/
+int BusArbiter::queueLimit(Priority priority) const{
+    QMutexLocker locker(&mutex);
+    return limits[priority];
+}
+
+
+/**
+* Sets the maximum number of waiting transactions for a class
+* @param priority Priority class
+* @param limit Queue limit, minimum 1
+*/
+void BusArbiter::setQueueLimit(Priority priority, int limit){
+    QMutexLocker locker(&mutex);
+    limits[priority] = qMax(1, limit);
+}
+
+
+/**
+* Returns the bandwidth share of a class
+* @param priority Priority class
+* @return Transactions per round under contention
+*/
+int BusArbiter::share(Priority priority) const{
+    QMutexLocker locker(&mutex);
+    return shares[priority];
+}
+
+
+/**
+* Sets the bandwidth share of a class (ignored for Safety, which is never rationed)
+* @param priority Priority class
+* @param weight Transactions per round under contention, minimum 1
+*/
+void BusArbiter::setShare(Priority priority, int weight){
+    if (priority == Safety) return;
+    QMutexLocker locker(&mutex);
+    shares[priority] = qMax(1, weight);
+    credits[priority] = qMin(credits[priority], shares[priority]);
+}
+
+
+/**
+* Returns how many acquire() calls were rejected because the class queue was full
+* @param priority Priority class
+* @return Rejected count
+*/
+int BusArbiter::rejectedCount(Priority priority) const{
+    QMutexLocker locker(&mutex);
+    return rejected[priority];
+}
+
+
+/**
+* Returns how often a holder stepped aside for a Safety request
+* @return Preemption count
+*/
+int BusArbiter::preemptionCount(void) const{
+    QMutexLocker locker(&mutex);
+    return preemptions;
+}
+
+
+/**
+* Hands the bus to the next waiter (mutex must be held).
+* Safety first, then a holder that stepped aside for it; otherwise the highest
+* class that still has credit in this round. A new round starts when no waiting
+* class has credit left.
+*/
+void BusArbiter::grantNext(void){
+    Ticket *ticket = 0;
+    if (!queues[Safety].isEmpty()) ticket = queues[Safety].takeFirst();
+    else if (!preempted.isEmpty()) ticket = preempted.takeFirst();
+
+    for (int round = 0; ticket == 0 && round < 2; round++){
+        for (int i = Control; i < PriorityCount && ticket == 0; i++){
+            if (!queues[i].isEmpty() && credits[i] > 0){
+                credits[i]--;
+                ticket = queues[i].takeFirst();
+            }
+        }
+        if (ticket == 0) for (int i = Control; i < PriorityCount; i++) credits[i] = shares[i];
+    }
+    if (ticket == 0) return;
+
+    ticket->granted = true;
+    owner = ticket->thread;
+    ownerPriority = ticket->priority;
+    depth = ticket->depth;
+    grantedCondition.wakeAll();
+}
@@ -0,0 +1,74 @@
+#ifndef BUSARBITER_H
+#define BUSARBITER_H
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+
+/**
+ * @brief The BusArbiter class : Grants the Dynamixel bus to one thread at a time,
+ * by priority class.
+ *
+ * Safety requests always go first. Control, Telemetry and Diagnostics share the
+ * remaining slots by weight (transactions per round), so under contention control
+ * traffic waits for at most one background transaction per share, while background
+ * traffic still fills every idle slot. Each class has a bounded wait queue;
+ * acquire() fails instead of queueing when its class queue is full.
+ * The bus is re-entrant for the thread that holds it.
+ *
+ * A thread holding the bus across several transactions (DynamixelBus::Lock) takes
+ * it again for each one, and that nested acquire() is a preemption point: if Safety
+ * is waiting, the holder hands the bus over, waits until Safety is done and gets it
+ * back ahead of every other class. Safety thus waits for at most one transaction,
+ * however long another thread holds the bus.
+ */
+class BusArbiter
+{
+public:
+
+    enum Priority {
+        Safety,
+        Control,
+        Telemetry,
+        Diagnostics
+    };
+    static const int PriorityCount = 4;
+
+    BusArbiter();
+
+    bool acquire(Priority priority);
+    void release(void);
+
+    int queueLimit(Priority priority) const;
+    void setQueueLimit(Priority priority, int limit);
+    int share(Priority priority) const;
+    void setShare(Priority priority, int weight);
+    int rejectedCount(Priority priority) const;
+    int preemptionCount(void) const;
+
+private:
+
+    struct Ticket {
+        Qt::HANDLE thread;
+        bool granted;
+        Priority priority;
+        int depth;          // nesting restored when the bus is granted
+    };
+
+    void grantNext(void);
+
+    mutable QMutex mutex;
+    QWaitCondition grantedCondition;
+    Qt::HANDLE owner;
+    Priority ownerPriority;
+    int depth;
+    QList<Ticket *> queues[PriorityCount];
+    QList<Ticket *> preempted;      // holders that stepped aside for Safety
+    int preemptions;
+    int limits[PriorityCount];
+    int shares[PriorityCount];
+    int credits[PriorityCount];
+    int rejected[PriorityCount];
+
+};
+
+#endif // BUSARBITER_H
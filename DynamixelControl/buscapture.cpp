@@ -0,0 +1,308 @@
+#include "buscapture.h"
+#include <QDateTime>
+#include <QFile>
+#include <string.h>
+
+const quint32 PCAP_MAGIC_NSEC = 0xA1B23C4D;    // pcap with nanosecond timestamps
+const int PCAP_HEADER_SIZE = 24;
+const int PCAP_RECORD_HEADER_SIZE = 16;
+const int BATCH_BYTES = 64 * 1024;
+const int IDLE_USEC = 1000;
+
+
+static inline void putWord32(QByteArray &out, quint32 value){
+    for (int shift = 0; shift < 32; shift += 8) out.append((char)((value >> shift) & 0xFF));
+}
+
+static inline quint32 getWord32(const QByteArray &in, int offset){
+    quint32 value = 0;
+    for (int i = 3; i >= 0; i--) value = (value << 8) | (quint8)in.at(offset + i);
+    return value;
+}
+
+
+struct BusCapture::Cell
+{
+    QBasicAtomicInt sequence;   // position + 1 when full, position + capacity when free
+    qint64 timestamp;
+    qint16 bus;
+    qint16 direction;
+    qint32 size;
+    quint8 data[MaxFrame];
+};
+
+
+BusCapture::BusCapture(QObject *parent) :
+    QThread(parent),
+    cells(new Cell[Capacity]),
+    head(0),
+    tail(0),
+    dropped(0),
+    written(0),
+    capturing(0),
+    recording(0),
+    epochNsec(0),
+    file(0)
+{
+}
+
+
+/**
+* Stops capturing and closes the file
+*/
+BusCapture::~BusCapture(){
+    close();
+    delete[] cells;
+}
+
+
+/**
+* Creates (truncates) a capture file and starts the capture thread.
+* Open the capture before the transports start recording into it.
+* @param fileName Path of the pcap file
+* @return true if the file was created
+*/
+bool BusCapture::open(const QString &fileName){
+    close();
+
+    file = new QFile(fileName);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)){
+        error = file->errorString();
+        delete file;
+        file = 0;
+        return false;
+    }
+
+    QByteArray header;
+    putWord32(header, PCAP_MAGIC_NSEC);
+    putWord32(header, 2 | (4 << 16));       // version 2.4
+    putWord32(header, 0);                   // GMT
+    putWord32(header, 0);                   // timestamp accuracy
+    putWord32(header, MaxFrame + PseudoHeaderSize);
+    putWord32(header, LinkType);
+    file->write(header);
+
+    head.store(0);
+    tail.store(0);
+    for (int i = 0; i < Capacity; i++) cells[i].sequence.store(i);
+    dropped.store(0);
+    written.store(0);
+
+    epochNsec = QDateTime::currentMSecsSinceEpoch() * 1000000LL;
+    clock.start();
+    error.clear();
+    start(LowPriority);
+    capturing.store(1);
+    return true;
+}
+
+
+/**
+* Writes everything still in the ring, stops the capture thread and closes the file.
+* Waits for record() calls that are still copying into the ring, so none of them
+* ends up in the ring of the next open().
+*/
+void BusCapture::close(void){
+    if (file == 0) return;
+    capturing.fetchAndStoreOrdered(0);
+    while (recording.load() != 0) yieldCurrentThread();
+    requestInterruption();
+    wait();
+
+    file->close();
+    delete file;
+    file = 0;
+}
+
+
+/**
+* Returns whether a capture file is open
+* @return true/false
+*/
+bool BusCapture::isOpen(void) const{
+    return file != 0;
+}
+
+
+/**
+* Returns the reason the last open() failed
+* @return Error message
+*/
+QString BusCapture::errorString(void) const{
+    return error;
+}
+
+
+/**
+* Records one frame. Safe to call from any thread; costs a timestamp, three atomic
+* operations, a compare and swap and a copy of the bytes. Frames longer than
+* MaxFrame are truncated (their full size is kept), frames that find the ring full
+* are dropped.
+* @param bus Bus index, range: 0-255
+* @param direction Transmit for instruction packets, Receive for bytes read from the port
+* @param data Bytes as written to or read from the port
+* @param size Number of bytes
+*/
+void BusCapture::record(int bus, Direction direction, const char *data, int size){
+    if (size <= 0) return;
+    // counted before capturing is checked: close() clears capturing first, then waits for the count
+    recording.ref();
+    if (capturing.fetchAndAddOrdered(0) != 0) push(bus, direction, data, size);
+    recording.deref();
+}
+
+
+/**
+* Records one frame, see record(int, Direction, const char *, int)
+* @param bus Bus index, range: 0-255
+* @param direction Transmit or Receive
+* @param data Bytes as written to or read from the port
+*/
+void BusCapture::record(int bus, Direction direction, const QByteArray &data){
+    record(bus, direction, data.constData(), data.size());
+}
+
+
+/**
+* Returns the number of frames written to the file since open()
+* @return Frame count
+*/
+int BusCapture::capturedFrames(void) const{
+    return written.load();
+}
+
+
+/**
+* Returns the number of frames dropped because the ring was full
+* @return Frame count
+*/
+int BusCapture::droppedFrames(void) const{
+    return dropped.load();
+}
+
+
+/**
+* Reads and checks the file header of a capture
+* @param device Capture file, positioned at its start
+* @return true if the device holds a BusCapture pcap file
+*/
+bool BusCapture::readHeader(QIODevice *device){
+    QByteArray header = device->read(PCAP_HEADER_SIZE);
+    if (header.size() != PCAP_HEADER_SIZE) return false;
+    return getWord32(header, 0) == PCAP_MAGIC_NSEC && getWord32(header, 20) == (quint32)LinkType;
+}
+
+
+/**
+* Reads the next frame of a capture
+* @param device Capture file, positioned after the header (see readHeader)
+* @param frame Receives the frame
+* @return false at the end of the file or on a truncated record
+*/
+bool BusCapture::readFrame(QIODevice *device, CapturedFrame &frame){
+    QByteArray header = device->read(PCAP_RECORD_HEADER_SIZE);
+    if (header.size() != PCAP_RECORD_HEADER_SIZE) return false;
+
+    int included = getWord32(header, 8);
+    if (included < PseudoHeaderSize || included > MaxFrame + PseudoHeaderSize) return false;
+    QByteArray record = device->read(included);
+    if (record.size() != included) return false;
+
+    frame.timestamp = getWord32(header, 0) * 1000000000LL + getWord32(header, 4);
+    frame.bus = (quint8)record.at(0);
+    frame.direction = (quint8)record.at(1);
+    frame.size = getWord32(header, 12) - PseudoHeaderSize;
+    frame.bytes = record.mid(PseudoHeaderSize);
+    return true;
+}
+
+
+/**
+* Capture thread: drains the ring into the file until close() and the ring is empty
+*/
+void BusCapture::run(){
+    QByteArray batch;
+    batch.reserve(BATCH_BYTES + PCAP_RECORD_HEADER_SIZE + PseudoHeaderSize + MaxFrame);
+
+    forever {
+        bool stopping = isInterruptionRequested();
+        int count = drain(batch);
+        if (batch.size() >= BATCH_BYTES || (count == 0 && !batch.isEmpty())){
+            file->write(batch);
+            batch.clear();
+        }
+        if (count > 0) continue;
+        if (stopping) break;
+        usleep(IDLE_USEC);
+    }
+    file->flush();
+}
+
+
+// INTERNAL SUBROUTINES (private) ************************************************************************
+
+/**
+* Claims a free cell and copies a frame into it, or drops the frame if the ring is full
+* @param bus Bus index
+* @param direction Transmit or Receive
+* @param data Bytes
+* @param size Number of bytes, at least 1
+*/
+void BusCapture::push(int bus, Direction direction, const char *data, int size){
+    qint64 timestamp = clock.nsecsElapsed();
+
+    Cell *cell = 0;
+    int position = tail.load();
+    forever {
+        cell = &cells[(quint32)position % Capacity];
+        int difference = (int)((quint32)cell->sequence.loadAcquire() - (quint32)position);
+        if (difference == 0){
+            if (tail.testAndSetOrdered(position, position + 1)) break;
+            position = tail.load();
+        } else if (difference < 0){
+            dropped.fetchAndAddRelaxed(1);      // full
+            return;
+        } else {
+            position = tail.load();
+        }
+    }
+
+    cell->timestamp = timestamp;
+    cell->bus = bus;
+    cell->direction = direction;
+    cell->size = size;
+    memcpy(cell->data, data, qMin(size, (int)MaxFrame));
+    cell->sequence.storeRelease(position + 1);
+}
+
+
+/**
+* Moves every full cell into the batch as a pcap record (capture thread)
+* @param batch Receives the records
+* @return Number of frames moved
+*/
+int BusCapture::drain(QByteArray &batch){
+    int count = 0;
+    int position = head.load();
+    while (batch.size() < BATCH_BYTES){
+        Cell &cell = cells[(quint32)position % Capacity];
+        if (cell.sequence.loadAcquire() != position + 1) break;
+
+        qint64 timestamp = epochNsec + cell.timestamp;
+        int captured = qMin((int)cell.size, (int)MaxFrame);
+        putWord32(batch, timestamp / 1000000000LL);
+        putWord32(batch, timestamp % 1000000000LL);
+        putWord32(batch, captured + PseudoHeaderSize);
+        putWord32(batch, cell.size + PseudoHeaderSize);
+        batch.append((char)cell.bus);
+        batch.append((char)cell.direction);
+        batch.append((const char*)cell.data, captured);
+
+        cell.sequence.storeRelease(position + Capacity);
+        position++;
+        count++;
+    }
+    head.store(position);
+    written.fetchAndAddRelaxed(count);
+    return count;
+}
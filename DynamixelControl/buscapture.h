@@ -0,0 +1,90 @@
+#ifndef BUSCAPTURE_H
+#define BUSCAPTURE_H
+#include <QThread>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QString>
+
+class QFile;
+class QIODevice;
+
+/**
+ * @brief The CapturedFrame struct : One chunk of bus traffic as read back from a capture file
+ */
+struct CapturedFrame
+{
+    qint64 timestamp;   // nanoseconds since the Unix epoch
+    int bus;            // bus index given to BusCapture::record()
+    int direction;      // BusCapture::Transmit or BusCapture::Receive
+    int size;           // bytes on the wire; bytes is shorter if the frame was truncated
+    QByteArray bytes;
+};
+
+
+/**
+ * @brief The BusCapture class : Records raw bus traffic into a pcap file.
+ *
+ * Transports call record() with every instruction packet they write (Transmit)
+ * and every chunk their port returns (Receive), DynamixelBus with the packets of
+ * every DLL transaction. record() copies the bytes into a
+ * fixed ring of cells and returns; it takes no lock, never allocates and never
+ * blocks, and frames that find the ring full are counted and dropped. The capture
+ * thread drains the ring into the file in batches.
+ *
+ * The file is a standard pcap file with nanosecond timestamps and link type
+ * LINKTYPE_USER0 (147). Every record starts with a two byte pseudo header (bus
+ * index, direction) followed by the bytes as they were on the wire, so the file
+ * opens in Wireshark as well as in BusTrafficAnalyzer.
+ */
+class BusCapture : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    enum Direction { Transmit = 0, Receive = 1 };
+    enum { Capacity = 4096, MaxFrame = 256, PseudoHeaderSize = 2, LinkType = 147 };
+
+    explicit BusCapture(QObject *parent = 0);
+    ~BusCapture();
+
+    bool open(const QString &fileName);
+    void close(void);
+    bool isOpen(void) const;
+    QString errorString(void) const;
+
+    void record(int bus, Direction direction, const char *data, int size);
+    void record(int bus, Direction direction, const QByteArray &data);
+    int capturedFrames(void) const;
+    int droppedFrames(void) const;
+
+    static bool readHeader(QIODevice *device);
+    static bool readFrame(QIODevice *device, CapturedFrame &frame);
+
+protected:
+
+    void run();
+
+private:
+
+    struct Cell;
+
+    void push(int bus, Direction direction, const char *data, int size);
+    int drain(QByteArray &batch);
+
+    Cell *cells;
+    QAtomicInt head;        // consumer position, capture thread only
+    QAtomicInt tail;        // producer position, claimed by CAS
+    QAtomicInt dropped;
+    QAtomicInt written;
+    QAtomicInt capturing;   // record() only while a file is open
+    QAtomicInt recording;   // record() calls in progress, close() waits for them
+    QElapsedTimer clock;
+    qint64 epochNsec;
+    QFile *file;
+    QString error;
+
+};
+
+#endif // BUSCAPTURE_H
@@ -0,0 +1,157 @@
+#include "busclient.h"
+#include "busdaemon.h"
+#include "dynamixel_control.h"
+#include <QLocalSocket>
+#include <QElapsedTimer>
+
+const int DEFAULT_TIMEOUT = 100;                // ms, several daemon ticks
+
+
+BusClient::BusClient(QObject *parent) :
+    QObject(parent),
+    socket(new QLocalSocket(this)),
+    nextTag(1),
+    error(0),
+    timeoutMsec(DEFAULT_TIMEOUT)
+{
+}
+
+
+BusClient::~BusClient(){
+    disconnectFromDaemon();
+}
+
+
+/**
+* Connects to a daemon
+* @param name Server name the daemon listens on
+* @param timeoutMsec Connection timeout
+* @return true on success
+*/
+bool BusClient::connectToDaemon(const QString &name, int timeoutMsec){
+    buffer.clear();
+    socket->connectToServer(name);
+    return socket->waitForConnected(timeoutMsec);
+}
+
+
+/**
+* Disconnects from the daemon
+*/
+void BusClient::disconnectFromDaemon(void){
+    if (socket->state() != QLocalSocket::UnconnectedState) socket->disconnectFromServer();
+}
+
+
+/**
+* Returns whether the client is connected
+* @return true/false
+*/
+bool BusClient::isConnected(void) const{
+    return socket->state() == QLocalSocket::ConnectedState;
+}
+
+
+/**
+* Reads a register range through the daemon
+* @param id Dynamixel ID
+* @param address Start address
+* @param length Number of bytes, range: 1-248 (BusDaemon::MaxFrameSize - BusDaemon::HeaderSize)
+* @param data Receives the bytes read
+* @return Communication result, COMM_RXSUCCESS on success; error bits via lastError()
+*/
+int BusClient::readBlock(int id, int address, int length, QVector<int> &data){
+    return transact(BusDaemon::Read, id, address, length, QVector<int>(), data);
+}
+
+
+/**
+* Writes a register range through the daemon
+* @param id Dynamixel ID, BROADCAST_ID for all
+* @param address Start address
+* @param data Bytes to write, 1-248 entries (BusDaemon::MaxFrameSize - BusDaemon::HeaderSize)
+* @return Communication result; error bits via lastError()
+*/
+int BusClient::writeBlock(int id, int address, const QVector<int> &data){
+    QVector<int> reply;
+    return transact(BusDaemon::Write, id, address, data.size(), data, reply);
+}
+
+
+/**
+* Returns the status packet error bits of the last read or write
+* @return Error bits (ERRBIT_*)
+*/
+int BusClient::lastError(void) const{
+    return error;
+}
+
+
+/**
+* Returns how long a call waits for its reply
+* @return Milliseconds
+*/
+int BusClient::timeout(void) const{
+    return timeoutMsec;
+}
+
+
+/**
+* Sets how long a call waits for its reply
+* @param msec Milliseconds
+*/
+void BusClient::setTimeout(int msec){
+    timeoutMsec = msec;
+}
+
+
+// INTERNAL SUBROUTINES (private) ************************************************************************
+
+/**
+* Sends one request frame and waits for the reply carrying its tag
+* @return Communication result, COMM_RXTIMEOUT if no reply arrived in time
+*/
+int BusClient::transact(int opcode, int id, int address, int length,
+                        const QVector<int> &payload, QVector<int> &reply){
+    reply.clear();
+    error = 0;
+    if (!isConnected() || length < 1 || length > BusDaemon::MaxFrameSize - BusDaemon::HeaderSize) return COMM_TXFAIL;
+
+    quint32 tag = nextTag++;
+    int size = BusDaemon::HeaderSize + payload.size();
+    QByteArray frame;
+    frame.reserve(2 + size);
+    frame.append((char)(size & 0xFF));
+    frame.append((char)(size >> 8));
+    frame.append((char)opcode);
+    for (int shift = 0; shift < 32; shift += 8) frame.append((char)((tag >> shift) & 0xFF));
+    frame.append((char)id);
+    frame.append((char)address);
+    frame.append((char)length);
+    foreach (int value, payload) frame.append((char)value);
+    socket->write(frame);
+
+    QElapsedTimer clock;
+    clock.start();
+    forever {
+        while (buffer.size() >= 2){
+            int replySize = (quint8)buffer.at(0) | ((quint8)buffer.at(1) << 8);
+            if (buffer.size() < 2 + replySize) break;
+            QByteArray replyFrame = buffer.mid(2, replySize);
+            buffer.remove(0, 2 + replySize);
+
+            quint32 replyTag = (quint8)replyFrame.at(1) | ((quint8)replyFrame.at(2) << 8) |
+                    ((quint8)replyFrame.at(3) << 16) | ((quint32)(quint8)replyFrame.at(4) << 24);
+            if (replyTag != tag) continue; // a reply to a call that timed out earlier
+
+            int result = (quint8)replyFrame.at(5);
+            error = (quint8)replyFrame.at(6);
+            for (int i = BusDaemon::HeaderSize; i < replyFrame.size(); i++) reply << (quint8)replyFrame.at(i);
+            return result;
+        }
+
+        qint64 remaining = timeoutMsec - clock.elapsed();
+        if (remaining <= 0 || !socket->waitForReadyRead(remaining)) return COMM_RXTIMEOUT;
+        buffer.append(socket->readAll());
+    }
+}
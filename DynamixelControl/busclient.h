@@ -0,0 +1,49 @@
+#ifndef BUSCLIENT_H
+#define BUSCLIENT_H
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+
+class QLocalSocket;
+
+/**
+ * @brief The BusClient class : Blocking client of a BusDaemon.
+ *
+ * Gives a process that does not own the port the same block read and write calls
+ * as DynamixelBus. Each call sends one tagged frame and waits for its reply; the
+ * daemon merges it with other clients' requests of the same tick.
+ */
+class BusClient : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit BusClient(QObject *parent = 0);
+    ~BusClient();
+
+    bool connectToDaemon(const QString &name, int timeoutMsec = 1000);
+    void disconnectFromDaemon(void);
+    bool isConnected(void) const;
+
+    int readBlock(int id, int address, int length, QVector<int> &data);
+    int writeBlock(int id, int address, const QVector<int> &data);
+    int lastError(void) const;
+
+    int timeout(void) const;
+    void setTimeout(int msec);
+
+private:
+
+    int transact(int opcode, int id, int address, int length,
+                 const QVector<int> &payload, QVector<int> &reply);
+
+    QLocalSocket *socket;
+    QByteArray buffer;
+    quint32 nextTag;
+    int error;
+    int timeoutMsec;
+
+};
+
+#endif // BUSCLIENT_H
@@ -0,0 +1,299 @@
+#include "busdaemon.h"
+#include "dynamixelbus.h"
+#include "dynamixel_control.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+#include <QMap>
+#include <QPair>
+
+const int DEFAULT_TICK_INTERVAL = 5;            // ms
+
+
+BusDaemon::BusDaemon(QObject *parent) :
+    QObject(parent),
+    server(new QLocalServer(this)),
+    tickTimer(new QTimer(this)),
+    requests(0),
+    transactions(0),
+    mergedReads(0)
+{
+    tickTimer->setInterval(DEFAULT_TICK_INTERVAL);
+    connect(server, SIGNAL(newConnection()), this, SLOT(acceptClients()));
+    connect(tickTimer, SIGNAL(timeout()), this, SLOT(runTick()));
+}
+
+
+BusDaemon::~BusDaemon(){
+    close();
+}
+
+
+/**
+* Starts serving; a socket left behind by a crashed daemon is removed first
+* @param name Server name, e.g. "dynamixel" (/tmp/dynamixel on Linux, \\.\pipe\dynamixel on Windows)
+* @return true on success, see errorString() otherwise
+*/
+bool BusDaemon::listen(const QString &name){
+    QLocalServer::removeServer(name);
+    if (!server->listen(name)) return false;
+    tickTimer->start();
+    return true;
+}
+
+
+/**
+* Stops serving and disconnects every client; pending requests are dropped
+*/
+void BusDaemon::close(void){
+    tickTimer->stop();
+    server->close();
+    pending.clear();
+    QList<QLocalSocket*> clients = buffers.keys();
+    buffers.clear();
+    foreach (QLocalSocket *client, clients){
+        client->disconnect(this);
+        client->abort();
+        client->deleteLater();
+    }
+}
+
+
+/**
+* Returns the last server error
+* @return Error description
+*/
+QString BusDaemon::errorString(void) const{
+    return server->errorString();
+}
+
+
+/**
+* Returns the batching interval
+* @return Milliseconds
+*/
+int BusDaemon::tickInterval(void) const{
+    return tickTimer->interval();
+}
+
+
+/**
+* Sets the batching interval; longer ticks merge more requests at the cost of latency
+* @param msec Milliseconds, range: 1-1000
+*/
+void BusDaemon::setTickInterval(int msec){
+    tickTimer->setInterval(qBound(1, msec, 1000));
+}
+
+
+/**
+* Returns the number of connected clients
+* @return Number of clients
+*/
+int BusDaemon::clientCount(void) const{
+    return buffers.size();
+}
+
+
+/**
+* Returns the number of requests answered since construction
+* @return Number of requests
+*/
+qint64 BusDaemon::requestCount(void) const{
+    return requests;
+}
+
+
+/**
+* Returns the number of bus transactions issued on behalf of clients
+* @return Number of transactions
+*/
+qint64 BusDaemon::transactionCount(void) const{
+    return transactions;
+}
+
+
+/**
+* Returns the number of reads answered from another client's identical read in the same tick
+* @return Number of reads
+*/
+qint64 BusDaemon::mergedReadCount(void) const{
+    return mergedReads;
+}
+
+
+// SLOTS (private) ***************************************************************************************
+
+void BusDaemon::acceptClients(void){
+    while (server->hasPendingConnections()){
+        QLocalSocket *client = server->nextPendingConnection();
+        buffers.insert(client, QByteArray());
+        connect(client, SIGNAL(readyRead()), this, SLOT(readClient()));
+        connect(client, SIGNAL(disconnected()), this, SLOT(dropClient()));
+    }
+}
+
+
+void BusDaemon::readClient(void){
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(sender());
+    if (client == 0 || !buffers.contains(client)) return;
+
+    QByteArray &buffer = buffers[client];
+    buffer.append(client->readAll());
+
+    while (buffer.size() >= 2){
+        int size = (quint8)buffer.at(0) | ((quint8)buffer.at(1) << 8);
+        if (size < HeaderSize || size > MaxFrameSize){
+            // the stream is out of step; nothing after this point can be trusted
+            buffer.clear();
+            client->abort();
+            return;
+        }
+        if (buffer.size() < 2 + size) break;
+        parseFrame(client, buffer.mid(2, size));
+        buffer.remove(0, 2 + size);
+    }
+}
+
+
+void BusDaemon::dropClient(void){
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(sender());
+    if (client == 0) return;
+
+    buffers.remove(client);
+    for (int i = pending.size() - 1; i >= 0; i--){
+        if (pending.at(i).client == client) pending.removeAt(i);
+    }
+    client->deleteLater();
+}
+
+
+/**
+* Executes everything queued since the last tick: broadcast writes, merged writes, then deduplicated reads
+*/
+void BusDaemon::runTick(void){
+    if (pending.isEmpty()) return;
+    QList<Request> batch = pending;
+    pending.clear();
+
+    // broadcast writes go out on their own, in arrival order; they must not end up inside a SYNC_WRITE
+    QHash<int, WriteResult> broadcastResults;
+    for (int i = 0; i < batch.size(); i++){
+        const Request &request = batch.at(i);
+        if (request.opcode != Write || request.id != BROADCAST_ID) continue;
+        WriteResult written = { BROADCAST_ID, COMM_TXFAIL, 0 };
+        written.result = DynamixelBus::writeBlock(BROADCAST_ID, request.address, request.data, BusArbiter::Control, &written.error);
+        broadcastResults.insert(i, written);
+        transactions++;
+    }
+
+    // other writes: as few packets per (address, length) as writeFleet can manage; a later write to the same ID wins
+    QMap<QPair<int, int>, QMap<int, QVector<int> > > writeGroups;
+    foreach (const Request &request, batch){
+        if (request.opcode == Write && request.id != BROADCAST_ID)
+            writeGroups[qMakePair(request.address, request.length)][request.id] = request.data;
+    }
+    QMap<QPair<int, int>, QMap<int, WriteResult> > writeResults;
+    QMap<QPair<int, int>, QMap<int, QVector<int> > >::const_iterator group;
+    for (group = writeGroups.constBegin(); group != writeGroups.constEnd(); ++group){
+        QList<WriteResult> results = DynamixelBus::writeFleet(group.key().first, group.key().second, group.value());
+        foreach (const WriteResult &written, results) writeResults[group.key()].insert(written.id, written);
+        transactions++;
+    }
+
+    // reads: identical (id, address, length) triples are read once
+    QList<BulkReadRequest> reads;
+    QHash<quint32, int> readIndex;
+    foreach (const Request &request, batch){
+        if (request.opcode != Read) continue;
+        quint32 key = (request.id << 16) | (request.address << 8) | request.length;
+        if (readIndex.contains(key)){
+            mergedReads++;
+            continue;
+        }
+        readIndex.insert(key, reads.size());
+        BulkReadRequest read = { request.id, request.address, request.length };
+        reads << read;
+    }
+    QList<BulkReadReply> replies;
+    if (!reads.isEmpty()){
+        replies = DynamixelBus::bulkRead(reads);
+        transactions += reads.size();
+    }
+
+    for (int i = 0; i < batch.size(); i++){
+        const Request &request = batch.at(i);
+        if (request.opcode == Write){
+            WriteResult written = request.id == BROADCAST_ID ? broadcastResults.value(i)
+                                                             : writeResults[qMakePair(request.address, request.length)].value(request.id);
+            sendReply(request.client, request, written.result, written.error, QVector<int>());
+        } else {
+            quint32 key = (request.id << 16) | (request.address << 8) | request.length;
+            const BulkReadReply &reply = replies.at(readIndex.value(key));
+            sendReply(request.client, request, reply.result, reply.error, reply.data);
+        }
+        requests++;
+    }
+}
+
+
+// INTERNAL SUBROUTINES (private) ************************************************************************
+
+/**
+* Decodes one frame (without its size field) and queues it for the next tick
+* @param client Connection the frame arrived on
+* @param frame Frame bytes
+* @return true if the frame was valid
+*/
+bool BusDaemon::parseFrame(QLocalSocket *client, const QByteArray &frame){
+    Request request;
+    request.client = client;
+    request.opcode = (quint8)frame.at(0);
+    request.tag = (quint8)frame.at(1) | ((quint8)frame.at(2) << 8) |
+            ((quint8)frame.at(3) << 16) | ((quint32)(quint8)frame.at(4) << 24);
+    request.id = (quint8)frame.at(5);
+    request.address = (quint8)frame.at(6);
+    request.length = (quint8)frame.at(7);
+
+    bool valid = request.length > 0 && request.id <= BROADCAST_ID;
+    if (valid && request.opcode == Write){
+        valid = frame.size() == HeaderSize + request.length;
+        for (int i = 0; valid && i < request.length; i++) request.data << (quint8)frame.at(HeaderSize + i);
+    } else if (valid && request.opcode == Read){
+        valid = frame.size() == HeaderSize && request.id != BROADCAST_ID;
+    } else {
+        valid = false;
+    }
+
+    if (!valid){
+        sendReply(client, request, COMM_TXERROR, 0, QVector<int>());
+        return false;
+    }
+    pending << request;
+    return true;
+}
+
+
+/**
+* Encodes and sends one reply frame
+* @param client Connection to answer on
+* @param request Request being answered
+* @param result Communication result
+* @param error Status packet error bits
+* @param data Bytes read, empty for writes
+*/
+void BusDaemon::sendReply(QLocalSocket *client, const Request &request,
+                          int result, int error, const QVector<int> &data){
+    int size = HeaderSize + data.size();
+    QByteArray frame;
+    frame.reserve(2 + size);
+    frame.append((char)(size & 0xFF));
+    frame.append((char)(size >> 8));
+    frame.append((char)request.opcode);
+    for (int shift = 0; shift < 32; shift += 8) frame.append((char)((request.tag >> shift) & 0xFF));
+    frame.append((char)result);
+    frame.append((char)error);
+    frame.append((char)data.size());
+    foreach (int value, data) frame.append((char)value);
+    client->write(frame);
+}
@@ -0,0 +1,89 @@
+#ifndef BUSDAEMON_H
+#define BUSDAEMON_H
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+class QLocalServer;
+class QLocalSocket;
+class QTimer;
+
+/**
+ * @brief The BusDaemon class : Serves the bus to other processes over a local socket.
+ *
+ * The daemon owns the port (dxl_initialize is called by the hosting process) and
+ * listens on a QLocalServer, a Unix domain socket on Linux and a named pipe on
+ * Windows. Requests from all clients are collected for one tick and then executed
+ * together: identical reads are issued once and fanned out to every requester,
+ * the remaining reads go out as one bulk read, and writes to the same register
+ * range are merged into one SYNC_WRITE (DynamixelBus::writeFleet). Writes to
+ * BROADCAST_ID are sent on their own, ahead of the merged ones. Every request is
+ * answered on its own connection with the tag it was sent with.
+ *
+ * Frames are little-endian, like the Dynamixel packets themselves:
+ *   request  [size:2][opcode:1][tag:4][id:1][address:1][length:1][data:length, writes only]
+ *   reply    [size:2][opcode:1][tag:4][result:1][error:1][length:1][data:length, reads only]
+ * where size counts the bytes following it (at most MaxFrameSize), result is a COMM_*
+ * code and error holds the status packet error bits; merged writes are not answered
+ * by the devices and report 0.
+ */
+class BusDaemon : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    enum Opcode { Read = 1, Write = 2 };
+    enum { HeaderSize = 8, MaxFrameSize = 256 };
+
+    explicit BusDaemon(QObject *parent = 0);
+    ~BusDaemon();
+
+    bool listen(const QString &name);
+    void close(void);
+    QString errorString(void) const;
+
+    int tickInterval(void) const;
+    void setTickInterval(int msec);
+    int clientCount(void) const;
+    qint64 requestCount(void) const;
+    qint64 transactionCount(void) const;
+    qint64 mergedReadCount(void) const;
+
+private slots:
+
+    void acceptClients(void);
+    void readClient(void);
+    void dropClient(void);
+    void runTick(void);
+
+private:
+
+    struct Request
+    {
+        QLocalSocket *client;
+        int opcode;
+        quint32 tag;
+        int id;
+        int address;
+        int length;
+        QVector<int> data;
+    };
+
+    bool parseFrame(QLocalSocket *client, const QByteArray &frame);
+    static void sendReply(QLocalSocket *client, const Request &request,
+                          int result, int error, const QVector<int> &data);
+
+    QLocalServer *server;
+    QTimer *tickTimer;
+    QHash<QLocalSocket*, QByteArray> buffers;
+    QList<Request> pending;
+    qint64 requests;
+    qint64 transactions;
+    qint64 mergedReads;
+
+};
+
+#endif // BUSDAEMON_H
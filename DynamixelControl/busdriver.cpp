@@ -0,0 +1,425 @@
+#include "busdriver.h"
+#include "dynamixel_control.h"
+#include <QSerialPort>
+#include <QTimer>
+#include <QMetaObject>
+
+const int DEFAULT_TIMEOUT = 20;                 // ms
+
+
+BusDriver::BusDriver(QObject *parent) :
+    QObject(parent),
+    port(new QSerialPort(this)),
+    timeoutTimer(new QTimer(this)),
+    timeoutMsec(DEFAULT_TIMEOUT),
+    tracked(false),
+    current(0),
+    expectedReplies(0),
+    bulkStage(0),
+    corruptBefore(0),
+    startScheduled(false),
+    capture(0),
+    captureBus(0)
+{
+    timeoutTimer->setSingleShot(true);
+    timeoutTimer->setTimerType(Qt::PreciseTimer);
+    connect(timeoutTimer, SIGNAL(timeout()), this, SLOT(expire()));
+    connect(port, SIGNAL(readyRead()), this, SLOT(receive()));
+}
+
+
+/**
+* Closes the port; pending operations finish with COMM_TXFAIL
+*/
+BusDriver::~BusDriver(){
+    close();
+}
+
+
+/**
+* Opens a port, 8N1 without flow control
+* @param portName Port, e.g. "COM4" or "/dev/ttyUSB0"
+* @param baudRate Baud rate in bps
+* @return true on success, see errorString() otherwise
+*/
+bool BusDriver::open(const QString &portName, int baudRate){
+    close();
+    if (!DynamixelBus::openPort(port, portName, baudRate)) return false;
+    parser.reset();
+    return true;
+}
+
+
+/**
+* Closes the port; the running and all queued operations finish with COMM_TXFAIL
+*/
+void BusDriver::close(void){
+    timeoutTimer->stop();
+    if (current != 0) finish(COMM_TXFAIL);
+    for (int i = 0; i < BusArbiter::PriorityCount; i++){
+        while (!queues[i].isEmpty()){
+            current = queues[i].takeFirst();
+            finish(COMM_TXFAIL);
+        }
+    }
+    if (port->isOpen()) port->close();
+}
+
+
+/**
+* Returns whether the port is open
+* @return true/false
+*/
+bool BusDriver::isOpen(void) const{
+    return port->isOpen();
+}
+
+
+/**
+* Returns the last port error
+* @return Error description
+*/
+QString BusDriver::errorString(void) const{
+    return port->errorString();
+}
+
+
+/**
+* Returns how long an operation waits for its replies
+* @return Milliseconds
+*/
+int BusDriver::timeout(void) const{
+    return timeoutMsec;
+}
+
+
+/**
+* Sets how long an operation waits for its replies
+* @param msec Milliseconds, at least 1
+*/
+void BusDriver::setTimeout(int msec){
+    timeoutMsec = qMax(1, msec);
+}
+
+
+/**
+* Records every frame written and read into a capture (0 to stop); set it before
+* the first transaction, the capture must outlive the driver
+* @param capture Capture, see BusCapture::open
+* @param bus Bus index stored with the frames
+*/
+void BusDriver::setCapture(BusCapture *capture, int bus){
+    this->capture = capture;
+    captureBus = bus;
+}
+
+
+/**
+* Returns the health tracker of the devices on this port
+* @return Health tracker
+*/
+DeviceHealth *BusDriver::health(void){
+    return &deviceHealth;
+}
+
+
+/**
+* Queues a block READ
+* @param id Dynamixel ID
+* @param address First memory address to read
+* @param length Number of bytes
+* @param priority Queue priority class
+* @return Pending operation
+*/
+BusOperation *BusDriver::read(int id, int address, int length, BusArbiter::Priority priority){
+    BusOperation *operation = new BusOperation(BusOperation::Read, priority);
+    operation->dxlId = id;
+    operation->startAddress = address;
+    operation->length = length;
+    return enqueue(operation);
+}
+
+
+/**
+* Queues a block WRITE
+* @param id Dynamixel ID, BROADCAST_ID for all
+* @param address First memory address to write
+* @param data One entry per byte
+* @param priority Queue priority class
+* @return Pending operation
+*/
+BusOperation *BusDriver::write(int id, int address, const QVector<int> &data, BusArbiter::Priority priority){
+    BusOperation *operation = new BusOperation(BusOperation::Write, priority);
+    operation->dxlId = id;
+    operation->startAddress = address;
+    operation->bytes = data;
+    return enqueue(operation);
+}
+
+
+/**
+* Queues a SYNC_WRITE
+* @param address First memory address to write
+* @param length Bytes per device
+* @param data Bytes per ID
+* @param priority Queue priority class
+* @return Pending operation
+*/
+BusOperation *BusDriver::syncWrite(int address, int length, const QMap<int, QVector<int> > &data, BusArbiter::Priority priority){
+    BusOperation *operation = new BusOperation(BusOperation::SyncWrite, priority);
+    operation->startAddress = address;
+    operation->length = length;
+    operation->syncData = data;
+    return enqueue(operation);
+}
+
+
+/**
+* Queues a bulk read, sent as one BULK_READ per packet DynamixelBus::encodeBulkRead needs
+* @param requests Devices and address ranges
+* @param priority Queue priority class
+* @return Pending operation
+*/
+BusOperation *BusDriver::bulkRead(const QList<BulkReadRequest> &requests, BusArbiter::Priority priority){
+    BusOperation *operation = new BusOperation(BusOperation::BulkRead, priority);
+    operation->requests = requests;
+    return enqueue(operation);
+}
+
+
+/**
+* Queues pre-encoded packets (e.g. from a PacketCache), written back to back as they
+* are. A single packet to one ID waits for its status packet like a write.
+* @param packets Encoded packets
+* @param priority Queue priority class
+* @return Pending operation
+*/
+BusOperation *BusDriver::transmit(const QList<InstructionPacket> &packets, BusArbiter::Priority priority){
+    BusOperation *operation = new BusOperation(BusOperation::Transmit, priority);
+    operation->packets = packets;
+    if (packets.size() == 1) operation->dxlId = packets.first().id;
+    return enqueue(operation);
+}
+
+
+/**
+* Returns the number of operations not yet finished
+* @return Count
+*/
+int BusDriver::pendingCount(void) const{
+    int count = current != 0 ? 1 : 0;
+    for (int i = 0; i < BusArbiter::PriorityCount; i++) count += queues[i].size();
+    return count;
+}
+
+
+// SLOTS (private) ***************************************************************************************
+
+/**
+* Writes the next queued operation, if the bus is idle
+*/
+void BusDriver::startNext(void){
+    startScheduled = false;
+    while (current == 0){
+        for (int i = 0; i < BusArbiter::PriorityCount && current == 0; i++){
+            if (!queues[i].isEmpty()) current = queues[i].takeFirst();
+        }
+        if (current == 0) return;
+        if (!port->isOpen()){
+            finish(COMM_TXFAIL);
+            continue;
+        }
+
+        QList<InstructionPacket> packets;
+        QMap<int, QVector<int> > live;
+        QMap<int, QVector<int> >::const_iterator it;
+        expectedReplies = 0;
+        tracked = false;
+        switch (current->operationType){
+        case BusOperation::Read:
+            packets << DynamixelBus::encodeRead(current->dxlId, current->startAddress, current->length);
+            expectedReplies = 1;
+            tracked = current->dxlId != BROADCAST_ID;
+            break;
+        case BusOperation::Write:
+            packets << DynamixelBus::encodeWrite(current->dxlId, current->startAddress, current->bytes);
+            expectedReplies = deviceHealth.owesReply(current->dxlId, INST_WRITE) ? 1 : 0;
+            tracked = expectedReplies == 1;
+            deviceHealth.updateStatusReturnLevel(current->dxlId, current->startAddress, current->bytes);
+            break;
+        case BusOperation::SyncWrite:
+            for (it = current->syncData.constBegin(); it != current->syncData.constEnd(); ++it){
+                if (deviceHealth.state(it.key()) != DeviceHealth::Dead) live.insert(it.key(), it.value());
+                if (it.value().size() == current->length) deviceHealth.updateStatusReturnLevel(it.key(), current->startAddress, it.value());
+            }
+            packets = DynamixelBus::encodeSyncWrite(current->startAddress, current->length, live);
+            break;
+        case BusOperation::BulkRead:
+            // the first BULK_READ; finish() sends the others
+            bulkPackets = DynamixelBus::encodeBulkRead(current->requests, bulkBatches);
+            bulkStage = 0;
+            if (!bulkPackets.isEmpty()){
+                packets << bulkPackets.first();
+                expectedReplies = bulkBatches.first().size();
+            }
+            break;
+        case BusOperation::Transmit:
+            packets = current->packets;
+            foreach (const InstructionPacket &packet, packets){
+                if (packet.instruction == INST_WRITE && !packet.parameters.isEmpty())
+                    deviceHealth.updateStatusReturnLevel(packet.id, packet.parameters.first(), packet.parameters.mid(1));
+            }
+            if (packets.size() == 1 && deviceHealth.owesReply(current->dxlId, packets.first().instruction)) expectedReplies = 1;
+            tracked = expectedReplies == 1;
+            break;
+        }
+
+        bool valid = !packets.isEmpty();
+        foreach (const InstructionPacket &packet, packets) valid = valid && !packet.wire.isEmpty();
+        if (!valid){
+            finish(COMM_TXERROR);
+            continue;
+        }
+        if (tracked && !deviceHealth.shouldAttempt(current->dxlId)){
+            tracked = false;
+            finish(COMM_RXTIMEOUT);
+            continue;
+        }
+        writePackets(packets);
+    }
+}
+
+
+/**
+* Decodes received bytes and finishes the running operation once all replies are in
+*/
+void BusDriver::receive(void){
+    QByteArray chunk = port->readAll();
+    if (capture) capture->record(captureBus, BusCapture::Receive, chunk);
+    parser.feed(chunk);
+    if (current == 0){
+        parser.reset();     // nothing asked for these
+        return;
+    }
+    replies << parser.takePackets();
+    if (replies.size() >= expectedReplies){
+        timeoutTimer->stop();
+        finish(COMM_RXSUCCESS);
+        startNext();
+    }
+}
+
+
+/**
+* Fails the running operation whose replies did not arrive in time
+*/
+void BusDriver::expire(void){
+    if (current == 0) return;
+    finish(parser.corruptCount() != corruptBefore ? COMM_RXCORRUPT : COMM_RXTIMEOUT);
+    startNext();
+}
+
+
+// INTERNAL SUBROUTINES (private) ************************************************************************
+
+BusOperation *BusDriver::enqueue(BusOperation *operation){
+    queues[operation->priority].append(operation);
+    // started from the event loop, so finished() is never emitted before the caller can connect to it
+    if (!startScheduled && current == 0){
+        startScheduled = true;
+        QMetaObject::invokeMethod(this, "startNext", Qt::QueuedConnection);
+    }
+    return operation;
+}
+
+
+/**
+* Writes the packets of the running operation and waits for its replies
+* @param packets Encoded packets, sent back to back
+*/
+void BusDriver::writePackets(const QList<InstructionPacket> &packets){
+    // anything still buffered belongs to an operation that timed out
+    port->clear(QSerialPort::Input);
+    parser.reset();
+    replies.clear();
+    corruptBefore = parser.corruptCount();
+
+    bool written = true;
+    sentClock.start();
+    foreach (const InstructionPacket &packet, packets){
+        if (capture && written) capture->record(captureBus, BusCapture::Transmit, packet.wire);
+        written = written && port->write(packet.wire) == packet.wire.size();
+    }
+    if (!written) finish(COMM_TXFAIL);
+    else if (expectedReplies == 0) finish(COMM_TXSUCCESS);
+    else timeoutTimer->start(tracked ? deviceHealth.timeoutMsec(current->dxlId, timeoutMsec) : timeoutMsec);
+}
+
+
+/**
+* Stores the replies of the running operation and delivers it; a BulkRead with
+* further BULK_READs to go sends the next one instead
+* @param result Communication result of the transaction
+*/
+void BusDriver::finish(int result){
+    BusOperation *operation = current;
+    current = 0;
+
+    QVector<int> none;
+    switch (operation->operationType){
+    case BusOperation::Read:
+        result = DynamixelBus::decodeStatus(result, replies, operation->dxlId, operation->length,
+                                            operation->bytes, &operation->statusError);
+        break;
+    case BusOperation::Write:
+        result = DynamixelBus::decodeStatus(result, replies, operation->dxlId, 0, none, &operation->statusError);
+        break;
+    case BusOperation::Transmit:
+        if (tracked) result = DynamixelBus::decodeStatus(result, replies, operation->dxlId, 0, none, &operation->statusError);
+        break;
+    case BusOperation::BulkRead:
+        if (bulkStage == 0){
+            operation->bulkReplies.clear();
+            foreach (const BulkReadRequest &request, operation->requests){
+                BulkReadReply reply = { request.id, request.address, COMM_TXFAIL, 0, QVector<int>() };
+                operation->bulkReplies << reply;
+            }
+        }
+        if (bulkStage < bulkBatches.size()){
+            foreach (int k, bulkBatches.at(bulkStage))
+                operation->bulkReplies[k] = DynamixelBus::decodeBulkRead(operation->requests.at(k), result, replies);
+            if (result != COMM_TXFAIL && ++bulkStage < bulkPackets.size()){
+                current = operation;
+                expectedReplies = bulkBatches.at(bulkStage).size();
+                writePackets(QList<InstructionPacket>() << bulkPackets.at(bulkStage));
+                return;
+            }
+        }
+        bulkPackets.clear();
+        bulkBatches.clear();
+        bulkStage = 0;
+        if (result != COMM_TXFAIL && result != COMM_TXERROR){
+            result = COMM_RXSUCCESS;
+            foreach (const BulkReadReply &reply, operation->bulkReplies){
+                if (reply.result != COMM_RXSUCCESS && result == COMM_RXSUCCESS) result = reply.result;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (tracked){
+        int id = operation->dxlId;
+        bool read = operation->operationType == BusOperation::Read;
+        int instruction = read ? INST_READ : INST_WRITE;
+        if (operation->operationType == BusOperation::Transmit) instruction = operation->packets.first().instruction;
+        if (result == COMM_RXSUCCESS) deviceHealth.recordSuccess(id, sentClock.nsecsElapsed() / 1000);
+        else if (result != COMM_TXFAIL && deviceHealth.owesReply(id, instruction)) deviceHealth.recordFailure(id);
+        if (result == COMM_RXSUCCESS && read) deviceHealth.updateStatusReturnLevel(id, operation->startAddress, operation->bytes);
+        tracked = false;
+    }
+
+    operation->communicationResult = result;
+    operation->complete();
+}
@@ -0,0 +1,97 @@
+#ifndef BUSDRIVER_H
+#define BUSDRIVER_H
+#include "asyncbus.h"
+#include "statuspacketparser.h"
+#include "buscapture.h"
+#include <QObject>
+#include <QList>
+#include <QElapsedTimer>
+
+class QSerialPort;
+class QTimer;
+
+/**
+ * @brief The BusDriver class : Event-driven bus on the caller's own event loop.
+ *
+ * Same calls as AsyncBus, but without any thread: the driver owns a QSerialPort,
+ * whose descriptor Qt watches with a socket notifier (an overlapped I/O notifier
+ * on Windows), writes the encoded instruction and returns at once. Replies are
+ * decoded as bytes arrive and BusOperation::finished() is emitted from the event
+ * loop, so a GUI or the QCoreApplication in main.cpp never blocks on the bus:
+ *
+ *     BusDriver bus;
+ *     bus.open("COM4");
+ *     BusOperation *op = bus.read(4, ActuatorControl::controlTableAddress("present position(l)"), 2);
+ *     connect(op, SIGNAL(finished(BusOperation*)), this, SLOT(onPosition(BusOperation*)));
+ *
+ * Operations run one at a time, highest priority class first. BulkRead uses
+ * BULK_READ (MX series); requests repeating an ID or not fitting into one packet
+ * go into further BULK_READs of the same operation, one transaction each. Reads and
+ * writes of one device wait the ID's adaptive timeout from health() (bounded by
+ * timeout()); operations on dead IDs fail at once and SyncWrite leaves them out.
+ */
+class BusDriver : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit BusDriver(QObject *parent = 0);
+    ~BusDriver();
+
+    bool open(const QString &portName, int baudRate = 1000000);
+    void close(void);
+    bool isOpen(void) const;
+    QString errorString(void) const;
+
+    int timeout(void) const;
+    void setTimeout(int msec);
+    void setCapture(BusCapture *capture, int bus = 0);
+    DeviceHealth *health(void);
+
+    BusOperation *read(int id, int address, int length,
+                       BusArbiter::Priority priority = BusArbiter::Telemetry);
+    BusOperation *write(int id, int address, const QVector<int> &data,
+                        BusArbiter::Priority priority = BusArbiter::Control);
+    BusOperation *syncWrite(int address, int length, const QMap<int, QVector<int> > &data,
+                            BusArbiter::Priority priority = BusArbiter::Control);
+    BusOperation *bulkRead(const QList<BulkReadRequest> &requests,
+                           BusArbiter::Priority priority = BusArbiter::Telemetry);
+    BusOperation *transmit(const QList<InstructionPacket> &packets,
+                           BusArbiter::Priority priority = BusArbiter::Control);
+    int pendingCount(void) const;
+
+private slots:
+
+    void startNext(void);
+    void receive(void);
+    void expire(void);
+
+private:
+
+    BusOperation *enqueue(BusOperation *operation);
+    void writePackets(const QList<InstructionPacket> &packets);
+    void finish(int result);
+
+    QSerialPort *port;
+    QTimer *timeoutTimer;
+    int timeoutMsec;
+    DeviceHealth deviceHealth;
+    QElapsedTimer sentClock;
+    bool tracked;               // current is a single-device operation the health tracker learns from
+    StatusPacketParser parser;
+    QList<BusOperation *> queues[BusArbiter::PriorityCount];
+    BusOperation *current;
+    int expectedReplies;
+    QList<StatusPacket> replies;
+    QList<InstructionPacket> bulkPackets;   // BULK_READs of the current BulkRead, see DynamixelBus::encodeBulkRead
+    QList<QList<int> > bulkBatches;
+    int bulkStage;                          // index of the BULK_READ in flight
+    qint64 corruptBefore;
+    bool startScheduled;
+    BusCapture *capture;
+    int captureBus;
+
+};
+
+#endif // BUSDRIVER_H
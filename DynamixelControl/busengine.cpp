@@ -0,0 +1,468 @@
+#include "busengine.h"
+#include "dynamixel_control.h"
+#include <QSerialPort>
+#include <QTimer>
+#include <QMutexLocker>
+#include <QMetaObject>
+
+const int DEFAULT_TIMEOUT = 20;                 // ms
+
+
+// ENGINE: ********************************************************************
+
+BusEngine::BusEngine(QObject *parent) :
+    QThread(parent),
+    core(0),
+    timeoutMsec(DEFAULT_TIMEOUT),
+    capture(0)
+{
+}
+
+
+/**
+* Stops the engine; transactions still queued fail with COMM_TXFAIL
+*/
+BusEngine::~BusEngine(){
+    stop();
+    qDeleteAll(healths);
+}
+
+
+/**
+* Adds a port to serve (only before open())
+* @param portName Port, e.g. "COM4" or "/dev/ttyUSB0"
+* @param baudRate Baud rate in bps
+* @return Bus index used by the transaction calls
+*/
+int BusEngine::addPort(const QString &portName, int baudRate){
+    PortSpec spec;
+    spec.name = portName;
+    spec.baudRate = baudRate;
+    ports << spec;
+    healths << new DeviceHealth;
+    opened << false;
+    return ports.size() - 1;
+}
+
+
+/**
+* Starts the engine thread and opens every port in it
+* @return Number of ports that could be opened, see isBusOpen()
+*/
+int BusEngine::open(void){
+    if (isRunning()) return opened.count(true);
+    start(QThread::TimeCriticalPriority);
+    started.acquire();
+    return opened.count(true);
+}
+
+
+/**
+* Stops the event loop and waits for the engine thread
+*/
+void BusEngine::stop(void){
+    quit();
+    wait();
+}
+
+
+/**
+* Returns the number of added ports
+* @return Number of buses
+*/
+int BusEngine::busCount(void) const{
+    return ports.size();
+}
+
+
+/**
+* Returns whether a bus was opened by open()
+* @param bus Bus index
+* @return true/false
+*/
+bool BusEngine::isBusOpen(int bus) const{
+    return bus >= 0 && bus < opened.size() && opened.at(bus);
+}
+
+
+/**
+* Returns how long a transaction waits for its replies
+* @return Milliseconds
+*/
+int BusEngine::timeout(void) const{
+    return timeoutMsec;
+}
+
+
+/**
+* Sets how long a transaction waits for its replies (only before open())
+* @param msec Milliseconds, at least 1
+*/
+void BusEngine::setTimeout(int msec){
+    timeoutMsec = qMax(1, msec);
+}
+
+
+/**
+* Records every frame written and read on any bus into a capture, stored with
+* its bus index (only before open(); the capture must outlive the engine)
+* @param capture Capture, see BusCapture::open
+*/
+void BusEngine::setCapture(BusCapture *capture){
+    this->capture = capture;
+}
+
+
+/**
+* Returns the health tracker of the devices on a bus
+* @param bus Bus index
+* @return Health tracker, 0 for an unknown bus
+*/
+DeviceHealth *BusEngine::health(int bus){
+    return bus >= 0 && bus < healths.size() ? healths.at(bus) : 0;
+}
+
+
+/**
+* Queues one instruction packet on a bus and blocks until its status packets are in.
+* Must not be called from the engine thread.
+* @param bus Bus index
+* @param packet Encoded packet, see DynamixelBus::encodePacket
+* @param expectedReplies Number of status packets to wait for, 0 for broadcasts
+* @param replies Receives the status packets in arrival order
+* @return COMM_TXSUCCESS (no reply expected), COMM_RXSUCCESS, COMM_RXCORRUPT, COMM_RXTIMEOUT (also for a dead ID) or COMM_TXFAIL
+*/
+int BusEngine::transact(int bus, const InstructionPacket &packet, int expectedReplies, QList<StatusPacket> &replies){
+    replies.clear();
+    if (packet.wire.isEmpty()) return COMM_TXERROR;
+
+    Request request;
+    request.packet = packet;
+    request.expectedReplies = expectedReplies;
+    request.result = COMM_TXFAIL;
+    {
+        QMutexLocker locker(&mutex);
+        if (core == 0 || !isBusOpen(bus)) return COMM_TXFAIL;
+        core->buses.at(bus)->queue << &request;
+        QMetaObject::invokeMethod(core, "dispatch", Qt::QueuedConnection);
+    }
+    request.done.acquire();
+
+    replies = request.replies;
+    return request.result;
+}
+
+
+/**
+* Reads one byte, like dxl_read_byte
+* @param bus Bus index
+* @param id Dynamixel ID
+* @param address Memory address
+* @return Value, -1 on failure
+*/
+int BusEngine::readByte(int bus, int id, int address){
+    QVector<int> data;
+    if (readBlock(bus, id, address, 1, data) != COMM_RXSUCCESS) return -1;
+    return data.at(0);
+}
+
+
+/**
+* Reads one little-endian word, like dxl_read_word
+* @param bus Bus index
+* @param id Dynamixel ID
+* @param address Memory address of the low byte
+* @return Value, -1 on failure
+*/
+int BusEngine::readWord(int bus, int id, int address){
+    QVector<int> data;
+    if (readBlock(bus, id, address, 2, data) != COMM_RXSUCCESS) return -1;
+    return data.at(0) | (data.at(1) << 8);
+}
+
+
+/**
+* Writes one byte, like dxl_write_byte
+* @param bus Bus index
+* @param id Dynamixel ID, BROADCAST_ID for all
+* @param address Memory address
+* @param value Value, range: 0-255
+*/
+void BusEngine::writeByte(int bus, int id, int address, int value){
+    writeBlock(bus, id, address, QVector<int>(1, value));
+}
+
+
+/**
+* Writes one little-endian word, like dxl_write_word
+* @param bus Bus index
+* @param id Dynamixel ID, BROADCAST_ID for all
+* @param address Memory address of the low byte
+* @param value Value, range: 0-65535
+*/
+void BusEngine::writeWord(int bus, int id, int address, int value){
+    QVector<int> data(2);
+    data[0] = value & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+    writeBlock(bus, id, address, data);
+}
+
+
+/**
+* Reads a register range of one device
+* @param bus Bus index
+* @param id Dynamixel ID
+* @param address Start address
+* @param length Number of bytes
+* @param data Receives the bytes read
+* @param error Receives the status packet error bits, if given
+* @return Communication result, COMM_RXSUCCESS on success
+*/
+int BusEngine::readBlock(int bus, int id, int address, int length, QVector<int> &data, int *error){
+    QList<StatusPacket> replies;
+    int result = transact(bus, DynamixelBus::encodeRead(id, address, length), 1, replies);
+    result = DynamixelBus::decodeStatus(result, replies, id, length, data, error);
+    if (result == COMM_RXSUCCESS) healths.at(bus)->updateStatusReturnLevel(id, address, data);
+    return result;
+}
+
+
+/**
+* Writes a register range of one device (no status packet is awaited for BROADCAST_ID
+* or below status return level 2)
+* @param bus Bus index
+* @param id Dynamixel ID, BROADCAST_ID for all
+* @param address Start address
+* @param data Bytes to write
+* @param error Receives the status packet error bits, if given
+* @return Communication result
+*/
+int BusEngine::writeBlock(int bus, int id, int address, const QVector<int> &data, int *error){
+    if (error) *error = 0;
+    if (!isBusOpen(bus)) return COMM_TXFAIL;
+    QList<StatusPacket> replies;
+    QVector<int> none;
+    int expected = healths.at(bus)->owesReply(id, INST_WRITE) ? 1 : 0;
+    int result = transact(bus, DynamixelBus::encodeWrite(id, address, data), expected, replies);
+    result = DynamixelBus::decodeStatus(result, replies, id, 0, none, error);
+    if (result == COMM_RXSUCCESS || result == COMM_TXSUCCESS) healths.at(bus)->updateStatusReturnLevel(id, address, data);
+    return result;
+}
+
+
+/**
+* Engine thread: opens the ports, then runs the event loop until stop()
+*/
+void BusEngine::run(){
+    BusEngineCore *engineCore = new BusEngineCore(this);
+    {
+        QMutexLocker locker(&mutex);
+        core = engineCore;
+    }
+    started.release();
+
+    exec();
+
+    {
+        QMutexLocker locker(&mutex);
+        core = 0;
+    }
+    engineCore->failAll();
+    delete engineCore;
+}
+
+
+// CORE: **********************************************************************
+
+BusEngineCore::BusEngineCore(BusEngine *engine) :
+    QObject(0),
+    engine(engine),
+    cursor(0),
+    scheduled(0),
+    wheelTimer(new QTimer(this)),
+    wheelTime(0)
+{
+    wheelTimer->setTimerType(Qt::PreciseTimer);
+    wheelTimer->setInterval(1);
+    connect(wheelTimer, SIGNAL(timeout()), this, SLOT(tick()));
+    wheelClock.start();
+
+    for (int i = 0; i < engine->ports.size(); i++){
+        Bus *bus = new Bus;
+        bus->port = new QSerialPort(this);
+        bus->inFlight = 0;
+        bus->sequence = 0;
+        bus->corruptBefore = 0;
+        bus->sentNsec = -1;
+        buses << bus;
+
+        const BusEngine::PortSpec &spec = engine->ports.at(i);
+        engine->opened[i] = DynamixelBus::openPort(bus->port, spec.name, spec.baudRate);
+        connect(bus->port, SIGNAL(readyRead()), this, SLOT(receive()));
+    }
+}
+
+
+BusEngineCore::~BusEngineCore(){
+    qDeleteAll(buses);
+}
+
+
+/**
+* Starts the next queued transaction on every idle bus
+*/
+void BusEngineCore::dispatch(void){
+    for (int b = 0; b < buses.size(); b++){
+        Bus *bus = buses.at(b);
+        while (bus->inFlight == 0){
+            {
+                QMutexLocker locker(&engine->mutex);
+                if (bus->queue.isEmpty()) break;
+                bus->inFlight = bus->queue.takeFirst();
+            }
+            const BusEngine::Request *request = bus->inFlight;
+            DeviceHealth *health = engine->healths.at(b);
+            int id = request->packet.id;
+            bool tracked = request->expectedReplies == 1 && id != BROADCAST_ID;
+            bus->sentNsec = -1;
+            if (tracked && !health->shouldAttempt(id)){
+                finish(b, COMM_RXTIMEOUT);
+                continue;
+            }
+
+            // anything still buffered belongs to an earlier transaction that timed out
+            bus->port->clear(QSerialPort::Input);
+            bus->parser.reset();
+            bus->corruptBefore = bus->parser.corruptCount();
+
+            if (engine->capture) engine->capture->record(b, BusCapture::Transmit, request->packet.wire);
+            bus->sentNsec = wheelClock.nsecsElapsed();
+            if (bus->port->write(request->packet.wire) != request->packet.wire.size()) finish(b, COMM_TXFAIL);
+            else if (request->expectedReplies <= 0) finish(b, COMM_TXSUCCESS);
+            else schedule(b, tracked ? health->timeoutMsec(id, engine->timeoutMsec) : engine->timeoutMsec);
+        }
+    }
+}
+
+
+/**
+* Feeds the bytes a port received into its parser and completes its transaction once all replies are in
+*/
+void BusEngineCore::receive(void){
+    QSerialPort *port = qobject_cast<QSerialPort*>(sender());
+    for (int b = 0; b < buses.size(); b++){
+        Bus *bus = buses.at(b);
+        if (bus->port != port) continue;
+
+        QByteArray chunk = port->readAll();
+        if (engine->capture) engine->capture->record(b, BusCapture::Receive, chunk);
+        bus->parser.feed(chunk);
+        if (bus->inFlight == 0){
+            bus->parser.reset();    // nothing asked for these
+            return;
+        }
+        bus->inFlight->replies << bus->parser.takePackets();
+        if (bus->inFlight->replies.size() >= bus->inFlight->expectedReplies){
+            finish(b, COMM_RXSUCCESS);
+            dispatch();
+        }
+        return;
+    }
+}
+
+
+/**
+* Advances the timer wheel to the current time and fails the transactions that ran out of time
+*/
+void BusEngineCore::tick(void){
+    qint64 now = wheelClock.elapsed();
+    bool expired = false;
+
+    while (wheelTime < now){
+        wheelTime++;
+        cursor = (cursor + 1) % WheelSlots;
+        QList<Deadline> &slot = wheel[cursor];
+        for (int i = slot.size() - 1; i >= 0; i--){
+            if (slot[i].rounds > 0){
+                slot[i].rounds--;
+                continue;
+            }
+            Deadline deadline = slot.at(i);
+            slot.removeAt(i);
+            scheduled--;
+
+            // a deadline whose transaction already completed is simply dropped here
+            Bus *bus = buses.at(deadline.bus);
+            if (bus->inFlight == 0 || bus->sequence != deadline.sequence) continue;
+            finish(deadline.bus, bus->parser.corruptCount() != bus->corruptBefore ? COMM_RXCORRUPT : COMM_RXTIMEOUT);
+            expired = true;
+        }
+    }
+
+    if (scheduled == 0) wheelTimer->stop();
+    if (expired) dispatch();
+}
+
+
+// INTERNAL SUBROUTINES (private) ************************************************************************
+
+/**
+* Puts the in-flight transaction of a bus on the timer wheel
+* @param bus Bus index
+* @param msec Timeout, at least one tick
+*/
+void BusEngineCore::schedule(int bus, int msec){
+    if (scheduled == 0){
+        wheelTime = wheelClock.elapsed();   // the wheel stood still while idle
+        wheelTimer->start();
+    }
+    Deadline deadline;
+    deadline.bus = bus;
+    deadline.sequence = buses.at(bus)->sequence;
+    // tick() visits slot cursor + msec first after msec ticks, then every WheelSlots ticks
+    msec = qMax(1, msec);
+    deadline.rounds = (msec - 1) / WheelSlots;
+    wheel[(cursor + msec) % WheelSlots] << deadline;
+    scheduled++;
+}
+
+
+/**
+* Completes the in-flight transaction of a bus, feeds a single-device result to the
+* bus's health tracker and wakes the caller
+* @param bus Bus index
+* @param result Communication result
+*/
+void BusEngineCore::finish(int bus, int result){
+    Bus *b = buses.at(bus);
+    BusEngine::Request *request = b->inFlight;
+    b->inFlight = 0;
+    b->sequence++;
+
+    const InstructionPacket &packet = request->packet;
+    DeviceHealth *health = engine->healths.at(bus);
+    if (b->sentNsec >= 0 && request->expectedReplies == 1 && packet.id != BROADCAST_ID){
+        if (result == COMM_RXSUCCESS) health->recordSuccess(packet.id, (wheelClock.nsecsElapsed() - b->sentNsec) / 1000);
+        else if (result != COMM_TXFAIL && health->owesReply(packet.id, packet.instruction)) health->recordFailure(packet.id);
+    }
+
+    request->result = result;
+    request->done.release();
+}
+
+
+/**
+* Fails every in-flight and queued transaction, on shutdown
+*/
+void BusEngineCore::failAll(void){
+    QMutexLocker locker(&engine->mutex);
+    foreach (Bus *bus, buses){
+        if (bus->inFlight != 0) bus->queue.prepend(bus->inFlight);
+        bus->inFlight = 0;
+        foreach (BusEngine::Request *request, bus->queue){
+            request->result = COMM_TXFAIL;
+            request->done.release();
+        }
+        bus->queue.clear();
+    }
+}
@@ -0,0 +1,149 @@
+#ifndef BUSENGINE_H
+#define BUSENGINE_H
+#include "dynamixelbus.h"
+#include "statuspacketparser.h"
+#include "buscapture.h"
+#include <QThread>
+#include <QObject>
+#include <QMutex>
+#include <QSemaphore>
+#include <QElapsedTimer>
+#include <QList>
+#include <QVector>
+
+class QSerialPort;
+class QTimer;
+class BusEngineCore;
+
+/**
+ * @brief The BusEngine class : Runs many serial buses from one thread.
+ *
+ * Every port added with addPort() is opened non-blocking inside the engine's own
+ * event loop. Qt's event dispatcher waits on all port descriptors at once (epoll/
+ * poll on Unix, overlapped I/O on Windows), so a reply on any bus is handled as
+ * soon as it arrives while the other buses keep their transactions in flight.
+ * Each bus runs one transaction at a time (the bus is half duplex); transaction
+ * timeouts are kept in a millisecond timer wheel, so expiring or cancelling one is
+ * O(1) however many buses there are. Every bus has its own DeviceHealth: a
+ * single-device transaction waits the ID's adaptive timeout (bounded by timeout())
+ * and transactions to dead IDs fail without going on the wire.
+ *
+ * The calls mirror the blocking ActuatorControl/DynamixelBus ones with a leading
+ * bus index: the calling thread blocks until its own transaction completes, and
+ * callers on different buses proceed in parallel.
+ */
+class BusEngine : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    explicit BusEngine(QObject *parent = 0);
+    ~BusEngine();
+
+    int addPort(const QString &portName, int baudRate = 1000000);
+    int open(void);
+    void stop(void);
+    int busCount(void) const;
+    bool isBusOpen(int bus) const;
+
+    int timeout(void) const;
+    void setTimeout(int msec);
+    void setCapture(BusCapture *capture);
+    DeviceHealth *health(int bus);
+
+    int transact(int bus, const InstructionPacket &packet, int expectedReplies, QList<StatusPacket> &replies);
+    int readByte(int bus, int id, int address);
+    int readWord(int bus, int id, int address);
+    void writeByte(int bus, int id, int address, int value);
+    void writeWord(int bus, int id, int address, int value);
+    int readBlock(int bus, int id, int address, int length, QVector<int> &data, int *error = 0);
+    int writeBlock(int bus, int id, int address, const QVector<int> &data, int *error = 0);
+
+protected:
+
+    void run();
+
+private:
+
+    friend class BusEngineCore;
+
+    struct PortSpec {
+        QString name;
+        int baudRate;
+    };
+
+    struct Request {
+        InstructionPacket packet;
+        int expectedReplies;
+        QList<StatusPacket> replies;
+        int result;
+        QSemaphore done;
+    };
+
+    QList<PortSpec> ports;
+    QList<DeviceHealth *> healths;
+    QVector<bool> opened;
+    mutable QMutex mutex;       // guards core and the queues inside it
+    BusEngineCore *core;
+    QSemaphore started;
+    int timeoutMsec;
+    BusCapture *capture;
+
+};
+
+
+/**
+ * @brief The BusEngineCore class : Event-loop side of BusEngine, lives in the engine thread
+ */
+class BusEngineCore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void dispatch(void);
+    void receive(void);
+    void tick(void);
+
+private:
+
+    friend class BusEngine;
+
+    enum { WheelSlots = 256 };
+
+    struct Bus {
+        QSerialPort *port;
+        StatusPacketParser parser;
+        QList<BusEngine::Request *> queue;  // guarded by BusEngine::mutex
+        BusEngine::Request *inFlight;
+        quint32 sequence;                   // bumped when inFlight completes
+        qint64 corruptBefore;
+        qint64 sentNsec;                    // wheelClock time inFlight was written, -1 if it was not
+    };
+
+    struct Deadline {
+        int bus;
+        quint32 sequence;
+        int rounds;
+    };
+
+    explicit BusEngineCore(BusEngine *engine);
+    ~BusEngineCore();
+
+    void schedule(int bus, int msec);
+    void finish(int bus, int result);
+    void failAll(void);
+
+    BusEngine *engine;
+    QList<Bus *> buses;
+    QList<Deadline> wheel[WheelSlots];
+    int cursor;
+    int scheduled;
+    QTimer *wheelTimer;
+    QElapsedTimer wheelClock;
+    qint64 wheelTime;
+
+};
+
+#endif // BUSENGINE_H
@@ -0,0 +1,229 @@
+#include "bustrafficanalyzer.h"
+#include "dynamixel_control.h"
+#include <QFile>
+
+const int BITS_PER_BYTE = 10;   // start bit, 8 data bits, stop bit
+const int PACKET_OVERHEAD = 6;  // 0xFF 0xFF id length instruction ... checksum
+
+
+/**
+* Returns the parameters of an instruction packet
+* @param wire Packet as transmitted
+* @return Parameter bytes
+*/
+static QVector<int> instructionParameters(const QByteArray &wire){
+    QVector<int> parameters;
+    for (int i = 5; i < wire.size() - 1; i++) parameters << (quint8)wire.at(i);
+    return parameters;
+}
+
+
+BusTrafficAnalyzer::BusTrafficAnalyzer(int baudRate) :
+    baud(qMax(1, baudRate))
+{
+}
+
+
+/**
+* Adds the next captured frame; frames must be added in capture order
+* @param frame Frame, see BusCapture::readFrame
+*/
+void BusTrafficAnalyzer::add(const CapturedFrame &frame){
+    if (!buses.contains(frame.bus)){
+        BusState &state = buses[frame.bus];
+        BusTraffic empty = { frame.bus, 0, 0, 0, 0, 0, 0, 0, 0.0, 0, 0, 0.0, 0, QMap<int, DeviceTraffic>() };
+        state.traffic = empty;
+        state.start = -1;
+        state.lineEnd = 0;
+        state.airtime = 0;
+        state.levels = QSharedPointer<DeviceHealth>(new DeviceHealth());
+    }
+    BusState &state = buses[frame.bus];
+
+    // the line interval of the frame, see the class description
+    qint64 air = lineTime(frame.size);
+    qint64 begin = frame.direction == BusCapture::Transmit ? frame.timestamp : frame.timestamp - air;
+    if (state.start < 0) state.start = begin;
+    else{
+        qint64 gap = qMax(0LL, (begin - state.lineEnd) / 1000);
+        BusTraffic &traffic = state.traffic;
+        traffic.gapMin = traffic.gaps == 0 ? gap : qMin(traffic.gapMin, gap);
+        traffic.gapMax = qMax(traffic.gapMax, gap);
+        traffic.gaps++;
+        traffic.gapMean += (gap - traffic.gapMean) / traffic.gaps;
+    }
+    state.lineEnd = qMax(state.lineEnd, begin + air);
+    state.airtime += air;
+
+    if (frame.direction == BusCapture::Transmit) transmitted(state, frame);
+    else received(state, frame);
+}
+
+
+/**
+* Returns the statistics of every bus seen so far
+* @return One entry per bus, in bus order
+*/
+QList<BusTraffic> BusTrafficAnalyzer::report(void) const{
+    QList<BusTraffic> report;
+    QMap<int, BusState>::const_iterator it;
+    for (it = buses.constBegin(); it != buses.constEnd(); ++it){
+        const BusState &state = it.value();
+        BusTraffic traffic = state.traffic;
+        traffic.duration = state.lineEnd - state.start;
+        traffic.utilisation = traffic.duration > 0 ? qMin(1.0, (double)state.airtime / traffic.duration) : 0.0;
+        traffic.corruptPackets = state.parser.corruptCount();
+        report << traffic;
+    }
+    return report;
+}
+
+
+/**
+* Forgets every frame added so far
+*/
+void BusTrafficAnalyzer::reset(void){
+    buses.clear();
+}
+
+
+/**
+* Analyzes a capture file
+* @param fileName Path of a file written by BusCapture
+* @param baudRate Baud rate the capture was taken at
+* @param ok Receives whether the file could be read completely, if not null
+* @return One entry per bus, in bus order
+*/
+QList<BusTraffic> BusTrafficAnalyzer::analyze(const QString &fileName, int baudRate, bool *ok){
+    BusTrafficAnalyzer analyzer(baudRate);
+    QFile file(fileName);
+    bool valid = file.open(QIODevice::ReadOnly) && BusCapture::readHeader(&file);
+
+    CapturedFrame frame;
+    while (valid && BusCapture::readFrame(&file, frame)) analyzer.add(frame);
+    if (valid) valid = file.atEnd();
+
+    if (ok) *ok = valid;
+    return analyzer.report();
+}
+
+
+// INTERNAL SUBROUTINES (private) ************************************************************************
+
+/**
+* Decodes an instruction packet, learns status return levels it writes and notes
+* which IDs owe a status packet
+* @param state Bus the frame was captured on
+* @param frame Transmitted frame (one instruction packet)
+*/
+void BusTrafficAnalyzer::transmitted(BusState &state, const CapturedFrame &frame){
+    state.traffic.txBytes += frame.size;
+    state.traffic.txFrames++;
+
+    // whatever is still owed was not answered
+    QMap<int, qint64>::const_iterator owed;
+    for (owed = state.pending.constBegin(); owed != state.pending.constEnd(); ++owed){
+        device(state, owed.key()).timeouts++;
+        state.timedOut.insert(owed.key());
+    }
+    state.pending.clear();
+
+    const QByteArray &wire = frame.bytes;
+    if (wire.size() < PACKET_OVERHEAD || (quint8)wire.at(0) != 0xFF || (quint8)wire.at(1) != 0xFF) return;
+    int id = (quint8)wire.at(2);
+    int instruction = (quint8)wire.at(4);
+    QVector<int> parameters = instructionParameters(wire);
+
+    // a write of the status return level applies to its own status packet, like on the live bus
+    if (instruction == INST_WRITE && !parameters.isEmpty()){
+        state.levels->updateStatusReturnLevel(id, parameters.first(), parameters.mid(1));
+    }
+    else if (instruction == INST_SYNC_WRITE && parameters.size() >= 2){
+        // parameters: address, length, then (id, data) per device
+        int length = parameters.at(1);
+        for (int i = 2; length > 0 && i + length < parameters.size(); i += length + 1){
+            state.levels->updateStatusReturnLevel(parameters.at(i), parameters.at(0), parameters.mid(i + 1, length));
+        }
+    }
+
+    QList<int> answering;
+    if (instruction == INST_BULK_READ){
+        // parameters: 0x00, then (length, id, address) per device
+        for (int i = 1; i + 2 < parameters.size(); i += 3){
+            if (state.levels->owesReply(parameters.at(i + 1), instruction)) answering << parameters.at(i + 1);
+        }
+    }
+    else if (id != BROADCAST_ID && instruction != INST_SYNC_WRITE && state.levels->owesReply(id, instruction)) answering << id;
+
+    foreach (int answeringId, answering){
+        DeviceTraffic &traffic = device(state, answeringId);
+        traffic.instructions++;
+        if (state.timedOut.contains(answeringId) && state.lastInstruction.value(answeringId) == wire) traffic.retries++;
+        state.timedOut.remove(answeringId);
+        state.lastInstruction[answeringId] = wire;
+        state.pending[answeringId] = frame.timestamp;
+    }
+}
+
+
+/**
+* Decodes a received chunk, matches its status packets to the instructions owed a
+* reply and learns status return levels from READ replies
+* @param state Bus the frame was captured on
+* @param frame Received frame (whatever one port read returned)
+*/
+void BusTrafficAnalyzer::received(BusState &state, const CapturedFrame &frame){
+    state.traffic.rxBytes += frame.size;
+    state.traffic.rxChunks++;
+
+    state.parser.feed(frame.bytes);
+    foreach (const StatusPacket &packet, state.parser.takePackets()){
+        state.traffic.statusPackets++;
+        if (!state.pending.contains(packet.id)) continue;
+
+        // the range the reply answers: a READ, or this ID's entry of a BULK_READ
+        const QByteArray &wire = state.lastInstruction.value(packet.id);
+        QVector<int> parameters = instructionParameters(wire);
+        int instruction = wire.size() >= PACKET_OVERHEAD ? (quint8)wire.at(4) : -1;
+        if (instruction == INST_READ && parameters.size() >= 2){
+            state.levels->updateStatusReturnLevel(packet.id, parameters.at(0), packet.parameters);
+        }
+        else if (instruction == INST_BULK_READ){
+            for (int i = 1; i + 2 < parameters.size(); i += 3){
+                if (parameters.at(i + 1) == packet.id) state.levels->updateStatusReturnLevel(packet.id, parameters.at(i + 2), packet.parameters);
+            }
+        }
+
+        qint64 rtt = (frame.timestamp - state.pending.take(packet.id)) / 1000;
+        DeviceTraffic &traffic = device(state, packet.id);
+        traffic.rttMin = traffic.replies == 0 ? rtt : qMin(traffic.rttMin, rtt);
+        traffic.rttMax = qMax(traffic.rttMax, rtt);
+        traffic.replies++;
+        traffic.rttMean += (rtt - traffic.rttMean) / traffic.replies;
+    }
+}
+
+
+/**
+* Returns the statistics of one ID, created on first use
+* @param state Bus
+* @param id Dynamixel ID
+* @return Statistics
+*/
+DeviceTraffic &BusTrafficAnalyzer::device(BusState &state, int id){
+    if (!state.traffic.devices.contains(id)){
+        DeviceTraffic empty = { id, 0, 0, 0, 0, 0, 0.0, 0 };
+        state.traffic.devices.insert(id, empty);
+    }
+    return state.traffic.devices[id];
+}
+
+
+/**
+* Returns how long bytes occupy the line at the analyzer's baud rate
+* @param bytes Number of bytes
+* @return Nanoseconds
+*/
+qint64 BusTrafficAnalyzer::lineTime(int bytes) const{
+    return (qint64)bytes * BITS_PER_BYTE * 1000000000LL / baud;
+}
@@ -0,0 +1,106 @@
+#ifndef BUSTRAFFICANALYZER_H
+#define BUSTRAFFICANALYZER_H
+#include "buscapture.h"
+#include "devicehealth.h"
+#include "statuspacketparser.h"
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+
+/**
+ * @brief The DeviceTraffic struct : Transactions with one ID as seen on the wire
+ */
+struct DeviceTraffic
+{
+    int id;
+    int instructions;   // instructions to the ID that expect a status packet
+    int replies;        // status packets answering one of them
+    int timeouts;       // instructions still unanswered when the next instruction went out
+    int retries;        // instructions repeating one that timed out
+    qint64 rttMin;      // usec from the instruction to the chunk completing its reply
+    double rttMean;
+    qint64 rttMax;
+};
+
+
+/**
+ * @brief The BusTraffic struct : Statistics of one captured bus
+ */
+struct BusTraffic
+{
+    int bus;
+    qint64 duration;        // nsec from the start of the first to the end of the last frame
+    qint64 txBytes;
+    qint64 rxBytes;
+    int txFrames;
+    int rxChunks;           // reads the port returned
+    int statusPackets;
+    int corruptPackets;
+    double utilisation;     // share of the duration the line carried bytes, 0-1
+    int gaps;
+    qint64 gapMin;          // usec of idle line between consecutive frames
+    double gapMean;
+    qint64 gapMax;
+    QMap<int, DeviceTraffic> devices;
+};
+
+
+/**
+ * @brief The BusTrafficAnalyzer class : Offline analysis of BusCapture files.
+ *
+ * Replays the captured frames of every bus: instruction packets are decoded to
+ * learn which IDs owe a status packet, and received chunks are fed through a
+ * StatusPacketParser to match the replies. An instruction that is still owed a
+ * reply when the next one goes out counts as a timeout, and an identical
+ * instruction to the same ID right after a timeout counts as a retry.
+ *
+ * Line time is derived from the baud rate (10 bits per byte). A transmitted frame
+ * is stamped when it was handed to the port and a received chunk when it was read,
+ * so a frame occupies the line after its timestamp when transmitted and before it
+ * when received; gaps are the idle time between those intervals.
+ * Replies are only expected where the device owes one (DeviceHealth::owesReply): the
+ * status return level of every ID is learned from the captured WRITEs, SYNC_WRITEs and
+ * READ replies that cover address 16, as on the live bus, and starts at the factory
+ * level 2. Instructions that owe no reply are neither timeouts nor retries.
+ */
+class BusTrafficAnalyzer
+{
+public:
+
+    explicit BusTrafficAnalyzer(int baudRate = 1000000);
+
+    void add(const CapturedFrame &frame);
+    QList<BusTraffic> report(void) const;
+    void reset(void);
+
+    static QList<BusTraffic> analyze(const QString &fileName, int baudRate = 1000000, bool *ok = 0);
+
+private:
+
+    struct BusState
+    {
+        BusTraffic traffic;
+        StatusPacketParser parser;
+        qint64 start;                       // nsec, -1 before the first frame
+        qint64 lineEnd;                     // nsec the last frame left the line
+        qint64 airtime;                     // nsec the line carried bytes
+        QMap<int, qint64> pending;          // ID -> timestamp of the instruction owed a reply
+        QMap<int, QByteArray> lastInstruction;
+        QSet<int> timedOut;
+        QSharedPointer<DeviceHealth> levels; // status return level per ID, the rest is unused
+    };
+
+    void transmitted(BusState &state, const CapturedFrame &frame);
+    void received(BusState &state, const CapturedFrame &frame);
+    DeviceTraffic &device(BusState &state, int id);
+    qint64 lineTime(int bytes) const;
+
+    int baud;
+    QMap<int, BusState> buses;
+
+};
+
+#endif // BUSTRAFFICANALYZER_H
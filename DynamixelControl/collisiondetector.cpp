@@ -0,0 +1,226 @@
+#include "collisiondetector.h"
+#include "actuatorcontrol.h"
+#include "dynamixelbus.h"
+#include "dynamixel_control.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <qmath.h>
+
+const int DEFAULT_SAMPLE_RATE = 100;
+const double DEFAULT_SIGMAS = 6.0;
+const int DEFAULT_MINIMUM_THRESHOLD = 150;      // load units, 0.1% each
+const int DEFAULT_NORMAL_TORQUE_LIMIT = 1023;
+const int DEFAULT_REDUCED_TORQUE_LIMIT = 100;
+const double MODEL_WEIGHT = 0.05;               // EWMA weight of a new sample
+const int WARMUP_SAMPLES = 20;                  // samples before a joint can trip
+
+
+CollisionDetector::CollisionDetector(QObject *parent) :
+    QThread(parent),
+    rate(DEFAULT_SAMPLE_RATE),
+    tripped(0),
+    sigmas(DEFAULT_SIGMAS),
+    minimumThreshold(DEFAULT_MINIMUM_THRESHOLD),
+    normalTorqueLimit(DEFAULT_NORMAL_TORQUE_LIMIT),
+    reducedTorqueLimit(DEFAULT_REDUCED_TORQUE_LIMIT)
+{
+}
+
+
+/**
+* Stops the sampling thread before destruction
+*/
+CollisionDetector::~CollisionDetector(){
+    stop();
+}
+
+
+/**
+* Adds a joint to watch (only before start() / the first process())
+* @param id Dynamixel actuator ID
+* @param viscous Expected load per unit of signed Present Speed
+* @return Joint index (order of the arrays passed to process())
+*/
+int CollisionDetector::addJoint(int id, double viscous){
+    QMutexLocker locker(&modelMutex);
+    ids.append(id);
+    this->viscous.append(viscous);
+    baseline.append(0);
+    variance.append(0);
+    warmup.append(0);
+    return ids.size() - 1;
+}
+
+
+/**
+* Returns the sample rate of the detector's own thread
+* @return Samples per second
+*/
+int CollisionDetector::sampleRate(void) const{
+    return rate.load();
+}
+
+
+/**
+* Sets the sample rate of the detector's own thread
+* @param samplesPerSecond Samples per second, range: 1-1000
+*/
+void CollisionDetector::setSampleRate(int samplesPerSecond){
+    rate.store(qBound(1, samplesPerSecond, 1000));
+}
+
+
+/**
+* Sets how far a load sample must deviate from the model to count as a collision
+* @param deviations Multiple of the residual standard deviation
+* @param threshold Minimum residual in load units, whatever the deviation
+*/
+void CollisionDetector::setSensitivity(double deviations, int threshold){
+    QMutexLocker locker(&modelMutex);
+    sigmas = deviations;
+    minimumThreshold = threshold;
+}
+
+
+/**
+* Sets the Torque Limit broadcast on a collision and on restore
+* @param normal Torque Limit restored by restoreTorqueLimit(), range: 0-1023
+* @param reduced Torque Limit broadcast on a collision, range: 0-1023
+*/
+void CollisionDetector::setTorqueLimits(int normal, int reduced){
+    QMutexLocker locker(&modelMutex);
+    normalTorqueLimit = qBound(0, normal, 1023);
+    reducedTorqueLimit = qBound(0, reduced, 1023);
+}
+
+
+/**
+* Returns whether a collision has reduced the torque
+* @return true/false
+*/
+bool CollisionDetector::isTripped(void) const{
+    return tripped.load() != 0;
+}
+
+
+/**
+* Broadcasts the normal Torque Limit and re-arms the detector
+*/
+void CollisionDetector::restoreTorqueLimit(void){
+    int limit;
+    {
+        QMutexLocker locker(&modelMutex);
+        limit = normalTorqueLimit;
+        for (int i = 0; i < warmup.size(); i++) warmup[i] = 0;
+    }
+    writeTorqueLimit(limit);
+    tripped.store(0);
+}
+
+
+/**
+* Feeds one sample of every joint through the model
+* @param speeds Raw Present Speed per joint (0-1023 CCW, 1024-2047 CW)
+* @param loads Raw Present Load per joint (0-1023 CCW, 1024-2047 CW)
+*/
+void CollisionDetector::process(const int *speeds, const int *loads){
+    int hitId = -1, hitLoad = 0, reduced = 0;
+    double hitExpected = 0;
+    {
+        QMutexLocker locker(&modelMutex);
+        for (int i = 0; i < ids.size(); i++){
+            double load = signedValue(loads[i]);
+            double expected = baseline[i] + viscous[i] * signedValue(speeds[i]);
+            double residual = load - expected;
+            double threshold = qMax((double)minimumThreshold, sigmas * qSqrt(variance[i]));
+
+            if (warmup[i] >= WARMUP_SAMPLES && qAbs(residual) > threshold){
+                if (hitId < 0){
+                    hitId = ids[i];
+                    hitLoad = (int)load;
+                    hitExpected = expected;
+                }
+                continue; // keep the spike out of the model
+            }
+
+            baseline[i] += MODEL_WEIGHT * (load - viscous[i] * signedValue(speeds[i]) - baseline[i]);
+            variance[i] += MODEL_WEIGHT * (residual * residual - variance[i]);
+            if (warmup[i] < WARMUP_SAMPLES) warmup[i]++;
+        }
+        reduced = reducedTorqueLimit;
+    }
+
+    if (hitId >= 0 && tripped.testAndSetOrdered(0, 1)){
+        writeTorqueLimit(reduced);
+        emit collisionDetected(hitId, hitLoad, hitExpected);
+    }
+}
+
+
+/**
+* Stops the sampling thread and waits for it
+*/
+void CollisionDetector::stop(void){
+    requestInterruption();
+    wait();
+}
+
+
+/**
+* Sampling loop: one bulk read of Present Speed and Load (38-41) per period
+*/
+void CollisionDetector::run(){
+    QList<BulkReadRequest> requests;
+    for (int i = 0; i < ids.size(); i++){
+        BulkReadRequest request = { ids.at(i), ActuatorControl::controlTableAddress("present speed(l)"), 4 };
+        requests << request;
+    }
+    QVector<int> speeds(ids.size()), loads(ids.size());
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 nextSample = 0;
+
+    while (!isInterruptionRequested()){
+        QList<BulkReadReply> replies = DynamixelBus::bulkRead(requests);
+        bool complete = true;
+        for (int i = 0; i < replies.size(); i++){
+            const QVector<int> &d = replies.at(i).data;
+            if (d.size() != 4){
+                complete = false;
+                break;
+            }
+            speeds[i] = d.at(0) | (d.at(1) << 8);
+            loads[i] = d.at(2) | (d.at(3) << 8);
+        }
+        if (complete) process(speeds.constData(), loads.constData());
+
+        nextSample += 1000000000LL / rate.load();
+        qint64 remaining = nextSample - clock.nsecsElapsed();
+        if (remaining > 0) usleep(remaining / 1000);
+        else nextSample = clock.nsecsElapsed();
+    }
+}
+
+
+/**
+* Decodes a speed/load value: bits 0-9 magnitude, bit 10 set for CW (returned negative)
+* @param raw Raw value
+* @return Signed value
+*/
+int CollisionDetector::signedValue(int raw){
+    return (raw & 0x3FF) * (1 - 2 * ((raw >> 10) & 1));
+}
+
+
+/**
+* Broadcasts a Torque Limit to every actuator on the Safety priority class
+* @param limit Torque Limit, range: 0-1023
+* @return Communication result
+*/
+int CollisionDetector::writeTorqueLimit(int limit){
+    QVector<int> bytes(2);
+    bytes[0] = limit & 0xFF;
+    bytes[1] = (limit >> 8) & 0xFF;
+    return DynamixelBus::writeBlock(BROADCAST_ID, ActuatorControl::controlTableAddress("torque limit(l)"), bytes, BusArbiter::Safety);
+}
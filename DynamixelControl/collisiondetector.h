@@ -0,0 +1,73 @@
+#ifndef COLLISIONDETECTOR_H
+#define COLLISIONDETECTOR_H
+#include <QThread>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QVector>
+
+/**
+ * @brief The CollisionDetector class : Load-spike collision detection and torque governor.
+ *
+ * Each joint has a running model of its load, expected = baseline + viscous * speed,
+ * where baseline and the residual variance are exponentially weighted averages. A
+ * sample whose residual exceeds max(minimumThreshold, sigmas * deviation) is a hit:
+ * the detector immediately broadcasts a reduced Torque Limit on the Safety priority
+ * class, which goes ahead of every queued transaction, and emits collisionDetected().
+ * A hit is noticed at most one sampling period plus one bulk read (one READ per
+ * joint on the DLL bus) after it happens; the write itself then waits only for the
+ * transaction in flight, since a thread holding the bus across several transactions
+ * steps aside for Safety at its next one (see BusArbiter).
+ * Torque stays reduced until restoreTorqueLimit() is called.
+ *
+ * Samples come either from the detector's own thread (start(), one bulk read of
+ * Present Speed and Load per period) or from another loop that already reads them
+ * (process()).
+ */
+class CollisionDetector : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    explicit CollisionDetector(QObject *parent = 0);
+    ~CollisionDetector();
+
+    int addJoint(int id, double viscous = 0);
+    int sampleRate(void) const;
+    void setSampleRate(int samplesPerSecond);
+    void setSensitivity(double sigmas, int minimumThreshold);
+    void setTorqueLimits(int normal, int reduced);
+    bool isTripped(void) const;
+    void restoreTorqueLimit(void);
+    void process(const int *speeds, const int *loads);
+    void stop(void);
+
+signals:
+
+    void collisionDetected(int id, int load, double expectedLoad);
+
+protected:
+
+    void run();
+
+private:
+
+    static int signedValue(int raw);
+    int writeTorqueLimit(int limit);
+
+    QAtomicInt rate;
+    QAtomicInt tripped;
+    mutable QMutex modelMutex;
+    QVector<int> ids;
+    QVector<double> viscous;
+    QVector<double> baseline;
+    QVector<double> variance;
+    QVector<int> warmup;
+    double sigmas;
+    int minimumThreshold;
+    int normalTorqueLimit;
+    int reducedTorqueLimit;
+
+};
+
+#endif // COLLISIONDETECTOR_H
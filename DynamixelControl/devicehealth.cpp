@@ -0,0 +1,265 @@
+#include "devicehealth.h"
+#include "dynamixel_control.h"
+#include <QMutexLocker>
+
+const int DEFAULT_DEAD_THRESHOLD = 3;
+const int INITIAL_BACKOFF = 50;             // msec
+const int DEFAULT_MAX_BACKOFF = 5000;       // msec
+const qint64 MIN_TIMEOUT = 500;             // usec, one status packet at 57600 bps is ~1 ms
+const qint64 DEFAULT_TIMEOUT = 20000;       // usec, before any reply has been seen
+const int STATUS_RETURN_LEVEL_ADDRESS = 16;
+const int DEFAULT_STATUS_RETURN_LEVEL = 2;  // factory setting: every instruction is answered
+
+
+DeviceHealth::DeviceHealth() :
+    failuresUntilDead(DEFAULT_DEAD_THRESHOLD),
+    backoffLimit(DEFAULT_MAX_BACKOFF)
+{
+    clock.start();
+    for (int id = 0; id < ID_COUNT; id++) reset(id);
+}
+
+
+/**
+* Returns whether a transaction to the ID should go on the bus.
+* False for Dead devices, except once per backoff period (the re-probe).
+* @param id Dynamixel ID
+* @return true/false
+*/
+bool DeviceHealth::shouldAttempt(int id){
+    if (id < 0 || id >= ID_COUNT) return true; // broadcast, never answers
+    QMutexLocker locker(&mutex);
+    Entry &entry = entries[id];
+    if (entry.state != Dead) return true;
+
+    qint64 now = clock.elapsed();
+    if (now < entry.nextProbe) return false;
+    entry.nextProbe = now + entry.backoff; // one probe per period, even if it hangs
+    return true;
+}
+
+
+/**
+* Records a reply and updates the round trip estimate
+* @param id Dynamixel ID
+* @param roundTripUsec Time from transmission to complete status packet, -1 if the
+* reply carries no sample (e.g. a later reply to a BULK_READ)
+*/
+void DeviceHealth::recordSuccess(int id, qint64 roundTripUsec){
+    if (id < 0 || id >= ID_COUNT) return;
+    QMutexLocker locker(&mutex);
+    Entry &entry = entries[id];
+
+    if (roundTripUsec >= 0 && entry.srtt == 0){
+        entry.srtt = roundTripUsec;
+        entry.rttvar = roundTripUsec / 2;
+    }
+    else if (roundTripUsec >= 0){
+        qint64 deviation = qAbs(entry.srtt - roundTripUsec);
+        entry.rttvar = (3 * entry.rttvar + deviation) / 4;
+        entry.srtt = (7 * entry.srtt + roundTripUsec) / 8;
+    }
+
+    entry.state = Healthy;
+    entry.consecutiveFailures = 0;
+    entry.backoff = INITIAL_BACKOFF;
+}
+
+
+/**
+* Records a transaction without a valid reply
+* @param id Dynamixel ID
+*/
+void DeviceHealth::recordFailure(int id){
+    if (id < 0 || id >= ID_COUNT) return;
+    QMutexLocker locker(&mutex);
+    Entry &entry = entries[id];
+
+    entry.consecutiveFailures++;
+    if (entry.state == Dead){
+        entry.backoff = qMin(entry.backoff * 2, (qint64)backoffLimit);
+        entry.nextProbe = clock.elapsed() + entry.backoff;
+    }
+    else if (entry.consecutiveFailures >= failuresUntilDead){
+        entry.state = Dead;
+        entry.nextProbe = clock.elapsed() + entry.backoff;
+    }
+    else entry.state = Suspect;
+}
+
+
+/**
+* Returns whether the device answers an instruction with a status packet
+* @param id Dynamixel ID
+* @param instruction Instruction (INST_*)
+* @return false for broadcasts and for instructions the status return level keeps silent
+*/
+bool DeviceHealth::owesReply(int id, int instruction) const{
+    if (id < 0 || id >= ID_COUNT) return false;
+    int level = statusReturnLevel(id);
+    if (instruction == INST_PING) return true;
+    if (instruction == INST_READ || instruction == INST_BULK_READ) return level >= 1;
+    return level >= 2;
+}
+
+
+/**
+* Returns the status return level assumed for an ID
+* @param id Dynamixel ID
+* @return 0: PING only, 1: PING and READ, 2: every instruction
+*/
+int DeviceHealth::statusReturnLevel(int id) const{
+    if (id < 0 || id >= ID_COUNT) return DEFAULT_STATUS_RETURN_LEVEL;
+    QMutexLocker locker(&mutex);
+    return entries[id].statusReturnLevel;
+}
+
+
+/**
+* Sets the status return level of an ID, e.g. for devices configured before the program started
+* @param id Dynamixel ID, BROADCAST_ID for all
+* @param level Range: 0-2
+*/
+void DeviceHealth::setStatusReturnLevel(int id, int level){
+    level = qBound(0, level, 2);
+    QMutexLocker locker(&mutex);
+    if (id == BROADCAST_ID){
+        for (int i = 0; i < ID_COUNT; i++) entries[i].statusReturnLevel = level;
+    }
+    else if (id >= 0 && id < ID_COUNT) entries[id].statusReturnLevel = level;
+}
+
+
+/**
+* Picks up the status return level from bytes written to or read from a device
+* @param id Dynamixel ID, BROADCAST_ID for a broadcast write
+* @param address First memory address of the bytes
+* @param bytes One entry per byte
+*/
+void DeviceHealth::updateStatusReturnLevel(int id, int address, const QVector<int> &bytes){
+    int offset = STATUS_RETURN_LEVEL_ADDRESS - address;
+    if (offset < 0 || offset >= bytes.size()) return;
+    setStatusReturnLevel(id, bytes.at(offset));
+}
+
+
+/**
+* Returns the health state of an ID
+* @param id Dynamixel ID
+* @return Healthy, Suspect or Dead
+*/
+DeviceHealth::State DeviceHealth::state(int id) const{
+    if (id < 0 || id >= ID_COUNT) return Healthy;
+    QMutexLocker locker(&mutex);
+    return entries[id].state;
+}
+
+
+/**
+* Returns the smoothed round trip time
+* @param id Dynamixel ID
+* @return SRTT in usec, 0 if no reply has been seen yet
+*/
+qint64 DeviceHealth::smoothedRoundTrip(int id) const{
+    if (id < 0 || id >= ID_COUNT) return 0;
+    QMutexLocker locker(&mutex);
+    return entries[id].srtt;
+}
+
+
+/**
+* Returns the adaptive reply timeout (SRTT + 4 * RTTVAR)
+* @param id Dynamixel ID
+* @return Timeout in usec
+*/
+qint64 DeviceHealth::timeout(int id) const{
+    if (id < 0 || id >= ID_COUNT) return DEFAULT_TIMEOUT;
+    QMutexLocker locker(&mutex);
+    const Entry &entry = entries[id];
+    if (entry.srtt == 0) return DEFAULT_TIMEOUT;
+    return qMax(MIN_TIMEOUT, entry.srtt + 4 * entry.rttvar);
+}
+
+
+/**
+* Returns the adaptive reply timeout for transports that wait in whole milliseconds
+* @param id Dynamixel ID
+* @param maxMsec Upper limit, the transport's configured timeout
+* @return Timeout in ms, range: 1-maxMsec
+*/
+int DeviceHealth::timeoutMsec(int id, int maxMsec) const{
+    qint64 msec = (timeout(id) + 999) / 1000;
+    return (int)qBound((qint64)1, msec, (qint64)qMax(1, maxMsec));
+}
+
+
+/**
+* Returns all IDs currently considered dead
+* @return Dead IDs
+*/
+QList<int> DeviceHealth::deadIds(void) const{
+    QMutexLocker locker(&mutex);
+    QList<int> ids;
+    for (int id = 0; id < ID_COUNT; id++){
+        if (entries[id].state == Dead) ids << id;
+    }
+    return ids;
+}
+
+
+/**
+* Forgets everything known about an ID (e.g. after replacing a device)
+* @param id Dynamixel ID
+*/
+void DeviceHealth::reset(int id){
+    if (id < 0 || id >= ID_COUNT) return;
+    QMutexLocker locker(&mutex);
+    Entry &entry = entries[id];
+    entry.state = Healthy;
+    entry.consecutiveFailures = 0;
+    entry.srtt = 0;
+    entry.rttvar = 0;
+    entry.backoff = INITIAL_BACKOFF;
+    entry.nextProbe = 0;
+    entry.statusReturnLevel = DEFAULT_STATUS_RETURN_LEVEL;
+}
+
+
+/**
+* Returns the number of consecutive failures after which a device is Dead
+* @return Failure count
+*/
+int DeviceHealth::deadThreshold(void) const{
+    QMutexLocker locker(&mutex);
+    return failuresUntilDead;
+}
+
+
+/**
+* Sets the number of consecutive failures after which a device is Dead
+* @param failures Failure count, minimum 1
+*/
+void DeviceHealth::setDeadThreshold(int failures){
+    QMutexLocker locker(&mutex);
+    failuresUntilDead = qMax(1, failures);
+}
+
+
+/**
+* Returns the longest re-probe interval for Dead devices
+* @return Interval in ms
+*/
+int DeviceHealth::maxBackoff(void) const{
+    QMutexLocker locker(&mutex);
+    return backoffLimit;
+}
+
+
+/**
+* Sets the longest re-probe interval for Dead devices
+* @param msec Interval in ms, minimum 50
+*/
+void DeviceHealth::setMaxBackoff(int msec){
+    QMutexLocker locker(&mutex);
+    backoffLimit = qMax(INITIAL_BACKOFF, msec);
+}
@@ -0,0 +1,78 @@
+#ifndef DEVICEHEALTH_H
+#define DEVICEHEALTH_H
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QList>
+#include <QVector>
+
+/**
+ * @brief The DeviceHealth class : Per-ID round trip statistics and liveness.
+ *
+ * Each ID keeps a smoothed round trip time (SRTT/RTTVAR, as in TCP) from which an
+ * adaptive timeout is derived; the serial transports wait that long for a reply,
+ * bounded by their configured timeout (the DLL keeps its own fixed receive timeout).
+ * A failed transaction makes a device Suspect; after deadThreshold() consecutive
+ * failures it is Dead and transactions to it are skipped without touching the bus,
+ * except for one re-probe per backoff period. The backoff doubles on every failed
+ * probe, up to maxBackoff(). Any reply makes it Healthy again.
+ *
+ * Only transactions that owe a status packet count: a device at status return
+ * level 0 answers PING only, at level 1 PING and READ. The level is picked up from
+ * the reads and writes that cover its address (see updateStatusReturnLevel), so a
+ * silent WRITE to such a device is neither a failure nor worth waiting for.
+ */
+class DeviceHealth
+{
+public:
+
+    enum State {
+        Healthy,
+        Suspect,
+        Dead
+    };
+
+    DeviceHealth();
+
+    bool shouldAttempt(int id);
+    void recordSuccess(int id, qint64 roundTripUsec);
+    void recordFailure(int id);
+    bool owesReply(int id, int instruction) const;
+    int statusReturnLevel(int id) const;
+    void setStatusReturnLevel(int id, int level);
+    void updateStatusReturnLevel(int id, int address, const QVector<int> &bytes);
+
+    State state(int id) const;
+    qint64 smoothedRoundTrip(int id) const;
+    qint64 timeout(int id) const;
+    int timeoutMsec(int id, int maxMsec) const;
+    QList<int> deadIds(void) const;
+    void reset(int id);
+
+    int deadThreshold(void) const;
+    void setDeadThreshold(int failures);
+    int maxBackoff(void) const;
+    void setMaxBackoff(int msec);
+
+private:
+
+    struct Entry {
+        State state;
+        int consecutiveFailures;
+        qint64 srtt;        // usec, 0 until the first reply
+        qint64 rttvar;      // usec
+        qint64 backoff;     // msec
+        qint64 nextProbe;   // msec on clock
+        int statusReturnLevel;
+    };
+
+    static const int ID_COUNT = 254;
+
+    mutable QMutex mutex;
+    QElapsedTimer clock;
+    Entry entries[ID_COUNT];
+    int failuresUntilDead;
+    int backoffLimit;
+
+};
+
+#endif // DEVICEHEALTH_H
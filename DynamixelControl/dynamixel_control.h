@@ -24,6 +24,7 @@ void __stdcall dxl_set_txpacket_instruction( int instruction );
 #define INST_ACTION			(5)
 #define INST_RESET			(6)
 #define INST_SYNC_WRITE		(131)
+#define INST_BULK_READ		(146)
 
 #define MAXNUM_TXPARAM		(150)
 void __stdcall dxl_set_txpacket_parameter( int index, int value );
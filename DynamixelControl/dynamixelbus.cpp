@@ -0,0 +1,739 @@
+#include "dynamixelbus.h"
+#include "dynamixel_control.h"
+#include "buscapture.h"
+#include <QSerialPort>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <QList>
+#include <QMap>
+
+const int BULK_READ_MAX_DEVICES = (MAXNUM_TXPARAM - 1) / 3;
+
+/**
+ * @brief busArbiter : Orders access to the DLL packet buffer
+ */
+static BusArbiter busArbiter;
+
+/**
+ * @brief busHealth : Round trip statistics and liveness per ID
+ */
+static DeviceHealth busHealth;
+
+static QElapsedTimer createStartedClock(void){
+    QElapsedTimer clock;
+    clock.start();
+    return clock;
+}
+
+/**
+ * @brief busClock : Time base for round trip measurements
+ */
+static QElapsedTimer busClock = createStartedClock();
+
+/**
+ * @brief busDeviceIds : Every ID on the bus (actuators and sensors), see setDeviceIds()
+ */
+static QList<int> busDeviceIds;
+static QMutex busDeviceIdsMutex;
+
+/**
+ * @brief busCapture : Capture every transaction is recorded into (0 for none), see setCapture()
+ */
+static BusCapture *busCapture = 0;
+static int busCaptureBus = 0;
+
+
+/**
+* Returns whether the device confirmed the write: the status packet arrived and
+* reports no error. Writes to BROADCAST_ID, SYNC_WRITE and writes to devices below
+* status return level 2 get no status packet, so for them this only confirms the
+* transmission (COMM_TXSUCCESS).
+* @return true/false
+*/
+bool WriteResult::succeeded(void) const{
+    return (result == COMM_RXSUCCESS || result == COMM_TXSUCCESS) && error == 0;
+}
+
+
+/**
+* Acquires the bus
+* @param priority Priority class of the transactions run while the lock is held
+*/
+DynamixelBus::Lock::Lock(BusArbiter::Priority priority) :
+    acquired(busArbiter.acquire(priority))
+{
+}
+
+
+/**
+* Releases the bus (if it was acquired)
+*/
+DynamixelBus::Lock::~Lock(){
+    if (acquired) busArbiter.release();
+}
+
+
+/**
+* Returns whether the bus was granted. False when the priority class queue was full.
+* @return true/false
+*/
+bool DynamixelBus::Lock::isAcquired(void) const{
+    return acquired;
+}
+
+
+/**
+* Returns the bus arbiter, e.g. to tune queue limits and bandwidth shares
+* @return Bus arbiter
+*/
+BusArbiter *DynamixelBus::arbiter(void){
+    return &busArbiter;
+}
+
+
+/**
+* Returns the per-ID health tracker
+* @return Device health
+*/
+DeviceHealth *DynamixelBus::health(void){
+    return &busHealth;
+}
+
+
+/**
+* Declares every ID connected to the bus, actuators and sensors alike. Fleet writes
+* that set the same value on all of them are then sent to BROADCAST_ID.
+* @param ids Dynamixel IDs, empty to never broadcast
+*/
+void DynamixelBus::setDeviceIds(const QList<int> &ids){
+    QMutexLocker locker(&busDeviceIdsMutex);
+    busDeviceIds = ids;
+}
+
+
+/**
+* Returns the IDs declared with setDeviceIds()
+* @return Dynamixel IDs
+*/
+QList<int> DynamixelBus::deviceIds(void){
+    QMutexLocker locker(&busDeviceIdsMutex);
+    return busDeviceIds;
+}
+
+
+/**
+* Records every transaction into a capture (0 to stop); set it before the first
+* transaction or while holding a Lock, the capture must outlive its use here
+* @param capture Capture, see BusCapture::open
+* @param bus Bus index the frames are stored with
+*/
+void DynamixelBus::setCapture(BusCapture *capture, int bus){
+    busCapture = capture;
+    busCaptureBus = bus;
+}
+
+
+/**
+* Returns the bus priority class for a read. EEPROM settings and the lock are
+* diagnostics and must not hold up control traffic; everything else is telemetry.
+* @param address Memory address to read from (see Control Table)
+* @return Priority class
+*/
+BusArbiter::Priority DynamixelBus::readPriority(int address){
+    if (address < RamStartAddress || address == LockAddress) return BusArbiter::Diagnostics;
+    else return BusArbiter::Telemetry;
+}
+
+
+/**
+* Reads a single byte
+* @param id Dynamixel ID
+* @param address Memory address to read from (see Control Table)
+* @param priority Bus priority class
+* @return Value at the memory address, -1 if the device is dead or the priority class queue was full
+*/
+int DynamixelBus::readByte(int id, int address, BusArbiter::Priority priority){
+    if (!busHealth.shouldAttempt(id)) return -1;
+    Lock lock(priority);
+    if (!lock.isAcquired()) return -1;
+    qint64 start = beginTransaction(id, INST_READ, QVector<int>() << address << 1);
+    int value = dxl_read_byte(id, address);
+    if (finishTransaction(id, INST_READ, start) == COMM_RXSUCCESS) busHealth.updateStatusReturnLevel(id, address, QVector<int>(1, value));
+    return value;
+}
+
+
+/**
+* Writes a single byte
+* @param id Dynamixel ID
+* @param address Memory address to write to (see Control Table)
+* @param value Value to write
+* @param priority Bus priority class
+* @return Communication result and status packet error bits, e.g. ERRBIT_RANGE
+*/
+WriteResult DynamixelBus::writeByte(int id, int address, int value, BusArbiter::Priority priority){
+    WriteResult refused = { id, COMM_RXTIMEOUT, 0 };
+    if (!busHealth.shouldAttempt(id)) return refused;
+    Lock lock(priority);
+    refused.result = COMM_TXFAIL;
+    if (!lock.isAcquired()) return refused;
+    qint64 start = beginTransaction(id, INST_WRITE, QVector<int>() << address << (value & 0xFF));
+    dxl_write_byte(id, address, value);
+    busHealth.updateStatusReturnLevel(id, address, QVector<int>(1, value));
+    return acknowledge(id, start);
+}
+
+
+/**
+* Reads a word (low byte at address, high byte at address + 1)
+* @param id Dynamixel ID
+* @param address Memory address to read from (see Control Table)
+* @param priority Bus priority class
+* @return Value at the memory address, -1 if the device is dead or the priority class queue was full
+*/
+int DynamixelBus::readWord(int id, int address, BusArbiter::Priority priority){
+    if (!busHealth.shouldAttempt(id)) return -1;
+    Lock lock(priority);
+    if (!lock.isAcquired()) return -1;
+    qint64 start = beginTransaction(id, INST_READ, QVector<int>() << address << 2);
+    int value = dxl_read_word(id, address);
+    if (finishTransaction(id, INST_READ, start) == COMM_RXSUCCESS){
+        QVector<int> bytes;
+        bytes << (value & 0xFF) << ((value >> 8) & 0xFF);
+        busHealth.updateStatusReturnLevel(id, address, bytes);
+    }
+    return value;
+}
+
+
+/**
+* Writes a word (low byte at address, high byte at address + 1)
+* @param id Dynamixel ID
+* @param address Memory address to write to (see Control Table)
+* @param value Value to write
+* @param priority Bus priority class
+* @return Communication result and status packet error bits, e.g. ERRBIT_RANGE
+*/
+WriteResult DynamixelBus::writeWord(int id, int address, int value, BusArbiter::Priority priority){
+    WriteResult refused = { id, COMM_RXTIMEOUT, 0 };
+    if (!busHealth.shouldAttempt(id)) return refused;
+    Lock lock(priority);
+    refused.result = COMM_TXFAIL;
+    if (!lock.isAcquired()) return refused;
+    qint64 start = beginTransaction(id, INST_WRITE, QVector<int>() << address << (value & 0xFF) << ((value >> 8) & 0xFF));
+    dxl_write_word(id, address, value);
+    QVector<int> bytes;
+    bytes << (value & 0xFF) << ((value >> 8) & 0xFF);
+    busHealth.updateStatusReturnLevel(id, address, bytes);
+    return acknowledge(id, start);
+}
+
+
+/**
+* Reads a contiguous block of the control table with one READ instruction
+* @param id Dynamixel ID
+* @param address First memory address to read
+* @param length Number of bytes to read, range: 1-MAXNUM_RXPARAM
+* @param data Receives one entry per byte read (cleared on failure)
+* @param priority Bus priority class
+* @param error Receives the status packet error bits (ERRBIT_*) if not null, 0 when no status packet arrived
+* @return Communication result (COMM_RXSUCCESS on success)
+*/
+int DynamixelBus::readBlock(int id, int address, int length, QVector<int> &data, BusArbiter::Priority priority, int *error){
+    data.clear();
+    if (error) *error = 0;
+    if (length < 1 || length > MAXNUM_RXPARAM) return COMM_TXERROR;
+
+    if (!busHealth.shouldAttempt(id)) return COMM_RXTIMEOUT;
+    Lock lock(priority);
+    if (!lock.isAcquired()) return COMM_TXFAIL;
+    qint64 start = beginTransaction(id, INST_READ, QVector<int>() << address << length);
+    dxl_set_txpacket_id(id);
+    dxl_set_txpacket_instruction(INST_READ);
+    dxl_set_txpacket_parameter(0, address);
+    dxl_set_txpacket_parameter(1, length);
+    dxl_set_txpacket_length(4);
+    dxl_txrx_packet();
+
+    int result = finishTransaction(id, INST_READ, start);
+    if (result != COMM_RXSUCCESS) return result;
+
+    data.resize(length);
+    for (int i = 0; i < length; i++) data[i] = dxl_get_rxpacket_parameter(i);
+    if (error) *error = statusErrorBits();
+    busHealth.updateStatusReturnLevel(id, address, data);
+    return result;
+}
+
+
+/**
+* Writes a contiguous block of the control table with one WRITE instruction
+* @param id Dynamixel ID (BROADCAST_ID writes to every device, no status packet is returned)
+* @param address First memory address to write
+* @param data One entry per byte to write, at most MAXNUM_TXPARAM - 1 bytes
+* @param priority Bus priority class
+* @param error Receives the status packet error bits (ERRBIT_*) if not null, 0 when no status packet arrived
+* @return Communication result
+*/
+int DynamixelBus::writeBlock(int id, int address, const QVector<int> &data, BusArbiter::Priority priority, int *error){
+    if (error) *error = 0;
+    if (data.isEmpty() || data.size() > MAXNUM_TXPARAM - 1) return COMM_TXERROR;
+
+    if (!busHealth.shouldAttempt(id)) return COMM_RXTIMEOUT;
+    Lock lock(priority);
+    if (!lock.isAcquired()) return COMM_TXFAIL;
+    qint64 start = beginTransaction(id, INST_WRITE, QVector<int>() << address << data);
+    dxl_set_txpacket_id(id);
+    dxl_set_txpacket_instruction(INST_WRITE);
+    dxl_set_txpacket_parameter(0, address);
+    for (int i = 0; i < data.size(); i++) dxl_set_txpacket_parameter(i + 1, data.at(i));
+    dxl_set_txpacket_length(data.size() + 3);
+    dxl_txrx_packet();
+    busHealth.updateStatusReturnLevel(id, address, data);
+
+    WriteResult acknowledgement = acknowledge(id, start);
+    if (error) *error = acknowledgement.error;
+    return acknowledgement.result;
+}
+
+
+/**
+* Writes the same address range on several devices with SYNC_WRITE (no status packets).
+* Split into several packets if the data does not fit into one.
+* @param address First memory address to write
+* @param length Bytes per device
+* @param data Bytes to write per ID; entries whose size differs from length and IDs
+* DeviceHealth considers dead are skipped
+* @param priority Bus priority class
+* @return Communication result of the last packet
+*/
+int DynamixelBus::syncWrite(int address, int length, const QMap<int, QVector<int> > &data, BusArbiter::Priority priority){
+    QMap<int, QVector<int> > live;
+    QMap<int, QVector<int> >::const_iterator it;
+    for (it = data.constBegin(); it != data.constEnd(); ++it){
+        if (it.value().size() != length || busHealth.state(it.key()) == DeviceHealth::Dead) continue;
+        live.insert(it.key(), it.value());
+        busHealth.updateStatusReturnLevel(it.key(), address, it.value());
+    }
+    QList<InstructionPacket> packets = encodeSyncWrite(address, length, live);
+    if (packets.isEmpty()) return COMM_TXERROR;
+
+    // every packet is a transaction of its own, so Safety can go in between (see BusArbiter)
+    Lock lock(priority);
+    if (!lock.isAcquired()) return COMM_TXFAIL;
+    int result = COMM_TXERROR;
+    foreach (const InstructionPacket &packet, packets) result = transmitPacket(packet, priority);
+    return result;
+}
+
+
+/**
+* Writes one register range on several devices with as few packets as possible:
+* one WRITE to BROADCAST_ID if every ID on the bus (see setDeviceIds) gets the same
+* bytes, otherwise one SYNC_WRITE, or a plain WRITE for a single ID.
+* Broadcasts and SYNC_WRITE are not answered, so their results only carry the
+* communication result of the packet; use writeEach() where every device has to
+* acknowledge the write. IDs DeviceHealth considers dead are left out and fail with
+* COMM_RXTIMEOUT, entries whose size differs from length fail with COMM_TXERROR.
+* @param address First memory address to write
+* @param length Bytes per device
+* @param data Bytes to write per ID
+* @param priority Bus priority class
+* @return One result per ID, in ID order
+*/
+QList<WriteResult> DynamixelBus::writeFleet(int address, int length, const QMap<int, QVector<int> > &data, BusArbiter::Priority priority){
+    QMap<int, QVector<int> > live;
+    QMap<int, QVector<int> >::const_iterator it;
+    for (it = data.constBegin(); it != data.constEnd(); ++it){
+        if (it.value().size() == length && busHealth.state(it.key()) != DeviceHealth::Dead) live.insert(it.key(), it.value());
+    }
+
+    int result = COMM_RXTIMEOUT;
+    QMap<int, WriteResult> acknowledged;
+    if (live.size() == 1){
+        foreach (const WriteResult &written, writeEach(address, live, priority)) acknowledged.insert(written.id, written);
+    } else if (!live.isEmpty()){
+        const QVector<int> &first = live.constBegin().value();
+        bool identical = true;
+        for (it = data.constBegin(); identical && it != data.constEnd(); ++it) identical = it.value() == first;
+
+        // a broadcast reaches the dead IDs too, which costs nothing as long as they asked for the same bytes
+        bool broadcast = false;
+        if (identical){
+            QList<int> all = deviceIds();
+            broadcast = !all.isEmpty() && all.size() == data.size();
+            foreach (int id, all) broadcast = broadcast && data.contains(id);
+        }
+        result = broadcast ? writeBlock(BROADCAST_ID, address, first, priority)
+                           : syncWrite(address, length, live, priority);
+    }
+
+    QList<WriteResult> results;
+    for (it = data.constBegin(); it != data.constEnd(); ++it){
+        WriteResult written = { it.key(), result, 0 };
+        if (it.value().size() != length) written.result = COMM_TXERROR;
+        else if (!live.contains(it.key())) written.result = COMM_RXTIMEOUT;
+        else if (acknowledged.contains(it.key())) written = acknowledged.value(it.key());
+        results << written;
+    }
+    return results;
+}
+
+
+/**
+* Writes one register range on several devices with one WRITE per ID, each answered
+* by its device. Costs one status packet per ID instead of a SYNC_WRITE followed by
+* reading every register back. No other transaction runs between the writes, except
+* a Safety one (see BusArbiter).
+* @param address First memory address to write
+* @param data Bytes to write per ID
+* @param priority Bus priority class
+* @return One result per ID, in ID order
+*/
+QList<WriteResult> DynamixelBus::writeEach(int address, const QMap<int, QVector<int> > &data, BusArbiter::Priority priority){
+    QList<WriteResult> results;
+    Lock lock(priority);
+
+    QMap<int, QVector<int> >::const_iterator it;
+    for (it = data.constBegin(); it != data.constEnd(); ++it){
+        WriteResult written = { it.key(), COMM_TXFAIL, 0 };
+        if (lock.isAcquired()) written.result = writeBlock(it.key(), address, it.value(), priority, &written.error);
+        results << written;
+    }
+    return results;
+}
+
+
+/**
+* Reads several devices and address ranges.
+*
+* BULK_READ (MX series) answers with one status packet per device, but the DLL
+* accepts exactly one status packet per instruction, matched to the instruction's
+* ID. Every request is therefore served with its own READ here, and every READ is
+* a transaction of its own: the bus is released in between, so higher priority
+* traffic waits for at most one READ, and the replies are not taken at one instant.
+* Buses run by SerialTransport or BusDriver read MX devices with a single BULK_READ.
+* @param requests Devices and address ranges to read, each length 1-MAXNUM_RXPARAM
+* @param priority Bus priority class
+* @return One reply per request, in request order
+*/
+QList<BulkReadReply> DynamixelBus::bulkRead(const QList<BulkReadRequest> &requests, BusArbiter::Priority priority){
+    QList<BulkReadReply> replies;
+    foreach (const BulkReadRequest &request, requests){
+        BulkReadReply reply = { request.id, request.address, COMM_TXFAIL, 0, QVector<int>() };
+        reply.result = readBlock(request.id, request.address, request.length, reply.data, priority, &reply.error);
+        replies << reply;
+    }
+    return replies;
+}
+
+
+/**
+* Encodes an instruction packet once, so it can be sent any number of times with transmitPacket()
+* @param id Dynamixel ID, BROADCAST_ID for all
+* @param instruction Instruction (INST_*)
+* @param parameters Parameter bytes, at most MAXNUM_TXPARAM
+* @return Encoded packet; its wire is empty if the parameters do not fit
+*/
+InstructionPacket DynamixelBus::encodePacket(int id, int instruction, const QVector<int> &parameters){
+    InstructionPacket packet;
+    packet.id = id;
+    packet.instruction = instruction;
+    if (parameters.size() > MAXNUM_TXPARAM) return packet;
+    packet.parameters = parameters;
+
+    int length = parameters.size() + 2;
+    int checksum = id + length + instruction;
+    packet.wire.reserve(parameters.size() + 6);
+    packet.wire.append((char)0xFF);
+    packet.wire.append((char)0xFF);
+    packet.wire.append((char)id);
+    packet.wire.append((char)length);
+    packet.wire.append((char)instruction);
+    foreach (int value, parameters){
+        packet.wire.append((char)value);
+        checksum += value & 0xFF;
+    }
+    packet.wire.append((char)(~checksum & 0xFF));
+    return packet;
+}
+
+
+/**
+* Encodes a SYNC_WRITE, split into several packets if it does not fit into one
+* @param address First memory address to write
+* @param length Bytes per device
+* @param data Bytes to write per ID; entries whose size differs from length are skipped
+* @return Encoded packets, empty if length is out of range or no entry matches it
+*/
+QList<InstructionPacket> DynamixelBus::encodeSyncWrite(int address, int length, const QMap<int, QVector<int> > &data){
+    QList<InstructionPacket> packets;
+    if (length < 1 || length > MAXNUM_TXPARAM - 3) return packets;
+    int idsPerPacket = (MAXNUM_TXPARAM - 2) / (length + 1);
+
+    QVector<int> parameters;
+    QMap<int, QVector<int> >::const_iterator it = data.constBegin();
+    while (it != data.constEnd()){
+        if (it.value().size() == length){
+            if (parameters.isEmpty()) parameters << address << length;
+            parameters << it.key();
+            foreach (int value, it.value()) parameters << (value & 0xFF);
+        }
+        ++it;
+
+        bool full = parameters.size() == 2 + idsPerPacket * (length + 1);
+        if (!parameters.isEmpty() && (full || it == data.constEnd())){
+            packets << encodePacket(BROADCAST_ID, INST_SYNC_WRITE, parameters);
+            parameters.clear();
+        }
+    }
+    return packets;
+}
+
+
+/**
+* Encodes a READ of one device, as sent by the serial transports
+* @param id Dynamixel ID
+* @param address First memory address to read
+* @param length Number of bytes
+* @return Encoded packet
+*/
+InstructionPacket DynamixelBus::encodeRead(int id, int address, int length){
+    QVector<int> parameters;
+    parameters << address << length;
+    return encodePacket(id, INST_READ, parameters);
+}
+
+
+/**
+* Encodes a WRITE of one device (or BROADCAST_ID), as sent by the serial transports
+* @param id Dynamixel ID, BROADCAST_ID for all
+* @param address First memory address to write
+* @param data One entry per byte, at most MAXNUM_TXPARAM - 1 bytes
+* @return Encoded packet; its wire is empty if data is empty or does not fit
+*/
+InstructionPacket DynamixelBus::encodeWrite(int id, int address, const QVector<int> &data){
+    if (data.isEmpty()){
+        InstructionPacket packet;
+        packet.id = id;
+        packet.instruction = INST_WRITE;
+        return packet;
+    }
+    QVector<int> parameters;
+    parameters << address;
+    foreach (int value, data) parameters << (value & 0xFF);
+    return encodePacket(id, INST_WRITE, parameters);
+}
+
+
+/**
+* Encodes a bulk read as BULK_READ packets (MX series). An ID may appear only once
+* per BULK_READ, so a repeated ID goes into a following packet, as do requests
+* beyond what fits into one.
+* @param requests Devices and address ranges to read
+* @param batches Receives, per packet, the indices into requests it reads, in packet order
+* @return Encoded packets, one status packet per index of its batch is expected
+*/
+QList<InstructionPacket> DynamixelBus::encodeBulkRead(const QList<BulkReadRequest> &requests, QList<QList<int> > &batches){
+    QList<InstructionPacket> packets;
+    batches.clear();
+    QVector<bool> done(requests.size(), false);
+    int remaining = requests.size();
+    while (remaining > 0){
+        QVector<int> parameters;
+        QList<int> batch;
+        QList<int> batchIds;
+        parameters << 0x00;
+        for (int i = 0; i < requests.size() && batch.size() < BULK_READ_MAX_DEVICES; i++){
+            if (done.at(i) || batchIds.contains(requests.at(i).id)) continue;
+            parameters << requests.at(i).length << requests.at(i).id << requests.at(i).address;
+            batch << i;
+            batchIds << requests.at(i).id;
+            done[i] = true;
+        }
+        remaining -= batch.size();
+        packets << encodePacket(BROADCAST_ID, INST_BULK_READ, parameters);
+        batches << batch;
+    }
+    return packets;
+}
+
+
+/**
+* Decodes the status packet answering a READ or WRITE sent by a serial transport
+* @param result Communication result of the transaction
+* @param replies Status packets the transaction collected
+* @param id Dynamixel ID the instruction was sent to
+* @param length Number of bytes read, 0 for a WRITE
+* @param data Receives the bytes read, empty on failure
+* @param error Receives the status packet error bits (ERRBIT_*) if not null, 0 when no status packet arrived
+* @return Communication result, COMM_RXCORRUPT if the status packet does not match the instruction
+*/
+int DynamixelBus::decodeStatus(int result, const QList<StatusPacket> &replies, int id, int length,
+                               QVector<int> &data, int *error){
+    data.clear();
+    if (error) *error = 0;
+    if (result != COMM_RXSUCCESS) return result;
+    if (replies.isEmpty()) return COMM_RXCORRUPT;
+
+    const StatusPacket &reply = replies.first();
+    if (reply.id != id || reply.parameters.size() != length) return COMM_RXCORRUPT;
+    if (error) *error = reply.error;
+    data = reply.parameters;
+    return result;
+}
+
+
+/**
+* Picks the reply to one request out of the status packets a BULK_READ collected
+* @param request Device and address range read
+* @param result Communication result of the BULK_READ
+* @param replies Status packets the BULK_READ collected, also when some are missing
+* @return Reply; COMM_RXTIMEOUT if the device did not answer a BULK_READ others did
+*/
+BulkReadReply DynamixelBus::decodeBulkRead(const BulkReadRequest &request, int result, const QList<StatusPacket> &replies){
+    BulkReadReply reply = { request.id, request.address, result == COMM_RXSUCCESS ? COMM_RXTIMEOUT : result, 0, QVector<int>() };
+    foreach (const StatusPacket &packet, replies){
+        if (packet.id != request.id) continue;
+        reply.error = packet.error;
+        if (packet.parameters.size() == request.length){
+            reply.result = COMM_RXSUCCESS;
+            reply.data = packet.parameters;
+        } else {
+            reply.result = COMM_RXCORRUPT;
+        }
+        break;
+    }
+    return reply;
+}
+
+
+/**
+* Opens a port for the serial transports, 8N1 without flow control
+* @param port Port to open, closed first if open
+* @param portName Port, e.g. "COM4" or "/dev/ttyUSB0"
+* @param baudRate Baud rate in bps, e.g. 1000000 for baud rate setting 1
+* @return true on success; the port is left closed otherwise, see its errorString()
+*/
+bool DynamixelBus::openPort(QSerialPort *port, const QString &portName, int baudRate){
+    if (port->isOpen()) port->close();
+    port->setPortName(portName);
+    if (!port->open(QIODevice::ReadWrite)) return false;
+    if (!port->setBaudRate(baudRate) || !port->setDataBits(QSerialPort::Data8) ||
+            !port->setParity(QSerialPort::NoParity) || !port->setStopBits(QSerialPort::OneStop) ||
+            !port->setFlowControl(QSerialPort::NoFlowControl)){
+        port->close();
+        return false;
+    }
+    return true;
+}
+
+
+/**
+* Sends a packet built by encodePacket() and waits for its status packet (none for broadcasts)
+* @param packet Encoded packet
+* @param priority Bus priority class
+* @return Communication result
+*/
+int DynamixelBus::transmitPacket(const InstructionPacket &packet, BusArbiter::Priority priority){
+    if (packet.wire.isEmpty()) return COMM_TXERROR;
+
+    if (!busHealth.shouldAttempt(packet.id)) return COMM_RXTIMEOUT;
+    Lock lock(priority);
+    if (!lock.isAcquired()) return COMM_TXFAIL;
+    qint64 start = beginTransaction(packet.id, packet.instruction, packet.parameters);
+    dxl_set_txpacket_id(packet.id);
+    dxl_set_txpacket_instruction(packet.instruction);
+    const int *parameter = packet.parameters.constData();
+    for (int i = 0; i < packet.parameters.size(); i++) dxl_set_txpacket_parameter(i, parameter[i]);
+    dxl_set_txpacket_length(packet.parameters.size() + 2);
+    dxl_txrx_packet();
+    if (packet.instruction == INST_WRITE && !packet.parameters.isEmpty())
+        busHealth.updateStatusReturnLevel(packet.id, packet.parameters.first(), packet.parameters.mid(1));
+
+    return finishTransaction(packet.id, packet.instruction, start);
+}
+
+
+/**
+* Starts a transaction (bus must be held): records its instruction packet into the
+* capture, if any, just before the DLL sends it
+* @param id Dynamixel ID the transaction is addressed to
+* @param instruction Instruction of the transaction (INST_*)
+* @param parameters Parameter bytes the DLL is about to send
+* @return busClock time the transaction started
+*/
+qint64 DynamixelBus::beginTransaction(int id, int instruction, const QVector<int> &parameters){
+    if (busCapture) busCapture->record(busCaptureBus, BusCapture::Transmit, encodePacket(id, instruction, parameters).wire);
+    return busClock.nsecsElapsed();
+}
+
+
+/**
+* Reads the DLL result of the transaction that just completed and feeds it to the
+* health tracker (bus must be held). A missing status packet is only a failure if
+* the device's status return level owes one; otherwise the instruction went out and
+* the result is COMM_TXSUCCESS. A status packet that did arrive is rebuilt from the
+* DLL's receive buffer and recorded into the capture, if any.
+* @param id Dynamixel ID the transaction was addressed to
+* @param instruction Instruction of the transaction (INST_*)
+* @param startNsec busClock time the transaction started
+* @return Communication result
+*/
+int DynamixelBus::finishTransaction(int id, int instruction, qint64 startNsec){
+    int result = dxl_get_result();
+    if (id == BROADCAST_ID) return result;
+
+    if (busCapture && result == COMM_RXSUCCESS){
+        int length = dxl_get_rxpacket_length();
+        int error = statusErrorBits();
+        int checksum = id + length + error;
+        QByteArray wire;
+        wire.reserve(length + 4);
+        wire.append((char)0xFF);
+        wire.append((char)0xFF);
+        wire.append((char)id);
+        wire.append((char)length);
+        wire.append((char)error);
+        for (int i = 0; i < length - 2; i++){
+            int value = dxl_get_rxpacket_parameter(i);
+            wire.append((char)value);
+            checksum += value & 0xFF;
+        }
+        wire.append((char)(~checksum & 0xFF));
+        busCapture->record(busCaptureBus, BusCapture::Receive, wire);
+    }
+
+    if (result == COMM_RXSUCCESS) busHealth.recordSuccess(id, (busClock.nsecsElapsed() - startNsec) / 1000);
+    else if (busHealth.owesReply(id, instruction)) busHealth.recordFailure(id);
+    else if (result == COMM_RXTIMEOUT && instruction != INST_READ) result = COMM_TXSUCCESS;
+    return result;
+}
+
+
+/**
+* Finishes a WRITE and collects the acknowledgement from its status packet (bus must be held)
+* @param id Dynamixel ID the write was addressed to
+* @param startNsec busClock time the transaction started
+* @return Communication result and error bits
+*/
+WriteResult DynamixelBus::acknowledge(int id, qint64 startNsec){
+    WriteResult acknowledgement = { id, finishTransaction(id, INST_WRITE, startNsec), 0 };
+    if (acknowledgement.result == COMM_RXSUCCESS && id != BROADCAST_ID) acknowledgement.error = statusErrorBits();
+    return acknowledgement;
+}
+
+
+/**
+* Collects the error bits of the last status packet (bus must be held)
+* @return Error byte, see ERRBIT_*
+*/
+int DynamixelBus::statusErrorBits(void){
+    int error = 0;
+    for (int bit = ERRBIT_VOLTAGE; bit <= ERRBIT_INSTRUCTION; bit <<= 1){
+        if (dxl_get_rxpacket_error(bit)) error |= bit;
+    }
+    return error;
+}
@@ -0,0 +1,140 @@
+#ifndef DYNAMIXELBUS_H
+#define DYNAMIXELBUS_H
+#include "busarbiter.h"
+#include "devicehealth.h"
+#include "statuspacketparser.h"
+#include <QVector>
+#include <QList>
+#include <QMap>
+#include <QByteArray>
+
+class QSerialPort;
+class BusCapture;
+
+// Local communication result, never returned by the DLL: the value was refused
+// as out of range before anything was sent
+const int COMM_RANGEERROR = 16;
+
+/**
+ * @brief The BulkReadRequest struct : One device and address range of a bulk read
+ */
+struct BulkReadRequest
+{
+    int id;
+    int address;
+    int length;
+};
+
+/**
+ * @brief The BulkReadReply struct : Decoded status reply to one BulkReadRequest
+ */
+struct BulkReadReply
+{
+    int id;
+    int address;
+    int result;         // Communication result, COMM_RXSUCCESS on success
+    int error;          // Status packet error bits (ERRBIT_*)
+    QVector<int> data;  // One entry per byte read, empty on failure
+};
+
+/**
+ * @brief The WriteResult struct : Acknowledgement of a WRITE to one device, taken from
+ * the status packet the device answers the write with (no extra bus traffic)
+ */
+struct WriteResult
+{
+    int id;
+    int result;         // Communication result, COMM_RXSUCCESS once the status packet arrived, COMM_TXSUCCESS if none is owed, COMM_RANGEERROR if refused locally
+    int error;          // Status packet error bits (ERRBIT_*), 0 when no status packet was received
+    bool succeeded(void) const;
+};
+
+/**
+ * @brief The InstructionPacket struct : A fully encoded instruction packet, see DynamixelBus::encodePacket
+ */
+struct InstructionPacket
+{
+    int id;
+    int instruction;
+    QVector<int> parameters;
+    QByteArray wire;    // 0xFF 0xFF id length instruction parameters checksum
+};
+
+/**
+ * @brief The DynamixelBus class : Serialises access to the Dynamixel DLL.
+ * The DLL keeps a single global instruction/status packet buffer, so every
+ * transaction goes through the BusArbiter, which orders waiting transactions by
+ * priority class. Callers that need several transactions to happen back to back
+ * (e.g. read followed by reset) can hold a DynamixelBus::Lock around them; the
+ * bus is re-entrant for the thread that holds it. Only Safety transactions can
+ * still go in between, once the current transaction is done.
+ * Transactions to IDs that DeviceHealth considers dead are skipped and fail with
+ * COMM_RXTIMEOUT straight away instead of waiting out the DLL's receive timeout.
+ * The DLL does not expose the bytes it sends and receives, so a capture (see
+ * setCapture) gets the instruction packet as encodePacket() builds it and a status
+ * packet rebuilt from the DLL's receive buffer.
+ */
+class DynamixelBus
+{
+public:
+
+    enum { RamStartAddress = 24, LockAddress = 47 };   // AX/MX and AX-S1 control tables: EEPROM below RamStartAddress
+
+    /**
+     * @brief The Lock class : Holds the bus for the lifetime of the object
+     */
+    class Lock
+    {
+    public:
+        explicit Lock(BusArbiter::Priority priority);
+        ~Lock();
+        bool isAcquired(void) const;
+    private:
+        Q_DISABLE_COPY(Lock)
+        bool acquired;
+    };
+
+    static BusArbiter *arbiter(void);
+    static DeviceHealth *health(void);
+    static void setDeviceIds(const QList<int> &ids);
+    static void setCapture(BusCapture *capture, int bus = 0);
+    static QList<int> deviceIds(void);
+    static BusArbiter::Priority readPriority(int address);
+    static int readByte(int id, int address, BusArbiter::Priority priority = BusArbiter::Telemetry);
+    static WriteResult writeByte(int id, int address, int value, BusArbiter::Priority priority = BusArbiter::Control);
+    static int readWord(int id, int address, BusArbiter::Priority priority = BusArbiter::Telemetry);
+    static WriteResult writeWord(int id, int address, int value, BusArbiter::Priority priority = BusArbiter::Control);
+    static int readBlock(int id, int address, int length, QVector<int> &data,
+                         BusArbiter::Priority priority = BusArbiter::Telemetry, int *error = 0);
+    static int writeBlock(int id, int address, const QVector<int> &data,
+                          BusArbiter::Priority priority = BusArbiter::Control, int *error = 0);
+    static int syncWrite(int address, int length, const QMap<int, QVector<int> > &data,
+                         BusArbiter::Priority priority = BusArbiter::Control);
+    static QList<WriteResult> writeFleet(int address, int length, const QMap<int, QVector<int> > &data,
+                                         BusArbiter::Priority priority = BusArbiter::Control);
+    static QList<WriteResult> writeEach(int address, const QMap<int, QVector<int> > &data,
+                                        BusArbiter::Priority priority = BusArbiter::Control);
+    static QList<BulkReadReply> bulkRead(const QList<BulkReadRequest> &requests,
+                                         BusArbiter::Priority priority = BusArbiter::Telemetry);
+    static InstructionPacket encodePacket(int id, int instruction, const QVector<int> &parameters);
+    static QList<InstructionPacket> encodeSyncWrite(int address, int length, const QMap<int, QVector<int> > &data);
+    static InstructionPacket encodeRead(int id, int address, int length);
+    static InstructionPacket encodeWrite(int id, int address, const QVector<int> &data);
+    static QList<InstructionPacket> encodeBulkRead(const QList<BulkReadRequest> &requests, QList<QList<int> > &batches);
+    static int decodeStatus(int result, const QList<StatusPacket> &replies, int id, int length,
+                            QVector<int> &data, int *error = 0);
+    static BulkReadReply decodeBulkRead(const BulkReadRequest &request, int result, const QList<StatusPacket> &replies);
+    static bool openPort(QSerialPort *port, const QString &portName, int baudRate);
+    static int transmitPacket(const InstructionPacket &packet,
+                              BusArbiter::Priority priority = BusArbiter::Control);
+
+private:
+
+    static qint64 beginTransaction(int id, int instruction, const QVector<int> &parameters);
+    static int finishTransaction(int id, int instruction, qint64 startNsec);
+    static int statusErrorBits(void);
+    static WriteResult acknowledge(int id, qint64 startNsec);
+
+};
+
+#endif // DYNAMIXELBUS_H
@@ -0,0 +1,225 @@
+#include "fleetprovisioner.h"
+#include "actuatorcontrol.h"
+#include "dynamixelbus.h"
+#include "dynamixel_control.h"
+#include <QPair>
+
+const int EEPROM_START_ADDRESS = 0;
+const int EEPROM_LENGTH = 19; // model number(l) through alarm shutdown
+const int EEPROM_WORD_ADDRESSES[] = { 0, 6, 8, 14 };   // low bytes of model number, CW/CCW angle limit, max torque
+const int EEPROM_WORD_COUNT = sizeof(EEPROM_WORD_ADDRESSES) / sizeof(EEPROM_WORD_ADDRESSES[0]);
+
+
+/**
+* Returns the low byte address of the EEPROM word register an address belongs to
+* @param address Memory address
+* @return Low byte address, -1 for single byte registers
+*/
+static int wordAddress(int address){
+    for (int i = 0; i < EEPROM_WORD_COUNT; i++){
+        if (address == EEPROM_WORD_ADDRESSES[i] || address == EEPROM_WORD_ADDRESSES[i] + 1) return EEPROM_WORD_ADDRESSES[i];
+    }
+    return -1;
+}
+
+
+FleetProvisioner::FleetProvisioner() :
+    broadcastAllowed(false)
+{
+}
+
+
+/**
+* Sets (replaces) the profile of one actuator
+* @param id Dynamixel actuator ID
+* @param settings Control table name -> value, e.g. "return delay time" -> 0
+*/
+void FleetProvisioner::setProfile(int id, const QMap<QString, int> &settings){
+    profiles[id] = settings;
+}
+
+
+/**
+* Removes the profile of one actuator
+* @param id Dynamixel actuator ID
+*/
+void FleetProvisioner::removeProfile(int id){
+    profiles.remove(id);
+}
+
+
+/**
+* Returns the profiled IDs
+* @return Dynamixel actuator IDs
+*/
+QList<int> FleetProvisioner::ids(void) const{
+    return profiles.keys();
+}
+
+
+/**
+* Returns whether identical changes may be sent to BROADCAST_ID
+* @return true/false
+*/
+bool FleetProvisioner::isBroadcastAllowed(void) const{
+    return broadcastAllowed;
+}
+
+
+/**
+* Allows identical changes on every profiled ID to be sent to BROADCAST_ID.
+* Only enable this when no unprofiled device is connected to the bus.
+* @param allowed true/false
+*/
+void FleetProvisioner::setBroadcastAllowed(bool allowed){
+    broadcastAllowed = allowed;
+}
+
+
+/**
+* Brings the EEPROM of every profiled actuator in line with its profile
+* @return One result per profiled ID
+*/
+QList<ProvisioningResult> FleetProvisioner::apply(void){
+    QMap<int, ProvisioningResult> results;
+    QMap<int, QMap<int, int> > targets;
+    QList<BulkReadRequest> requests;
+
+    QMap<int, QMap<QString, int> >::const_iterator profile;
+    for (profile = profiles.constBegin(); profile != profiles.constEnd(); ++profile){
+        ProvisioningResult &result = results[profile.key()];
+        result.id = profile.key();
+        result.changedBytes = 0;
+        result.verified = false;
+        targets[profile.key()] = targetBytes(profile.value(), result.errors);
+
+        BulkReadRequest request = { profile.key(), EEPROM_START_ADDRESS, EEPROM_LENGTH };
+        requests << request;
+    }
+
+    // Diff against the current EEPROM contents and group identical ranges across IDs
+    QMap<QPair<int, int>, QMap<int, QVector<int> > > writes; // (address, length) -> ID -> bytes
+    foreach (const BulkReadReply &reply, DynamixelBus::bulkRead(requests, BusArbiter::Diagnostics)){
+        if (reply.result != COMM_RXSUCCESS){
+            results[reply.id].errors << QString("EEPROM read failed (result %1)").arg(reply.result);
+            continue;
+        }
+        foreach (const Range &range, changedRanges(targets[reply.id], reply.data)){
+            writes[qMakePair(range.address, range.bytes.size())][reply.id] = range.bytes;
+            results[reply.id].changedBytes += range.bytes.size();
+        }
+    }
+
+    QMap<QPair<int, int>, QMap<int, QVector<int> > >::const_iterator write;
+    for (write = writes.constBegin(); write != writes.constEnd(); ++write){
+        int address = write.key().first;
+        const QMap<int, QVector<int> > &data = write.value();
+
+        bool identical = data.size() == profiles.size();
+        for (QMap<int, QVector<int> >::const_iterator it = data.constBegin(); identical && it != data.constEnd(); ++it){
+            identical = it.value() == data.constBegin().value();
+        }
+
+        if (identical && broadcastAllowed && data.size() > 1){
+            DynamixelBus::writeBlock(BROADCAST_ID, address, data.constBegin().value(), BusArbiter::Diagnostics);
+        }
+        else if (data.size() > 1){
+            DynamixelBus::syncWrite(address, write.key().second, data, BusArbiter::Diagnostics);
+        }
+        else{
+            DynamixelBus::writeBlock(data.constBegin().key(), address, data.constBegin().value(), BusArbiter::Diagnostics);
+        }
+    }
+
+    // Verify; EEPROM writes are refused silently while the lock is set
+    foreach (const BulkReadReply &reply, DynamixelBus::bulkRead(requests, BusArbiter::Diagnostics)){
+        ProvisioningResult &result = results[reply.id];
+        if (reply.result != COMM_RXSUCCESS){
+            result.errors << QString("Verification read failed (result %1)").arg(reply.result);
+            continue;
+        }
+        result.verified = changedRanges(targets[reply.id], reply.data).isEmpty();
+        if (!result.verified) result.errors << QString("EEPROM does not match the profile (EEPROM locked?)");
+    }
+
+    return results.values();
+}
+
+
+/**
+* Converts a profile into the EEPROM bytes it demands
+* @param settings Control table name -> value
+* @param errors Receives a message per setting that was refused
+* @return Address -> byte value
+*/
+QMap<int, int> FleetProvisioner::targetBytes(const QMap<QString, int> &settings, QList<QString> &errors) const{
+    QMap<int, int> bytes;
+    QMap<QString, int>::const_iterator setting;
+    for (setting = settings.constBegin(); setting != settings.constEnd(); ++setting){
+        const QString &name = setting.key();
+        int address = ActuatorControl::controlTableAddress(name);
+        bool isWord = false;
+        if (address < 0){
+            address = ActuatorControl::controlTableAddress(name + "(l)");
+            isWord = true;
+        }
+
+        if (address < 0 || address >= EEPROM_START_ADDRESS + EEPROM_LENGTH){
+            errors << QString("Not an EEPROM setting: %1").arg(name);
+        }
+        else if (address <= ActuatorControl::controlTableAddress("baud rate")){
+            errors << QString("Refused to provision: %1").arg(name);
+        }
+        else if (isWord){
+            bytes[address] = setting.value() & 0xFF;
+            bytes[address + 1] = (setting.value() >> 8) & 0xFF;
+        }
+        else bytes[address] = setting.value() & 0xFF;
+    }
+    return bytes;
+}
+
+
+/**
+* Returns the contiguous address ranges where target and current EEPROM differ.
+* A word register is written as a whole even if only one of its bytes differs (the
+* device takes both bytes of a word in one instruction); the byte the target leaves
+* alone keeps its current value.
+* @param target Address -> demanded byte value
+* @param current EEPROM contents from EEPROM_START_ADDRESS
+* @return Ranges to write, in address order
+*/
+QList<FleetProvisioner::Range> FleetProvisioner::changedRanges(const QMap<int, int> &target, const QVector<int> &current){
+    QMap<int, int> changed;
+    QMap<int, int>::const_iterator it;
+    for (it = target.constBegin(); it != target.constEnd(); ++it){
+        int index = it.key() - EEPROM_START_ADDRESS;
+        if (index < 0 || index >= current.size() || current.at(index) == it.value()) continue;
+
+        int word = wordAddress(it.key());
+        if (word < 0){
+            changed[it.key()] = it.value();
+            continue;
+        }
+        for (int address = word; address <= word + 1; address++){
+            int byteIndex = address - EEPROM_START_ADDRESS;
+            if (byteIndex >= current.size()) break;
+            changed[address] = target.value(address, current.at(byteIndex));
+        }
+    }
+
+    QList<Range> ranges;
+    Range range;
+    range.address = -1;
+    for (it = changed.constBegin(); it != changed.constEnd(); ++it){
+        if (range.address >= 0 && it.key() != range.address + range.bytes.size()){
+            ranges << range;
+            range.bytes.clear();
+            range.address = -1;
+        }
+        if (range.address < 0) range.address = it.key();
+        range.bytes << it.value();
+    }
+    if (range.address >= 0) ranges << range;
+    return ranges;
+}
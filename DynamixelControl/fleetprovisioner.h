@@ -0,0 +1,62 @@
+#ifndef FLEETPROVISIONER_H
+#define FLEETPROVISIONER_H
+#include <QMap>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief The ProvisioningResult struct : Outcome of FleetProvisioner::apply() for one ID
+ */
+struct ProvisioningResult
+{
+    int id;
+    int changedBytes;           // EEPROM bytes written, word registers counted whole
+    bool verified;              // Read-back matched the profile
+    QList<QString> errors;      // Unknown/refused settings and communication failures
+};
+
+
+/**
+ * @brief The FleetProvisioner class : Applies declarative EEPROM profiles to many actuators.
+ *
+ * A profile maps control table names (as in the ActuatorControl dictionary, word
+ * parameters without the "(l)"/"(h)" suffix, e.g. "max torque") to values.
+ * apply() reads the EEPROM area of every profiled ID in one bulk read, writes only the
+ * contiguous ranges that differ (word registers always as both bytes) and verifies
+ * with a second bulk read. A range that has
+ * to be written on several IDs goes out as one SYNC_WRITE, or as one broadcast WRITE
+ * if every profiled ID needs the same bytes and setBroadcastAllowed(true) was given
+ * (only do that when the profiled IDs are all the devices on the bus).
+ * ID and baud rate are refused, since changing them would cut off the device mid-pass.
+ */
+class FleetProvisioner
+{
+public:
+
+    FleetProvisioner();
+
+    void setProfile(int id, const QMap<QString, int> &settings);
+    void removeProfile(int id);
+    QList<int> ids(void) const;
+    bool isBroadcastAllowed(void) const;
+    void setBroadcastAllowed(bool allowed);
+
+    QList<ProvisioningResult> apply(void);
+
+private:
+
+    struct Range {
+        int address;
+        QVector<int> bytes;
+    };
+
+    QMap<int, int> targetBytes(const QMap<QString, int> &settings, QList<QString> &errors) const;
+    static QList<Range> changedRanges(const QMap<int, int> &target, const QVector<int> &current);
+
+    QMap<int, QMap<QString, int> > profiles;
+    bool broadcastAllowed;
+
+};
+
+#endif // FLEETPROVISIONER_H
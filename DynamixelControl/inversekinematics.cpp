@@ -0,0 +1,233 @@
+#include "inversekinematics.h"
+#include <qmath.h>
+
+const int DEFAULT_ITERATIONS = 16;
+const double DEFAULT_DAMPING = 0.05;
+
+
+/**
+* Creates a solver for a chain. The chain must outlive the solver; its joints
+* and limits are read on every solve().
+* @param chain Kinematic chain
+*/
+InverseKinematics::InverseKinematics(const KinematicChain &chain) :
+    chain(chain),
+    iterationCount(DEFAULT_ITERATIONS),
+    lambda(DEFAULT_DAMPING),
+    capacity(0)
+{
+}
+
+
+/**
+* Returns the number of iterations per solve
+* @return Iterations
+*/
+int InverseKinematics::iterations(void) const{
+    return iterationCount;
+}
+
+
+/**
+* Sets the number of iterations per solve (cost grows linearly)
+* @param count Iterations, minimum 1
+*/
+void InverseKinematics::setIterations(int count){
+    iterationCount = qMax(1, count);
+}
+
+
+/**
+* Returns the damping factor
+* @return Lambda, in the chain's length unit
+*/
+double InverseKinematics::damping(void) const{
+    return lambda;
+}
+
+
+/**
+* Sets the damping factor. Larger values are more stable near singularities
+* but converge more slowly.
+* @param value Lambda, in the chain's length unit
+*/
+void InverseKinematics::setDamping(double value){
+    lambda = qMax(0.0, value);
+}
+
+
+/**
+* Solves a batch of position targets
+* @param targetX X of each target
+* @param targetY Y of each target
+* @param targetZ Z of each target
+* @param count Number of targets
+* @param angles In: seed, out: solution. Joint j of target i at angles[j * count + i] (radians)
+* @param residuals Optional, receives the remaining position error of each target
+*/
+void InverseKinematics::solve(const double *targetX, const double *targetY, const double *targetZ, int count,
+                              double *angles, double *residuals){
+    const int joints = chain.jointCount();
+    if (count < 1 || joints < 1) return;
+    reserve(count);
+
+    for (int j = 0; j < joints; j++){
+        minimumAngle[j] = chain.minimumAngle(j);
+        maximumAngle[j] = chain.maximumAngle(j);
+    }
+
+    const double lambda2 = lambda * lambda;
+    for (int iteration = 0; iteration < iterationCount; iteration++){
+        forward(angles, count, true);
+
+        double *cx = column[0].data();
+        double *cy = column[1].data();
+        double *cz = column[2].data();
+        const double *px = position[0].constData();
+        const double *py = position[1].constData();
+        const double *pz = position[2].constData();
+
+        // Jacobian columns: z_j x (p_end - o_j), joint-major
+        for (int j = 0; j < joints; j++){
+            const double *ox = origin[0].constData() + j * capacity;
+            const double *oy = origin[1].constData() + j * capacity;
+            const double *oz = origin[2].constData() + j * capacity;
+            const double *zx = axis[0].constData() + j * capacity;
+            const double *zy = axis[1].constData() + j * capacity;
+            const double *zz = axis[2].constData() + j * capacity;
+            double *jx = cx + j * capacity;
+            double *jy = cy + j * capacity;
+            double *jz = cz + j * capacity;
+            for (int i = 0; i < count; i++){
+                double dx = px[i] - ox[i];
+                double dy = py[i] - oy[i];
+                double dz = pz[i] - oz[i];
+                jx[i] = zy[i] * dz - zz[i] * dy;
+                jy[i] = zz[i] * dx - zx[i] * dz;
+                jz[i] = zx[i] * dy - zy[i] * dx;
+            }
+        }
+
+        for (int i = 0; i < count; i++){
+            // A = J J^T + lambda^2 I (symmetric 3x3)
+            double a00 = lambda2, a01 = 0, a02 = 0, a11 = lambda2, a12 = 0, a22 = lambda2;
+            for (int j = 0; j < joints; j++){
+                double x = cx[j * capacity + i], y = cy[j * capacity + i], z = cz[j * capacity + i];
+                a00 += x * x; a01 += x * y; a02 += x * z;
+                a11 += y * y; a12 += y * z; a22 += z * z;
+            }
+
+            // y = A^-1 e by cofactors
+            double ex = targetX[i] - px[i];
+            double ey = targetY[i] - py[i];
+            double ez = targetZ[i] - pz[i];
+            double c00 = a11 * a22 - a12 * a12;
+            double c01 = a02 * a12 - a01 * a22;
+            double c02 = a01 * a12 - a02 * a11;
+            double c11 = a00 * a22 - a02 * a02;
+            double c12 = a01 * a02 - a00 * a12;
+            double c22 = a00 * a11 - a01 * a01;
+            double determinant = a00 * c00 + a01 * c01 + a02 * c02;
+            double inverse = determinant > 0 ? 1.0 / determinant : 0.0;
+            double yx = (c00 * ex + c01 * ey + c02 * ez) * inverse;
+            double yy = (c01 * ex + c11 * ey + c12 * ez) * inverse;
+            double yz = (c02 * ex + c12 * ey + c22 * ez) * inverse;
+
+            // dtheta = J^T y, clamped to the joint limits
+            for (int j = 0; j < joints; j++){
+                double *theta = angles + j * count + i;
+                double updated = *theta + cx[j * capacity + i] * yx + cy[j * capacity + i] * yy + cz[j * capacity + i] * yz;
+                *theta = qMin(maximumAngle[j], qMax(minimumAngle[j], updated));
+            }
+        }
+    }
+
+    if (residuals){
+        forward(angles, count, false);
+        for (int i = 0; i < count; i++){
+            double ex = targetX[i] - position[0][i];
+            double ey = targetY[i] - position[1][i];
+            double ez = targetZ[i] - position[2][i];
+            residuals[i] = qSqrt(ex * ex + ey * ey + ez * ez);
+        }
+    }
+}
+
+
+/**
+* Forward kinematics for the whole batch. Leaves the end-effector position in
+* position[]; with keepFrames, also the origin and z axis in front of every joint.
+* @param angles Joint-major angles, see solve()
+* @param count Number of targets
+* @param keepFrames Store per-joint origins and axes for the Jacobian
+*/
+void InverseKinematics::forward(const double *angles, int count, bool keepFrames){
+    double *r[9];
+    for (int k = 0; k < 9; k++){
+        r[k] = rotation[k].data();
+        for (int i = 0; i < count; i++) r[k][i] = (k % 4 == 0) ? 1.0 : 0.0;
+    }
+    double *px = position[0].data();
+    double *py = position[1].data();
+    double *pz = position[2].data();
+    for (int i = 0; i < count; i++) px[i] = py[i] = pz[i] = 0.0;
+
+    for (int j = 0; j < chain.jointCount(); j++){
+        const DHParameters &dh = chain.parameters(j);
+        const double ca = qCos(dh.alpha), sa = qSin(dh.alpha);
+        const double *theta = angles + j * count;
+
+        if (keepFrames){
+            double *ox = origin[0].data() + j * capacity;
+            double *oy = origin[1].data() + j * capacity;
+            double *oz = origin[2].data() + j * capacity;
+            double *zx = axis[0].data() + j * capacity;
+            double *zy = axis[1].data() + j * capacity;
+            double *zz = axis[2].data() + j * capacity;
+            for (int i = 0; i < count; i++){
+                ox[i] = px[i]; oy[i] = py[i]; oz[i] = pz[i];
+                zx[i] = r[2][i]; zy[i] = r[5][i]; zz[i] = r[8][i];
+            }
+        }
+
+        for (int i = 0; i < count; i++){
+            double ct = qCos(theta[i] + dh.thetaOffset), st = qSin(theta[i] + dh.thetaOffset);
+
+            // p += R * (a ct, a st, d)
+            double tx = dh.a * ct, ty = dh.a * st, tz = dh.d;
+            px[i] += r[0][i] * tx + r[1][i] * ty + r[2][i] * tz;
+            py[i] += r[3][i] * tx + r[4][i] * ty + r[5][i] * tz;
+            pz[i] += r[6][i] * tx + r[7][i] * ty + r[8][i] * tz;
+
+            // R = R * [ct, -st ca, st sa; st, ct ca, -ct sa; 0, sa, ca]
+            for (int row = 0; row < 3; row++){
+                double r0 = r[row * 3][i], r1 = r[row * 3 + 1][i], r2 = r[row * 3 + 2][i];
+                r[row * 3][i] = r0 * ct + r1 * st;
+                r[row * 3 + 1][i] = -r0 * st * ca + r1 * ct * ca + r2 * sa;
+                r[row * 3 + 2][i] = r0 * st * sa - r1 * ct * sa + r2 * ca;
+            }
+        }
+    }
+}
+
+
+/**
+* Grows the work arrays to hold a batch
+* @param count Number of targets
+*/
+void InverseKinematics::reserve(int count){
+    if (minimumAngle.size() < KinematicChain::MAX_JOINTS){
+        minimumAngle.resize(KinematicChain::MAX_JOINTS);
+        maximumAngle.resize(KinematicChain::MAX_JOINTS);
+    }
+    if (count <= capacity) return;
+
+    capacity = count;
+    for (int k = 0; k < 9; k++) rotation[k].resize(capacity);
+    for (int k = 0; k < 3; k++){
+        position[k].resize(capacity);
+        origin[k].resize(capacity * KinematicChain::MAX_JOINTS);
+        axis[k].resize(capacity * KinematicChain::MAX_JOINTS);
+        column[k].resize(capacity * KinematicChain::MAX_JOINTS);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef INVERSEKINEMATICS_H
+#define INVERSEKINEMATICS_H
+#include "kinematicchain.h"
+#include <QVector>
+
+/**
+ * @brief The InverseKinematics class : Batched position IK for one KinematicChain.
+ *
+ * Solves many end-effector targets per call with damped least squares
+ * (dtheta = J^T (J J^T + lambda^2 I)^-1 e) for a fixed number of iterations, so the
+ * cost per call is predictable. All per-target state is kept structure-of-arrays
+ * (one contiguous array per quantity, indexed by target), so every step is a plain
+ * loop over targets without branches that the compiler can vectorise. Angles are
+ * clamped to the chain's angle limits after every iteration.
+ * Buffers grow to the largest batch seen and are reused; steady-state solving does
+ * not allocate.
+ */
+class InverseKinematics
+{
+public:
+
+    explicit InverseKinematics(const KinematicChain &chain);
+
+    int iterations(void) const;
+    void setIterations(int count);
+    double damping(void) const;
+    void setDamping(double lambda);
+
+    void solve(const double *targetX, const double *targetY, const double *targetZ, int count,
+               double *angles, double *residuals = 0);
+
+private:
+
+    void forward(const double *angles, int count, bool keepFrames);
+    void reserve(int count);
+
+    const KinematicChain &chain;
+    int iterationCount;
+    double lambda;
+    int capacity;
+
+    // Per-target work arrays, each of length capacity (joint arrays: joint * capacity + target)
+    QVector<double> rotation[9];
+    QVector<double> position[3];
+    QVector<double> origin[3];
+    QVector<double> axis[3];
+    QVector<double> column[3];
+    QVector<double> minimumAngle;
+    QVector<double> maximumAngle;
+
+};
+
+#endif // INVERSEKINEMATICS_H
@@ -0,0 +1,304 @@
+#include "jointcontroller.h"
+#include "actuatorcontrol.h"
+#include "serialtransport.h"
+#include "dynamixel_control.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+const int DEFAULT_RATE = 200;                       // one BULK_READ + one SYNC_WRITE per tick (setSerialPort)
+const int DLL_DEFAULT_RATE = 50;                    // one READ per joint on the DLL bus, see the class description
+const int DEFAULT_LOAD_LIMIT = 1000;                // of 1023
+const double SPEED_UNIT = 0.111 * 6 / 0.29;         // 0.111 rpm per speed unit, in position units/s
+
+
+/**
+* Creates an idle controller. Add joints, set setpoints, then start().
+* @param parent Parent object
+*/
+JointController::JointController(QObject *parent) :
+    QThread(parent),
+    portBaudRate(1000000),
+    ticksPerSecond(0),
+    loadLimit(DEFAULT_LOAD_LIMIT)
+{
+    resetStatistics();
+}
+
+
+/**
+* Stops the control thread before destruction
+*/
+JointController::~JointController(){
+    stop();
+}
+
+
+/**
+* Runs the loop on its own port instead of the DLL bus (only before start()). The port
+* is opened in the control thread; it must not be the port the DLL was initialised on.
+* @param portName Port, e.g. "COM4" or "/dev/ttyUSB0"; empty for the DLL bus
+* @param baudRate Baud rate in bps
+*/
+void JointController::setSerialPort(const QString &portName, int baudRate){
+    this->portName = portName;
+    portBaudRate = baudRate;
+}
+
+
+/**
+* Returns the port the loop runs on
+* @return Port name, empty for the DLL bus
+*/
+QString JointController::serialPort(void) const{
+    return portName;
+}
+
+
+/**
+* Returns why the loop could not start (the serial port did not open)
+* @return Error message, empty if none
+*/
+QString JointController::errorString(void) const{
+    QMutexLocker locker(&stagingMutex);
+    return error;
+}
+
+
+/**
+* Adds a joint (only before start()). The setpoint starts at the first measured position.
+* @param id Dynamixel actuator ID
+* @param gains Controller gains
+* @param cwAngleLimit Lowest goal position written
+* @param ccwAngleLimit Highest goal position written
+* @return Joint index
+*/
+int JointController::addJoint(int id, const JointGains &gains, int cwAngleLimit, int ccwAngleLimit){
+    QMutexLocker locker(&stagingMutex);
+    ids.append(id);
+    stagedGains.append(gains);
+    stagedPosition.append(-1);
+    stagedVelocity.append(0);
+    minimumPosition.append(cwAngleLimit);
+    maximumPosition.append(ccwAngleLimit);
+    return ids.size() - 1;
+}
+
+
+/**
+* Returns the number of joints
+* @return Joint count
+*/
+int JointController::jointCount(void) const{
+    return ids.size();
+}
+
+
+/**
+* Changes the gains of a joint; takes effect on the next tick
+* @param joint Joint index
+* @param gains Controller gains
+*/
+void JointController::setGains(int joint, const JointGains &gains){
+    QMutexLocker locker(&stagingMutex);
+    stagedGains[joint] = gains;
+}
+
+
+/**
+* Sets the target of a joint; takes effect on the next tick
+* @param joint Joint index
+* @param position Target position, raw units
+* @param velocity Target velocity for feed-forward, raw units per second
+*/
+void JointController::setSetpoint(int joint, double position, double velocity){
+    QMutexLocker locker(&stagingMutex);
+    stagedPosition[joint] = position;
+    stagedVelocity[joint] = velocity;
+}
+
+
+/**
+* Sets the load magnitude (0-1023) at which a joint counts as stalled and its integral is frozen
+* @param load Load limit
+*/
+void JointController::setLoadLimit(int load){
+    loadLimit.store(qBound(0, load, 1023));
+}
+
+
+/**
+* Returns the control rate; until setRate() is called, the default of the transport
+* in use (200 Hz with setSerialPort(), 50 Hz on the DLL bus)
+* @return Ticks per second
+*/
+int JointController::rate(void) const{
+    int ticks = ticksPerSecond.load();
+    if (ticks > 0) return ticks;
+    return portName.isEmpty() ? DLL_DEFAULT_RATE : DEFAULT_RATE;
+}
+
+
+/**
+* Sets the control rate. Each tick costs one BULK_READ plus one SYNC_WRITE on a serial
+* port, or one READ per joint plus one SYNC_WRITE on the DLL bus; watch
+* statistics().missedDeadlines when raising it.
+* @param ticks Ticks per second, range: 1-1000
+*/
+void JointController::setRate(int ticks){
+    ticksPerSecond.store(qBound(1, ticks, 1000));
+}
+
+
+/**
+* Returns the loop timing statistics
+* @return Statistics
+*/
+ControlLoopStatistics JointController::statistics(void) const{
+    QMutexLocker locker(&stagingMutex);
+    return loopStatistics;
+}
+
+
+/**
+* Clears the loop timing statistics
+*/
+void JointController::resetStatistics(void){
+    QMutexLocker locker(&stagingMutex);
+    loopStatistics.ticks = 0;
+    loopStatistics.missedDeadlines = 0;
+    loopStatistics.failedReads = 0;
+    loopStatistics.meanCycleUsec = 0;
+    loopStatistics.maxCycleUsec = 0;
+    loopStatistics.maxLatenessUsec = 0;
+}
+
+
+/**
+* Stops the control thread and waits for it. The actuators keep their last goal.
+*/
+void JointController::stop(void){
+    requestInterruption();
+    wait();
+}
+
+
+/**
+* Control loop
+*/
+void JointController::run(){
+    const int n = ids.size();
+    if (n == 0) return;
+
+    QList<BulkReadRequest> requests;
+    for (int i = 0; i < n; i++){
+        BulkReadRequest request = { ids.at(i), ActuatorControl::controlTableAddress("present position(l)"), 6 };
+        requests << request;
+    }
+
+    SerialTransport *transport = 0;
+    if (!portName.isEmpty()){
+        transport = new SerialTransport();
+        if (!transport->open(portName, portBaudRate)){
+            QMutexLocker locker(&stagingMutex);
+            error = transport->errorString();
+            delete transport;
+            return;
+        }
+    }
+    {
+        QMutexLocker locker(&stagingMutex);
+        error.clear();
+    }
+
+    QVector<double> *arrays[] = { &kp, &ki, &kd, &kff, &integralLimit, &setpoint, &setpointVelocity,
+                                  &integral, &position, &speed, &load };
+    for (unsigned k = 0; k < sizeof(arrays) / sizeof(arrays[0]); k++) arrays[k]->fill(0, n);
+    goals.clear();
+    for (int i = 0; i < n; i++) goals[ids.at(i)] = QVector<int>(2, 0);
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 scheduled = clock.nsecsElapsed();
+    qint64 lastTick = -1;
+
+    while (!isInterruptionRequested()){
+        qint64 period = 1000000000LL / rate();
+        qint64 started = clock.nsecsElapsed();
+        double dt = lastTick < 0 ? 0 : (started - lastTick) / 1e9;
+        lastTick = started;
+
+        bool complete = tick(transport, requests, dt);
+        qint64 cycle = clock.nsecsElapsed() - started;
+
+        {
+            QMutexLocker locker(&stagingMutex);
+            ControlLoopStatistics &s = loopStatistics;
+            s.ticks++;
+            if (!complete) s.failedReads++;
+            s.meanCycleUsec += (cycle / 1000.0 - s.meanCycleUsec) / s.ticks;
+            s.maxCycleUsec = qMax(s.maxCycleUsec, cycle / 1000.0);
+            s.maxLatenessUsec = qMax(s.maxLatenessUsec, (started - scheduled) / 1000.0);
+            if (cycle > period) s.missedDeadlines++;
+        }
+        if (cycle > period) emit deadlineMissed(cycle / 1000.0);
+
+        scheduled += period;
+        qint64 remaining = scheduled - clock.nsecsElapsed();
+        if (remaining > 0) usleep(remaining / 1000);
+        else scheduled = clock.nsecsElapsed();
+    }
+    delete transport;
+}
+
+
+/**
+* One read-compute-write cycle
+* @param transport Serial port of the loop, 0 for the DLL bus
+* @param requests Bulk read of addresses 36-41 for every joint
+* @param dt Seconds since the previous tick (0 on the first)
+* @return false if a joint did not answer (nothing is written then)
+*/
+bool JointController::tick(SerialTransport *transport, const QList<BulkReadRequest> &requests, double dt){
+    const int n = ids.size();
+
+    QList<BulkReadReply> replies = transport ? transport->bulkRead(requests)
+                                             : DynamixelBus::bulkRead(requests, BusArbiter::Control);
+    for (int i = 0; i < n; i++){
+        const QVector<int> &d = replies.at(i).data;
+        if (d.size() != 6) return false;
+        int rawSpeed = d.at(2) | (d.at(3) << 8);
+        int rawLoad = d.at(4) | (d.at(5) << 8);
+        position[i] = d.at(0) | (d.at(1) << 8);
+        speed[i] = (rawSpeed & 0x3FF) * (1 - 2 * ((rawSpeed >> 10) & 1)) * SPEED_UNIT;   // CW is negative
+        load[i] = (rawLoad & 0x3FF) * (1 - 2 * ((rawLoad >> 10) & 1));
+    }
+
+    {
+        QMutexLocker locker(&stagingMutex);
+        for (int i = 0; i < n; i++){
+            const JointGains &g = stagedGains.at(i);
+            kp[i] = g.kp; ki[i] = g.ki; kd[i] = g.kd; kff[i] = g.kff; integralLimit[i] = g.integralLimit;
+            if (stagedPosition.at(i) < 0) stagedPosition[i] = position[i]; // hold where we start
+            setpoint[i] = stagedPosition.at(i);
+            setpointVelocity[i] = stagedVelocity.at(i);
+        }
+    }
+
+    const double stalled = loadLimit.load();
+    for (int i = 0; i < n; i++){
+        double error = setpoint[i] - position[i];
+        double free = qAbs(load[i]) < stalled ? 1.0 : 0.0;
+        integral[i] = qBound(-integralLimit[i], integral[i] + error * dt * free, integralLimit[i]);
+        double goal = setpoint[i] + kp[i] * error + ki[i] * integral[i] - kd[i] * speed[i] + kff[i] * setpointVelocity[i];
+        int clamped = qRound(qBound(minimumPosition[i], goal, maximumPosition[i]));
+
+        QVector<int> &bytes = goals[ids.at(i)];
+        bytes[0] = clamped & 0xFF;
+        bytes[1] = (clamped >> 8) & 0xFF;
+    }
+
+    int address = ActuatorControl::controlTableAddress("goal position(l)");
+    if (transport) transport->syncWrite(address, 2, goals);
+    else DynamixelBus::syncWrite(address, 2, goals, BusArbiter::Control);
+    return true;
+}
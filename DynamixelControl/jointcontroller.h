@@ -0,0 +1,117 @@
+#ifndef JOINTCONTROLLER_H
+#define JOINTCONTROLLER_H
+#include "dynamixelbus.h"
+#include <QThread>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QVector>
+#include <QMap>
+#include <QString>
+
+class SerialTransport;
+
+/**
+ * @brief The JointGains struct : Host-side controller gains of one joint (raw position units)
+ */
+struct JointGains
+{
+    double kp;              // per unit of position error
+    double ki;              // per unit of integrated error (unit * s)
+    double kd;              // per unit/s of measured speed
+    double kff;             // per unit/s of setpoint velocity
+    double integralLimit;   // anti-windup bound on the integrated error (unit * s)
+};
+
+
+/**
+ * @brief The ControlLoopStatistics struct : Timing of JointController ticks
+ */
+struct ControlLoopStatistics
+{
+    qint64 ticks;
+    qint64 missedDeadlines;     // ticks whose read-compute-write took longer than the period
+    qint64 failedReads;         // ticks skipped because a joint did not answer
+    double meanCycleUsec;       // read-compute-write time
+    double maxCycleUsec;
+    double maxLatenessUsec;     // how late a tick started against its schedule
+};
+
+
+/**
+ * @brief The JointController class : Optional host-side PID + feed-forward position loop.
+ *
+ * Every tick reads Present Position, Speed and Load (addresses 36-41) of all joints,
+ * computes
+ *     goal = setpoint + kp * e + ki * integral(e) - kd * speed + kff * setpointVelocity
+ * for all joints at once (structure-of-arrays, no per-joint branches) and writes all
+ * goal positions back with one SYNC_WRITE. The integral is frozen while a joint's load
+ * is at its limit (stalled), to avoid windup. Tick timing is recorded in
+ * ControlLoopStatistics.
+ *
+ * With setSerialPort() the loop runs on a SerialTransport of its own, opened in the
+ * control thread: one BULK_READ for all MX series joints plus one SYNC_WRITE per tick,
+ * about 2 ms on a 12-joint rig at 1 Mbps with Return Delay Time 0. That path defaults
+ * to 200 Hz. Without it the loop shares the DLL bus (Control priority class), which
+ * cannot receive BULK_READ replies and reads one joint per READ, about 0.7 ms each with
+ * the factory return delay; that path defaults to 50 Hz. AX series joints are read
+ * with one READ each on either path.
+ */
+class JointController : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    explicit JointController(QObject *parent = 0);
+    ~JointController();
+
+    void setSerialPort(const QString &portName, int baudRate = 1000000);
+    QString serialPort(void) const;
+    QString errorString(void) const;
+    int addJoint(int id, const JointGains &gains, int cwAngleLimit = 0, int ccwAngleLimit = 1023);
+    int jointCount(void) const;
+    void setGains(int joint, const JointGains &gains);
+    void setSetpoint(int joint, double position, double velocity = 0);
+    void setLoadLimit(int load);
+    int rate(void) const;
+    void setRate(int ticksPerSecond);
+    ControlLoopStatistics statistics(void) const;
+    void resetStatistics(void);
+    void stop(void);
+
+signals:
+
+    void deadlineMissed(double cycleUsec);
+
+protected:
+
+    void run();
+
+private:
+
+    bool tick(SerialTransport *transport, const QList<BulkReadRequest> &requests, double dt);
+
+    QString portName;
+    int portBaudRate;
+    QString error;
+    QAtomicInt ticksPerSecond;      // 0 until setRate(): the default of the transport in use
+    QAtomicInt loadLimit;
+    QVector<int> ids;
+
+    // Written by the API under stagingMutex, copied into the loop arrays at each tick
+    mutable QMutex stagingMutex;
+    QVector<JointGains> stagedGains;
+    QVector<double> stagedPosition;
+    QVector<double> stagedVelocity;
+    ControlLoopStatistics loopStatistics;
+
+    // Loop state, one entry per joint
+    QVector<double> kp, ki, kd, kff, integralLimit;
+    QVector<double> setpoint, setpointVelocity, integral;
+    QVector<double> position, speed, load;
+    QVector<double> minimumPosition, maximumPosition;
+    QMap<int, QVector<int> > goals;
+
+};
+
+#endif // JOINTCONTROLLER_H
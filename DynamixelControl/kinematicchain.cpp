@@ -0,0 +1,189 @@
+#include "kinematicchain.h"
+#include "actuatorcontrol.h"
+#include "dynamixelbus.h"
+#include "dynamixel_control.h"
+#include <qmath.h>
+
+const int DEFAULT_ZERO_POSITION = 512;                          // 150 degrees, centre of an AX/RX joint
+const double DEFAULT_UNITS_PER_RADIAN = 180.0 / (M_PI * 0.29);  // 0.29 degrees per unit
+const int DEFAULT_CW_ANGLE_LIMIT = 0;
+const int DEFAULT_CCW_ANGLE_LIMIT = 1023;
+
+
+KinematicChain::KinematicChain()
+{
+}
+
+
+/**
+* Appends a joint at the end of the chain
+* @param id Dynamixel actuator ID driving the joint
+* @param parameters DH parameters of the joint
+* @param direction 1 if a positive angle increases the raw position, -1 otherwise
+* @return Joint index, -1 if the chain is full
+*/
+int KinematicChain::addJoint(int id, const DHParameters &parameters, int direction){
+    if (joints.size() >= MAX_JOINTS) return -1;
+    Joint joint;
+    joint.id = id;
+    joint.dh = parameters;
+    joint.direction = direction < 0 ? -1 : 1;
+    joint.zeroPosition = DEFAULT_ZERO_POSITION;
+    joint.unitsPerRadian = DEFAULT_UNITS_PER_RADIAN;
+    joint.cwAngleLimit = DEFAULT_CW_ANGLE_LIMIT;
+    joint.ccwAngleLimit = DEFAULT_CCW_ANGLE_LIMIT;
+    joints.append(joint);
+    return joints.size() - 1;
+}
+
+
+/**
+* Returns the number of joints
+* @return Joint count
+*/
+int KinematicChain::jointCount(void) const{
+    return joints.size();
+}
+
+
+/**
+* Returns the actuator ID of a joint
+* @param joint Joint index
+* @return Dynamixel actuator ID
+*/
+int KinematicChain::id(int joint) const{
+    return joints.at(joint).id;
+}
+
+
+/**
+* Returns the DH parameters of a joint
+* @param joint Joint index
+* @return DH parameters
+*/
+const DHParameters &KinematicChain::parameters(int joint) const{
+    return joints.at(joint).dh;
+}
+
+
+/**
+* Sets how a joint angle maps to a raw position
+* @param joint Joint index
+* @param zeroPosition Raw position at angle 0 (default 512)
+* @param unitsPerRadian Raw units per radian (default: 0.29 degrees per unit)
+*/
+void KinematicChain::setPositionMapping(int joint, int zeroPosition, double unitsPerRadian){
+    joints[joint].zeroPosition = zeroPosition;
+    joints[joint].unitsPerRadian = unitsPerRadian;
+}
+
+
+/**
+* Sets the raw position limits of a joint (normally the actuator's CW/CCW Angle Limits)
+* @param joint Joint index
+* @param cwAngleLimit Lowest raw position
+* @param ccwAngleLimit Highest raw position
+*/
+void KinematicChain::setAngleLimits(int joint, int cwAngleLimit, int ccwAngleLimit){
+    joints[joint].cwAngleLimit = cwAngleLimit;
+    joints[joint].ccwAngleLimit = ccwAngleLimit;
+}
+
+
+/**
+* Reads CW and CCW Angle Limit of every joint's actuator in one bulk read
+* @return true if every actuator answered
+*/
+bool KinematicChain::loadAngleLimits(void){
+    QList<BulkReadRequest> requests;
+    for (int i = 0; i < joints.size(); i++){
+        BulkReadRequest request = { joints.at(i).id, ActuatorControl::controlTableAddress("cw angle limit(l)"), 4 };
+        requests << request;
+    }
+
+    bool complete = true;
+    QList<BulkReadReply> replies = DynamixelBus::bulkRead(requests, BusArbiter::Diagnostics);
+    for (int i = 0; i < replies.size(); i++){
+        const QVector<int> &data = replies.at(i).data;
+        if (data.size() != 4){
+            complete = false;
+            continue;
+        }
+        setAngleLimits(i, data.at(0) | (data.at(1) << 8), data.at(2) | (data.at(3) << 8));
+    }
+    return complete;
+}
+
+
+/**
+* Returns the lowest reachable joint angle
+* @param joint Joint index
+* @return Angle in radians
+*/
+double KinematicChain::minimumAngle(int joint) const{
+    const Joint &j = joints.at(joint);
+    return qMin(fromPosition(joint, j.cwAngleLimit), fromPosition(joint, j.ccwAngleLimit));
+}
+
+
+/**
+* Returns the highest reachable joint angle
+* @param joint Joint index
+* @return Angle in radians
+*/
+double KinematicChain::maximumAngle(int joint) const{
+    const Joint &j = joints.at(joint);
+    return qMax(fromPosition(joint, j.cwAngleLimit), fromPosition(joint, j.ccwAngleLimit));
+}
+
+
+/**
+* Converts a joint angle to a raw goal position, clamped to the angle limits
+* @param joint Joint index
+* @param angle Angle in radians
+* @return Raw position
+*/
+int KinematicChain::toPosition(int joint, double angle) const{
+    const Joint &j = joints.at(joint);
+    int position = j.zeroPosition + qRound(j.direction * angle * j.unitsPerRadian);
+    return qBound(j.cwAngleLimit, position, j.ccwAngleLimit);
+}
+
+
+/**
+* Converts a raw position to a joint angle
+* @param joint Joint index
+* @param position Raw position
+* @return Angle in radians
+*/
+double KinematicChain::fromPosition(int joint, int position) const{
+    const Joint &j = joints.at(joint);
+    return j.direction * (position - j.zeroPosition) / j.unitsPerRadian;
+}
+
+
+/**
+* Converts one set of joint angles to goal positions and adds them to a sync write
+* @param angles Angle of joint i at angles[i * stride] (radians)
+* @param stride Distance between consecutive joints in the angles array
+* @param goals Receives ID -> goal position bytes (low, high)
+*/
+void KinematicChain::appendGoalPositions(const double *angles, int stride, QMap<int, QVector<int> > &goals) const{
+    for (int i = 0; i < joints.size(); i++){
+        int position = toPosition(i, angles[i * stride]);
+        QVector<int> bytes(2);
+        bytes[0] = position & 0xFF;
+        bytes[1] = (position >> 8) & 0xFF;
+        goals[joints.at(i).id] = bytes;
+    }
+}
+
+
+/**
+* Sends goal positions for any number of actuators (e.g. several chains) as one SYNC_WRITE
+* @param goals ID -> goal position bytes, see appendGoalPositions()
+* @return Communication result
+*/
+int KinematicChain::writeGoalPositions(const QMap<int, QVector<int> > &goals){
+    return DynamixelBus::syncWrite(ActuatorControl::controlTableAddress("goal position(l)"), 2, goals);
+}
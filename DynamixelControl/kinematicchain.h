@@ -0,0 +1,68 @@
+#ifndef KINEMATICCHAIN_H
+#define KINEMATICCHAIN_H
+#include <QVector>
+#include <QList>
+#include <QMap>
+
+/**
+ * @brief The DHParameters struct : Standard Denavit-Hartenberg parameters of one joint.
+ * Joint transform: Rot_z(theta + thetaOffset) * Trans_z(d) * Trans_x(a) * Rot_x(alpha).
+ * Lengths in any unit (used consistently), angles in radians.
+ */
+struct DHParameters
+{
+    double a;
+    double alpha;
+    double d;
+    double thetaOffset;
+};
+
+
+/**
+ * @brief The KinematicChain class : Serial chain of revolute joints, one Dynamixel per joint.
+ * Maps joint angles (radians, 0 = DH zero) to raw positions:
+ * position = zeroPosition + direction * angle * unitsPerRadian,
+ * clamped to the actuator's CW/CCW Angle Limits.
+ */
+class KinematicChain
+{
+public:
+
+    static const int MAX_JOINTS = 8;
+
+    KinematicChain();
+
+    int addJoint(int id, const DHParameters &parameters, int direction = 1);
+    int jointCount(void) const;
+    int id(int joint) const;
+    const DHParameters &parameters(int joint) const;
+
+    void setPositionMapping(int joint, int zeroPosition, double unitsPerRadian);
+    void setAngleLimits(int joint, int cwAngleLimit, int ccwAngleLimit);
+    bool loadAngleLimits(void);
+    double minimumAngle(int joint) const;
+    double maximumAngle(int joint) const;
+
+    int toPosition(int joint, double angle) const;
+    double fromPosition(int joint, int position) const;
+
+    void appendGoalPositions(const double *angles, int stride, QMap<int, QVector<int> > &goals) const;
+    static int writeGoalPositions(const QMap<int, QVector<int> > &goals);
+
+private:
+
+    struct Joint {
+        int id;
+        DHParameters dh;
+        int direction;
+        int zeroPosition;
+        double unitsPerRadian;
+        int cwAngleLimit;
+        int ccwAngleLimit;
+    };
+
+    QVector<Joint> joints;
+
+};
+
+#endif // KINEMATICCHAIN_H
@@ -0,0 +1,238 @@
+#include "packetcache.h"
+#include "actuatorcontrol.h"
+#include "serialtransport.h"
+#include "busdriver.h"
+#include "dynamixel_control.h"
+#include <QReadLocker>
+#include <QWriteLocker>
+
+
+PacketCache::PacketCache()
+{
+}
+
+
+/**
+* Compiles a WRITE of one register range
+* @param id Dynamixel ID, BROADCAST_ID for all
+* @param address First memory address to write
+* @param data Bytes to write, 1-(MAXNUM_TXPARAM - 1) entries
+* @return Cache key, 0 if the command is invalid
+*/
+uint PacketCache::compileWrite(int id, int address, const QVector<int> &data){
+    if (data.isEmpty() || data.size() > MAXNUM_TXPARAM - 1) return 0;
+
+    QVector<int> parameters;
+    parameters.reserve(data.size() + 1);
+    parameters << address;
+    foreach (int value, data) parameters << (value & 0xFF);
+
+    QList<InstructionPacket> packets;
+    packets << DynamixelBus::encodePacket(id, INST_WRITE, parameters);
+    return store(packets);
+}
+
+
+/**
+* Compiles a SYNC_WRITE, split into several packets if it does not fit into one
+* @param address First memory address to write
+* @param length Bytes per device
+* @param data Bytes to write per ID; entries whose size differs from length are skipped
+* @return Cache key, 0 if the command is invalid or empty
+*/
+uint PacketCache::compileSyncWrite(int address, int length, const QMap<int, QVector<int> > &data){
+    QList<InstructionPacket> packets = DynamixelBus::encodeSyncWrite(address, length, data);
+    if (packets.isEmpty()) return 0;
+    return store(packets);
+}
+
+
+/**
+* Compiles a pose: one SYNC_WRITE of Goal Position
+* @param goalPositions Dynamixel ID -> goal position, range: 0-1023
+* @return Cache key, 0 if the pose is empty
+*/
+uint PacketCache::compilePose(const QMap<int, int> &goalPositions){
+    QMap<int, QVector<int> > data;
+    QMap<int, int>::const_iterator it;
+    for (it = goalPositions.constBegin(); it != goalPositions.constEnd(); ++it){
+        int position = qBound(0, it.value(), 1023);
+        QVector<int> bytes(2);
+        bytes[0] = position & 0xFF;
+        bytes[1] = position >> 8;
+        data.insert(it.key(), bytes);
+    }
+    return compileSyncWrite(ActuatorControl::controlTableAddress("goal position(l)"), 2, data);
+}
+
+
+/**
+* Names a compiled command, replacing any previous command of that name
+* @param name Command name, e.g. "home"
+* @param key Cache key
+*/
+void PacketCache::setName(const QString &name, uint key){
+    QWriteLocker locker(&lock);
+    names.insert(name, key);
+}
+
+
+/**
+* Returns the key a command was named with
+* @param name Command name
+* @return Cache key, 0 if there is no such name
+*/
+uint PacketCache::key(const QString &name) const{
+    QReadLocker locker(&lock);
+    return names.value(name, 0);
+}
+
+
+/**
+* Returns whether a command is cached
+* @param key Cache key
+* @return true/false
+*/
+bool PacketCache::contains(uint key) const{
+    QReadLocker locker(&lock);
+    return entries.contains(key);
+}
+
+
+/**
+* Returns the packets of a command, e.g. for inspection
+* @param key Cache key
+* @return Packets in transmission order, empty if the key is unknown
+*/
+QList<InstructionPacket> PacketCache::packets(uint key) const{
+    QReadLocker locker(&lock);
+    return entries.value(key);
+}
+
+
+/**
+* Removes a command and every name pointing to it
+* @param key Cache key
+*/
+void PacketCache::remove(uint key){
+    QWriteLocker locker(&lock);
+    entries.remove(key);
+    foreach (const QString &name, names.keys(key)) names.remove(name);
+}
+
+
+/**
+* Removes every command and name
+*/
+void PacketCache::clear(void){
+    QWriteLocker locker(&lock);
+    entries.clear();
+    names.clear();
+}
+
+
+/**
+* Returns the number of distinct cached commands
+* @return Number of commands
+*/
+int PacketCache::size(void) const{
+    QReadLocker locker(&lock);
+    return entries.size();
+}
+
+
+/**
+* Sends a cached command
+* @param key Cache key
+* @param priority Bus priority class
+* @return Communication result of the last packet, COMM_TXERROR if the key is unknown
+*/
+int PacketCache::transmit(uint key, BusArbiter::Priority priority) const{
+    QList<InstructionPacket> command = packets(key);
+    if (command.isEmpty()) return COMM_TXERROR;
+
+    // a multi-packet SYNC_WRITE goes out without other transactions in between, Safety aside
+    DynamixelBus::Lock busLock(priority);
+    if (!busLock.isAcquired()) return COMM_TXFAIL;
+    int result = COMM_TXERROR;
+    foreach (const InstructionPacket &packet, command) result = DynamixelBus::transmitPacket(packet, priority);
+    return result;
+}
+
+
+/**
+* Sends a cached command through a SerialTransport, writing its wire bytes unchanged
+* @param key Cache key
+* @param transport Open transport
+* @return Communication result of the last packet, COMM_TXERROR if the key is unknown
+*/
+int PacketCache::transmit(uint key, SerialTransport *transport) const{
+    QList<InstructionPacket> command = packets(key);
+    if (command.isEmpty()) return COMM_TXERROR;
+
+    int result = COMM_TXERROR;
+    foreach (const InstructionPacket &packet, command){
+        QList<StatusPacket> replies;
+        int expected = transport->health()->owesReply(packet.id, packet.instruction) ? 1 : 0;
+        result = transport->transact(packet, expected, replies);
+        if (packet.instruction == INST_WRITE && (result == COMM_RXSUCCESS || result == COMM_TXSUCCESS))
+            transport->health()->updateStatusReturnLevel(packet.id, packet.parameters.first(), packet.parameters.mid(1));
+    }
+    return result;
+}
+
+
+/**
+* Queues a cached command on a BusDriver, which writes its wire bytes unchanged
+* @param key Cache key
+* @param driver Open driver
+* @param priority Queue priority class
+* @return Pending operation, failing with COMM_TXERROR if the key is unknown
+*/
+BusOperation *PacketCache::transmit(uint key, BusDriver *driver, BusArbiter::Priority priority) const{
+    return driver->transmit(packets(key), priority);
+}
+
+
+/**
+* Sends a cached command by name
+* @param name Command name
+* @param priority Bus priority class
+* @return Communication result of the last packet, COMM_TXERROR if the name is unknown
+*/
+int PacketCache::transmit(const QString &name, BusArbiter::Priority priority) const{
+    return transmit(key(name), priority);
+}
+
+
+// INTERNAL SUBROUTINES (private) ************************************************************************
+
+/**
+* Stores encoded packets under the hash of their wire bytes
+* @param packets Encoded packets
+* @return Cache key; never 0, and probed past hash collisions between different content
+*/
+uint PacketCache::store(const QList<InstructionPacket> &packets){
+    QByteArray wire;
+    foreach (const InstructionPacket &packet, packets){
+        if (packet.wire.isEmpty()) return 0;
+        wire.append(packet.wire);
+    }
+
+    QWriteLocker locker(&lock);
+    uint key = qHash(wire);
+    forever {
+        if (key == 0){
+            key++;
+            continue;
+        }
+        if (!entries.contains(key)) break;
+
+        QByteArray existingWire;
+        foreach (const InstructionPacket &packet, entries.value(key)) existingWire.append(packet.wire);
+        if (existingWire == wire) return key;
+        key++;
+    }
+    entries.insert(key, packets);
+    return key;
+}
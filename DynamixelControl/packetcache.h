@@ -0,0 +1,60 @@
+#ifndef PACKETCACHE_H
+#define PACKETCACHE_H
+#include "dynamixelbus.h"
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+class SerialTransport;
+class BusDriver;
+class BusOperation;
+
+/**
+ * @brief The PacketCache class : Compiled instruction packets for recurring commands.
+ *
+ * A command (a write, a SYNC_WRITE, a pose) is encoded into its final instruction
+ * packets once, validated and split at MAXNUM_TXPARAM on the way, and stored under a
+ * hash of its wire bytes. Compiling the same content twice returns the same key, so
+ * e.g. a gait made of repeated keyframes stores each distinct keyframe once.
+ * Sending it later costs one bus transaction per packet and no encoding work. On
+ * the DLL bus the DLL still copies every parameter into its packet buffer; a
+ * SerialTransport or BusDriver writes the stored wire bytes as they are.
+ * Keys can be given names; the cache may be shared between threads.
+ */
+class PacketCache
+{
+public:
+
+    PacketCache();
+
+    uint compileWrite(int id, int address, const QVector<int> &data);
+    uint compileSyncWrite(int address, int length, const QMap<int, QVector<int> > &data);
+    uint compilePose(const QMap<int, int> &goalPositions);
+
+    void setName(const QString &name, uint key);
+    uint key(const QString &name) const;
+    bool contains(uint key) const;
+    QList<InstructionPacket> packets(uint key) const;
+    void remove(uint key);
+    void clear(void);
+    int size(void) const;
+
+    int transmit(uint key, BusArbiter::Priority priority = BusArbiter::Control) const;
+    int transmit(const QString &name, BusArbiter::Priority priority = BusArbiter::Control) const;
+    int transmit(uint key, SerialTransport *transport) const;
+    BusOperation *transmit(uint key, BusDriver *driver, BusArbiter::Priority priority = BusArbiter::Control) const;
+
+private:
+
+    uint store(const QList<InstructionPacket> &packets);
+
+    mutable QReadWriteLock lock;
+    QHash<uint, QList<InstructionPacket> > entries;
+    QHash<QString, uint> names;
+
+};
+
+#endif // PACKETCACHE_H
@@ -0,0 +1,169 @@
+#include "poseestimator.h"
+#include "actuatorcontrol.h"
+#include "dynamixelbus.h"
+#include "dynamixel_control.h"
+#include <QMutexLocker>
+#include <qmath.h>
+
+
+/**
+* Creates an estimator and builds the per-joint transform tables
+* (call rebuildTables() again after changing the chain's limits or mapping)
+* @param chain Kinematic chain; must outlive the estimator
+* @param capacity Number of poses kept in the ring buffer
+*/
+PoseEstimator::PoseEstimator(const KinematicChain &chain, int capacity) :
+    chain(chain),
+    positionAddress(ActuatorControl::controlTableAddress("present position(l)")),
+    ring(qMax(1, capacity)),
+    head(0),
+    size(0)
+{
+    clock.start();
+    rebuildTables();
+}
+
+
+/**
+* Precomputes the DH transform of every joint at every raw position within its limits
+*/
+void PoseEstimator::rebuildTables(void){
+    tables.resize(chain.jointCount());
+    for (int j = 0; j < chain.jointCount(); j++){
+        const DHParameters &dh = chain.parameters(j);
+        JointTable &table = tables[j];
+        table.firstPosition = chain.toPosition(j, chain.minimumAngle(j));
+        table.lastPosition = chain.toPosition(j, chain.maximumAngle(j));
+        if (table.firstPosition > table.lastPosition) qSwap(table.firstPosition, table.lastPosition);
+
+        const double ca = qCos(dh.alpha), sa = qSin(dh.alpha);
+        table.transforms.resize(12 * (table.lastPosition - table.firstPosition + 1));
+        double *t = table.transforms.data();
+        for (int position = table.firstPosition; position <= table.lastPosition; position++, t += 12){
+            double theta = chain.fromPosition(j, position) + dh.thetaOffset;
+            double ct = qCos(theta), st = qSin(theta);
+            t[0] = ct; t[1] = -st * ca; t[2] = st * sa;  t[3] = dh.a * ct;
+            t[4] = st; t[5] = ct * ca;  t[6] = -ct * sa; t[7] = dh.a * st;
+            t[8] = 0;  t[9] = sa;       t[10] = ca;      t[11] = dh.d;
+        }
+    }
+}
+
+
+/**
+* Reads all joint positions, one READ per joint, and appends the resulting pose.
+* Each read is timed on its own; the pose gets the mean and the spread of those times.
+* @return true if every joint answered (otherwise nothing is appended)
+*/
+bool PoseEstimator::sample(void){
+    int positions[KinematicChain::MAX_JOINTS];
+    qint64 sum = 0, first = 0, last = 0;
+    QVector<int> data;
+
+    for (int j = 0; j < chain.jointCount(); j++){
+        qint64 start = clock.nsecsElapsed();
+        int result = DynamixelBus::readBlock(chain.id(j), positionAddress, 2, data, BusArbiter::Telemetry);
+        qint64 readAt = start + (clock.nsecsElapsed() - start) / 2;
+        if (result != COMM_RXSUCCESS) return false;
+
+        positions[j] = data.at(0) | (data.at(1) << 8);
+        if (j == 0) first = readAt;
+        last = readAt;
+        sum += readAt;
+    }
+    if (chain.jointCount() == 0) return false;
+    process(positions, sum / chain.jointCount(), last - first);
+    return true;
+}
+
+
+/**
+* Computes the pose for one set of raw positions and appends it to the ring buffer.
+* Positions outside a joint's limits are clamped to them.
+* @param positions Raw present position of each joint, in chain order
+* @param timestamp Sample time, ns on this estimator's clock (see clockTime())
+* @param span ns between the first and the last position's read time, 0 for one instant
+*/
+void PoseEstimator::process(const int *positions, qint64 timestamp, qint64 span){
+    double r[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+    double p[3] = { 0, 0, 0 };
+
+    for (int j = 0; j < tables.size(); j++){
+        const JointTable &table = tables.at(j);
+        int index = qBound(table.firstPosition, positions[j], table.lastPosition) - table.firstPosition;
+        const double *t = table.transforms.constData() + 12 * index;
+
+        for (int row = 0; row < 3; row++){
+            const double r0 = r[row * 3], r1 = r[row * 3 + 1], r2 = r[row * 3 + 2];
+            p[row] += r0 * t[3] + r1 * t[7] + r2 * t[11];
+            r[row * 3] = r0 * t[0] + r1 * t[4] + r2 * t[8];
+            r[row * 3 + 1] = r0 * t[1] + r1 * t[5] + r2 * t[9];
+            r[row * 3 + 2] = r0 * t[2] + r1 * t[6] + r2 * t[10];
+        }
+    }
+
+    QMutexLocker locker(&ringMutex);
+    Pose &pose = ring[head];
+    pose.timestamp = timestamp;
+    pose.span = span;
+    for (int k = 0; k < 9; k++) pose.rotation[k] = r[k];
+    for (int k = 0; k < 3; k++) pose.position[k] = p[k];
+    head = (head + 1) % ring.size();
+    if (size < ring.size()) size++;
+}
+
+
+/**
+* Returns the ring buffer capacity
+* @return Poses
+*/
+int PoseEstimator::capacity(void) const{
+    return ring.size();
+}
+
+
+/**
+* Returns the number of poses in the ring buffer
+* @return Poses
+*/
+int PoseEstimator::count(void) const{
+    QMutexLocker locker(&ringMutex);
+    return size;
+}
+
+
+/**
+* Copies the newest pose
+* @param pose Receives the pose
+* @return false if no pose has been computed yet
+*/
+bool PoseEstimator::latest(Pose &pose) const{
+    QMutexLocker locker(&ringMutex);
+    if (size == 0) return false;
+    pose = ring.at((head + ring.size() - 1) % ring.size());
+    return true;
+}
+
+
+/**
+* Copies the newest poses, oldest first
+* @param poses Receives up to maxCount poses
+* @param maxCount Capacity of poses
+* @return Number of poses copied
+*/
+int PoseEstimator::history(Pose *poses, int maxCount) const{
+    QMutexLocker locker(&ringMutex);
+    int n = qMin(maxCount, size);
+    int first = (head + ring.size() - n) % ring.size();
+    for (int i = 0; i < n; i++) poses[i] = ring.at((first + i) % ring.size());
+    return n;
+}
+
+
+/**
+* Returns the current time on the clock used for pose timestamps
+* @return ns
+*/
+qint64 PoseEstimator::clockTime(void) const{
+    return clock.nsecsElapsed();
+}
@@ -0,0 +1,67 @@
+#ifndef POSEESTIMATOR_H
+#define POSEESTIMATOR_H
+#include "kinematicchain.h"
+#include <QVector>
+#include <QMutex>
+#include <QElapsedTimer>
+
+/**
+ * @brief The Pose struct : End-effector pose of a chain at one instant
+ */
+struct Pose
+{
+    qint64 timestamp;       // ns on PoseEstimator's clock, mean of the joints' read times
+    qint64 span;            // ns between the first and the last joint's read time
+    double rotation[9];     // row-major 3x3, base frame
+    double position[3];     // base frame, chain length unit
+};
+
+
+/**
+ * @brief The PoseEstimator class : Forward kinematics from present-position snapshots.
+ *
+ * sample() reads the present position of every joint, one READ after another,
+ * computes the end-effector pose and appends it to a fixed-size ring buffer. The
+ * joints are not read at one instant: the pose is stamped with the mean of their
+ * read times and keeps the spread between the first and the last one. The trigonometry is
+ * precomputed: each joint has a table of its DH transform for every raw position
+ * within its angle limits, so a pose costs one 4x4 product per joint and no
+ * allocation. Readers (latest(), history()) may run in other threads.
+ */
+class PoseEstimator
+{
+public:
+
+    PoseEstimator(const KinematicChain &chain, int capacity = 1024);
+
+    void rebuildTables(void);
+    bool sample(void);
+    void process(const int *positions, qint64 timestamp, qint64 span = 0);
+
+    int capacity(void) const;
+    int count(void) const;
+    bool latest(Pose &pose) const;
+    int history(Pose *poses, int maxCount) const;
+    qint64 clockTime(void) const;
+
+private:
+
+    struct JointTable {
+        int firstPosition;
+        int lastPosition;
+        QVector<double> transforms; // 12 per position: row-major 3x4 [R | t]
+    };
+
+    const KinematicChain &chain;
+    QVector<JointTable> tables;
+    QElapsedTimer clock;
+    int positionAddress;
+
+    mutable QMutex ringMutex;
+    QVector<Pose> ring;
+    int head;
+    int size;
+
+};
+
+#endif // POSEESTIMATOR_H
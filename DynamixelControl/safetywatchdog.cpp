@@ -0,0 +1,159 @@
+#include "safetywatchdog.h"
+#include "actuatorcontrol.h"
+#include "dynamixel_control.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+const int CHECKS_PER_DEADLINE = 4;
+const int MIN_CHECK_INTERVAL = 1000;            // usec
+const int MAX_TRANSACTION_TIME = 20000;         // usec, longest transaction the DLL lets run (receive timeout)
+
+
+SafetyWatchdog::SafetyWatchdog(int deadlineMsec, QObject *parent) :
+    QThread(parent),
+    beats(0),
+    deadlineMsec(qMax(1, deadlineMsec)),
+    trippedFlag(0)
+{
+    stats.trips = 0;
+    stats.lastLatencyUsec = 0;
+    stats.maxLatencyUsec = 0;
+    stats.boundUsec = latencyBound();
+    stats.boundViolations = 0;
+}
+
+
+SafetyWatchdog::~SafetyWatchdog(){
+    stop();
+}
+
+
+/**
+* Signals that the control loop is alive; call at least once per deadline
+*/
+void SafetyWatchdog::heartbeat(void){
+    beats.fetchAndAddRelaxed(1);
+}
+
+
+/**
+* Returns the heartbeat deadline
+* @return Milliseconds
+*/
+int SafetyWatchdog::deadline(void) const{
+    return deadlineMsec.load();
+}
+
+
+/**
+* Sets the heartbeat deadline
+* @param msec Milliseconds, at least 1
+*/
+void SafetyWatchdog::setDeadline(int msec){
+    deadlineMsec.store(qMax(1, msec));
+    QMutexLocker locker(&statisticsMutex);
+    stats.boundUsec = latencyBound();
+}
+
+
+/**
+* Returns whether the watchdog has turned torque off
+* @return true/false
+*/
+bool SafetyWatchdog::isTripped(void) const{
+    return trippedFlag.load() != 0;
+}
+
+
+/**
+* Re-arms a tripped watchdog; torque has to be re-enabled by the application
+*/
+void SafetyWatchdog::rearm(void){
+    heartbeat();
+    trippedFlag.store(0);
+}
+
+
+/**
+* Returns the guaranteed worst case from a missed deadline until the torque-off has
+* been sent: one check interval, one bus transaction in flight (a Lock held across
+* several is preempted at the next one) and the torque-off transaction itself
+* @return Microseconds
+*/
+double SafetyWatchdog::latencyBound(void) const{
+    int checkInterval = qMax(MIN_CHECK_INTERVAL, deadlineMsec.load() * 1000 / CHECKS_PER_DEADLINE);
+    return checkInterval + 2 * MAX_TRANSACTION_TIME;
+}
+
+
+/**
+* Returns trip count and measured reaction times
+* @return Statistics
+*/
+SafetyStatistics SafetyWatchdog::statistics(void) const{
+    QMutexLocker locker(&statisticsMutex);
+    return stats;
+}
+
+
+/**
+* Stops the watchdog thread and waits for it
+*/
+void SafetyWatchdog::stop(void){
+    requestInterruption();
+    wait();
+}
+
+
+/**
+* Watchdog loop
+*/
+void SafetyWatchdog::run(){
+    // whatever priority start() was given, a late check would stretch the bound
+    setPriority(QThread::TimeCriticalPriority);
+
+    // encoded once, so tripping costs no lookups or allocation
+    QVector<int> parameters;
+    parameters << ActuatorControl::controlTableAddress("torque enable") << 0;
+    const InstructionPacket torqueOff = DynamixelBus::encodePacket(BROADCAST_ID, INST_WRITE, parameters);
+
+    QElapsedTimer clock;
+    clock.start();
+    int lastBeats = beats.load();
+    qint64 lastBeatNsec = 0;
+    qint64 lastSentNsec = 0;
+
+    while (!isInterruptionRequested()){
+        qint64 deadlineNsec = deadlineMsec.load() * 1000000LL;
+        qint64 now = clock.nsecsElapsed();
+
+        int current = beats.load();
+        if (current != lastBeats){
+            lastBeats = current;
+            lastBeatNsec = now;
+        }
+
+        qint64 missedAt = lastBeatNsec + deadlineNsec;
+        if (now >= missedAt){
+            bool first = trippedFlag.testAndSetOrdered(0, 1);
+            if (first || now - lastSentNsec >= deadlineNsec){
+                DynamixelBus::transmitPacket(torqueOff, BusArbiter::Safety);
+                lastSentNsec = clock.nsecsElapsed();
+            }
+            if (first){
+                double latency = (lastSentNsec - missedAt) / 1000.0;
+                {
+                    QMutexLocker locker(&statisticsMutex);
+                    stats.trips++;
+                    stats.lastLatencyUsec = latency;
+                    stats.maxLatencyUsec = qMax(stats.maxLatencyUsec, latency);
+                    if (latency > stats.boundUsec) stats.boundViolations++;
+                }
+                emit tripped(latency);
+            }
+        }
+
+        qint64 checkInterval = qMax((qint64)MIN_CHECK_INTERVAL, deadlineNsec / 1000 / CHECKS_PER_DEADLINE);
+        usleep(checkInterval);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef SAFETYWATCHDOG_H
+#define SAFETYWATCHDOG_H
+#include "dynamixelbus.h"
+#include <QThread>
+#include <QAtomicInt>
+#include <QMutex>
+
+/**
+ * @brief The SafetyStatistics struct : Reaction times of a SafetyWatchdog
+ */
+struct SafetyStatistics
+{
+    int trips;
+    double lastLatencyUsec;     // missed deadline -> torque-off packet sent
+    double maxLatencyUsec;
+    double boundUsec;           // guaranteed worst case, see SafetyWatchdog::latencyBound()
+    int boundViolations;        // trips slower than the bound
+};
+
+
+/**
+ * @brief The SafetyWatchdog class : Turns all torque off when the control loop stops beating.
+ *
+ * The control loop calls heartbeat() at least once per deadline. The watchdog
+ * thread raises itself to time-critical priority and checks the beat every
+ * deadline/4. When a deadline is missed it sends a broadcast Torque Enable = 0 that
+ * was encoded when the watchdog started, on the Safety priority class: the arbiter
+ * hands it the bus before any queued transaction, and a thread holding the bus
+ * across several transactions (bulk reads, writeEach, multi-packet SYNC_WRITE,
+ * PacketCache) steps aside at its next transaction, so the torque-off only waits
+ * for the transaction in flight. The worst case from the missed deadline until the
+ * torque-off has been sent is therefore
+ *   check interval + one transaction in flight + the torque-off itself
+ * with the DLL's receive timeout as the length of a transaction, and is reported by
+ * latencyBound(). Every trip is measured against it.
+ *
+ * The first deadline runs from start(). Once tripped, torque stays off (and is re-sent every deadline while the loop stays
+ * silent) until rearm() is called; a control loop that resumes does not re-enable it.
+ */
+class SafetyWatchdog : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    explicit SafetyWatchdog(int deadlineMsec = 100, QObject *parent = 0);
+    ~SafetyWatchdog();
+
+    void heartbeat(void);
+    int deadline(void) const;
+    void setDeadline(int msec);
+    bool isTripped(void) const;
+    void rearm(void);
+    double latencyBound(void) const;
+    SafetyStatistics statistics(void) const;
+    void stop(void);
+
+signals:
+
+    void tripped(double latencyUsec);
+
+protected:
+
+    void run();
+
+private:
+
+    QAtomicInt beats;
+    QAtomicInt deadlineMsec;
+    QAtomicInt trippedFlag;
+    mutable QMutex statisticsMutex;
+    SafetyStatistics stats;
+
+};
+
+#endif // SAFETYWATCHDOG_H
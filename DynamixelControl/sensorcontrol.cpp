@@ -1,5 +1,6 @@
 #include "sensorcontrol.h"
 #include "dynamixel_control.h"
+#include "dynamixelbus.h"
 #include <QMap>
 #include <QList>
 #include <QString>
@@ -95,9 +96,10 @@ void SensorControl::terminate(){
 * Reads a byte or word from the Dynamixel actuator
 * @param id Dynamixel actuator ID
 * @param address Memory address to read from (see Control Table)
-* @return Value at the memory address
+* @return Value at the memory address, -1 if the address is unknown (negative)
 */
 int SensorControl::readFromDxl(int id, int address){
+    if (address < 0) return -1;
     if (isSingleByteSensorAddress(address)) return readByteFromDxl(id, address);
     else return readWordFromDxl(id, address);
 }
@@ -109,20 +111,78 @@ int SensorControl::readFromDxl(int id, int address){
 * @param id Dynamixel actuator ID
 * @param address Memory address to write to (see Control Table)
 * @param value Value to write
+* @return Write acknowledgement, COMM_TXERROR without sending if the address is unknown (negative)
 */
-void SensorControl::writeToDxl(int id, int address, int value){
+WriteResult SensorControl::writeToDxl(int id, int address, int value){
+    if (address < 0){
+        WriteResult refused = { id, COMM_TXERROR, 0 };
+        return refused;
+    }
     if (isSingleByteSensorAddress(address)) return writeByteToDxl(id, address, value);
     else return writeWordToDxl(id, address, value);
 }
 
 
+/**
+* Writes one register on several Dynamixel sensors in a single packet,
+* see DynamixelBus::writeFleet (broadcast when every device on the bus gets the same value)
+* @param address Memory address
+* @param values Dynamixel sensor ID -> value
+* @return One acknowledgement per ID, COMM_TXERROR without sending if the address is unknown (negative)
+*/
+QList<WriteResult> SensorControl::writeToDxls(int address, const QMap<int, int> &values){
+    if (address < 0){
+        QList<WriteResult> refused;
+        foreach (int id, values.keys()){
+            WriteResult result = { id, COMM_TXERROR, 0 };
+            refused << result;
+        }
+        return refused;
+    }
+    int length = isSingleByteSensorAddress(address) ? 1 : 2;
+    QMap<int, QVector<int> > data;
+    QMap<int, int>::const_iterator it;
+    for (it = values.constBegin(); it != values.constEnd(); ++it){
+        QVector<int> bytes(length);
+        bytes[0] = it.value() & 0xFF;
+        if (length == 2) bytes[1] = (it.value() >> 8) & 0xFF;
+        data.insert(it.key(), bytes);
+    }
+    return DynamixelBus::writeFleet(address, length, data);
+}
+
+
+/**
+* Writes the same value into one register of several Dynamixel sensors in a single packet
+* @param address Memory address
+* @param ids Dynamixel sensor IDs
+* @param value New value
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> SensorControl::writeToDxls(int address, const QList<int> &ids, int value){
+    QMap<int, int> values;
+    foreach (int id, ids) values.insert(id, value);
+    return writeToDxls(address, values);
+}
+
+
+/**
+* Returns the memory address of a control table parameter
+* @param name Parameter name as used in the control table dictionary, e.g. "sound data"
+* @return Memory address, -1 if the name is unknown
+*/
+int SensorControl::controlTableAddress(const QString &name){
+    return sensorControlTableDictionary.value(name, -1);
+}
+
+
 /**
 * Returns the model number of the Dynamixel
 * @param id Dynamixel actuator ID
 * @return Model number
 */
 int SensorControl::getModelNumber(int id){
-    return readFromDxl(id, sensorControlTableDictionary["version of firmware"]);
+    return readFromDxl(id, controlTableAddress("version of firmware"));
 }
 
 
@@ -132,7 +192,7 @@ int SensorControl::getModelNumber(int id){
 * @return Firmware version
 */
 int SensorControl::getVersionOfFirmware(int id){
-    return readFromDxl(id, sensorControlTableDictionary["model number(l)"]);
+    return readFromDxl(id, controlTableAddress("model number(l)"));
 }
 
 
@@ -143,7 +203,7 @@ int SensorControl::getVersionOfFirmware(int id){
 * @return Dynamixel actuator ID, range: 0-254
 */
 int SensorControl::getID(int id){
-    return readFromDxl(id, sensorControlTableDictionary["id"]);
+    return readFromDxl(id, controlTableAddress("id"));
 }
 
 
@@ -152,11 +212,12 @@ int SensorControl::getID(int id){
 * 254 is the Broadcast ID
 * @param id Dynamixel actuator ID
 * @param newID New ID value, range: 0-254
+* @return Write acknowledgement
 */
-void SensorControl::setID(int id, int newID){
+WriteResult SensorControl::setID(int id, int newID){
     if (newID < 0) newID = 0;
     if (newID > 254) newID = 254;
-    writeToDxl(id, sensorControlTableDictionary["id"], newID);
+    return writeToDxl(id, controlTableAddress("id"), newID);
 }
 
 
@@ -167,7 +228,7 @@ void SensorControl::setID(int id, int newID){
 * @return Baudrate, range: 0-254
 */
 int SensorControl::getBaudrate(int id){
-    return readFromDxl(id, sensorControlTableDictionary["baud rate"]);
+    return readFromDxl(id, controlTableAddress("baud rate"));
 }
 
 
@@ -177,11 +238,12 @@ int SensorControl::getBaudrate(int id){
 *
 * @param id Dynamixel actuator ID
 * @param newBaud New baudrate value, range: 0-254
+* @return Write acknowledgement
 */
-void SensorControl::setBaudrate(int id, int newBaud){
+WriteResult SensorControl::setBaudrate(int id, int newBaud){
     if (newBaud < 0) newBaud = 0;
     if (newBaud > 254) newBaud = 254;
-    writeToDxl(id, sensorControlTableDictionary["baud rate"], newBaud);
+    return writeToDxl(id, controlTableAddress("baud rate"), newBaud);
 }
 
 
@@ -194,7 +256,7 @@ void SensorControl::setBaudrate(int id, int newBaud){
 * @return Return Delay Time, range: 0-254
 */
 int SensorControl::getReturnDelayTime(int id){
-    return readFromDxl(id, sensorControlTableDictionary["return delay time"]);
+    return readFromDxl(id, controlTableAddress("return delay time"));
 }
 
 
@@ -205,11 +267,12 @@ int SensorControl::getReturnDelayTime(int id){
 * Unit: 2 usec
 * @param id Dynamixel actuator ID
 * @param newReturnDelayTime New Return Delay Time value, range: 0-254
+* @return Write acknowledgement
 */
-void SensorControl::setReturnDelayTime(int id, int newReturnDelayTime){
+WriteResult SensorControl::setReturnDelayTime(int id, int newReturnDelayTime){
     if (newReturnDelayTime < 0) newReturnDelayTime = 0;
     if (newReturnDelayTime > 254) newReturnDelayTime = 254;
-    writeToDxl(id, sensorControlTableDictionary["return delay time"], newReturnDelayTime);
+    return writeToDxl(id, controlTableAddress("return delay time"), newReturnDelayTime);
 }
 
 
@@ -223,7 +286,7 @@ void SensorControl::setReturnDelayTime(int id, int newReturnDelayTime){
 * @return Status Return Level, 0, 1 or 2
 */
 int SensorControl::getStatusReturnLevel(int id){
-    return readFromDxl(id, sensorControlTableDictionary["status return level"]);
+    return readFromDxl(id, controlTableAddress("status return level"));
 }
 
 /**
@@ -234,10 +297,11 @@ int SensorControl::getStatusReturnLevel(int id){
 * Value 2: Return for all commands
 * @param id Dynamixel actuator ID
 * @param value New Status Return Level value, 0, 1 or 2
+* @return Write acknowledgement
 */
-void SensorControl::setStatusReturnLevel(int id, int value){
-     if (value < 0 || value > 3) return;
-     else writeToDxl(id, sensorControlTableDictionary["status return level"], value);
+WriteResult SensorControl::setStatusReturnLevel(int id, int value){
+     if (value < 0 || value > 3) return rangeError(id);
+     else return writeToDxl(id, controlTableAddress("status return level"), value);
 }
 
 
@@ -249,7 +313,7 @@ void SensorControl::setStatusReturnLevel(int id, int value){
 * @return A value between 0-255
 */
 int SensorControl::getIRLeftFireData(int id){
-    return readFromDxl(id, sensorControlTableDictionary["ir left fire data"]);
+    return readFromDxl(id, controlTableAddress("ir left fire data"));
 }
 
 /**
@@ -260,7 +324,7 @@ int SensorControl::getIRLeftFireData(int id){
 * @return A value between 0-255
 */
 int SensorControl::getIRCenterFireData(int id){
-    return readFromDxl(id, sensorControlTableDictionary["ir center fire data"]);
+    return readFromDxl(id, controlTableAddress("ir center fire data"));
 }
 
 /**
@@ -271,7 +335,7 @@ int SensorControl::getIRCenterFireData(int id){
 * @return A value between 0-255
 */
 int SensorControl::getIRRightFireData(int id){
-    return readFromDxl(id, sensorControlTableDictionary["ir right fire data"]);
+    return readFromDxl(id, controlTableAddress("ir right fire data"));
 }
 
 /**
@@ -283,7 +347,7 @@ int SensorControl::getIRRightFireData(int id){
 * @return A value between 0-255
 */
 int SensorControl::getLightLeftData(int id){
-    return readFromDxl(id, sensorControlTableDictionary["light left data"]);
+    return readFromDxl(id, controlTableAddress("light left data"));
 }
 
 /**
@@ -295,7 +359,7 @@ int SensorControl::getLightLeftData(int id){
 * @return A value between 0-255
 */
 int SensorControl::getLightCenterData(int id){
-    return readFromDxl(id, sensorControlTableDictionary["light center data"]);
+    return readFromDxl(id, controlTableAddress("light center data"));
 }
 
 /**
@@ -307,7 +371,7 @@ int SensorControl::getLightCenterData(int id){
 * @return A value between 0-255
 */
 int SensorControl::getLightRightData(int id){
-    return readFromDxl(id, sensorControlTableDictionary["light right data"]);
+    return readFromDxl(id, controlTableAddress("light right data"));
 }
 
 /**
@@ -318,7 +382,7 @@ int SensorControl::getLightRightData(int id){
 * @return 0: no object detected within range, 1: object detected
 */
 int SensorControl::getIRObstacleDetected(int id){
-    return readFromDxl(id, sensorControlTableDictionary["ir obstacle detected"]);
+    return readFromDxl(id, controlTableAddress("ir obstacle detected"));
 }
 
 
@@ -329,7 +393,7 @@ int SensorControl::getIRObstacleDetected(int id){
 * @return 0: darker than reference value, 1: brighter than reference value
 */
 int SensorControl::getLightDetected(int id){
-    return readFromDxl(id, sensorControlTableDictionary["light detected"]);
+    return readFromDxl(id, controlTableAddress("light detected"));
 }
 
 /**
@@ -341,7 +405,7 @@ int SensorControl::getLightDetected(int id){
 * @return No sound: 127-128. Louder sounds: values close to 0 or 255
 */
 int SensorControl::getSoundData(int id){
-    return readFromDxl(id, sensorControlTableDictionary["sound data"]);
+    return readFromDxl(id, controlTableAddress("sound data"));
 }
 
 
@@ -355,7 +419,7 @@ int SensorControl::getSoundData(int id){
 * @return Maximum sound level
 */
 int SensorControl::getSoundDataMaxHold(int id){
-    return readFromDxl(id, sensorControlTableDictionary["sound data max hold"]);
+    return readFromDxl(id, controlTableAddress("sound data max hold"));
 }
 
 /**
@@ -367,9 +431,10 @@ int SensorControl::getSoundDataMaxHold(int id){
 * value will not be updated)
 * @param id Dynamixel sensor ID
 * @param value Maximum sound level value. To reset, send 0
+* @return Write acknowledgement
 */
-void SensorControl::setSoundDataMaxHold(int id, int value){
-    writeToDxl(id, sensorControlTableDictionary["sound data max hold"], value);
+WriteResult SensorControl::setSoundDataMaxHold(int id, int value){
+    return writeToDxl(id, controlTableAddress("sound data max hold"), value);
 }
 
 /**
@@ -379,16 +444,17 @@ void SensorControl::setSoundDataMaxHold(int id, int value){
 * @return
 */
 int SensorControl::getSoundDetectedCount(int id){
-    return readFromDxl(id, sensorControlTableDictionary["sound detected count"]);
+    return readFromDxl(id, controlTableAddress("sound detected count"));
 }
 
 /**
 * See online manual for information
 * @param id Dynamixel sensor ID
 * @param value
+* @return Write acknowledgement
 */
-void SensorControl::setSoundDetected(int id, int value){
-    writeToDxl(id, sensorControlTableDictionary["sound detected count"], value);
+WriteResult SensorControl::setSoundDetected(int id, int value){
+    return writeToDxl(id, controlTableAddress("sound detected count"), value);
 }
 
 /**
@@ -398,16 +464,17 @@ void SensorControl::setSoundDetected(int id, int value){
 * @return
 */
 int SensorControl::getSoundDetectedTime(int id){
-    return readFromDxl(id, sensorControlTableDictionary["sound detected time"]);
+    return readFromDxl(id, controlTableAddress("sound detected time(l)"));
 }
 
 /**
 * See online manual for information
 * @param id <Dynamixel sensor ID/param>
 * @param value
+* @return Write acknowledgement
 */
-void SensorControl::setSoundDetectedTime(int id, int value){
-    writeToDxl(id, sensorControlTableDictionary["sound detected time"], value);
+WriteResult SensorControl::setSoundDetectedTime(int id, int value){
+    return writeToDxl(id, controlTableAddress("sound detected time(l)"), value);
 }
 
 
@@ -420,7 +487,7 @@ void SensorControl::setSoundDetectedTime(int id, int value){
 * @return The current set buzzer note
 */
 int SensorControl::getBuzzerData0(int id){
-    return readFromDxl(id, sensorControlTableDictionary["buzzer data 0"]);
+    return readFromDxl(id, controlTableAddress("buzzer data 0"));
 }
 
 
@@ -430,9 +497,10 @@ int SensorControl::getBuzzerData0(int id){
 * http://support.robotis.com/en/product/auxdevice/sensor/dxl_ax_s1.htm#Ax_S1_Address_28
 * @param id Dynamixel sensor ID
 * @param noteAddress Buzzer note (see buzzer note table online)
+* @return Write acknowledgement
 */
-void SensorControl::setBuzzerData0(int id, int noteAddress){
-    writeToDxl(id, sensorControlTableDictionary["buzzer data 0"], noteAddress);
+WriteResult SensorControl::setBuzzerData0(int id, int noteAddress){
+    return writeToDxl(id, controlTableAddress("buzzer data 0"), noteAddress);
 }
 
 
@@ -444,7 +512,7 @@ void SensorControl::setBuzzerData0(int id, int noteAddress){
 * @return Unit: 0.1 second
 */
 int SensorControl::getBuzzerData1(int id){
-    return readFromDxl(id, sensorControlTableDictionary["buzzer data 1"]);
+    return readFromDxl(id, controlTableAddress("buzzer data 1"));
 }
 
 /**
@@ -452,9 +520,10 @@ int SensorControl::getBuzzerData1(int id){
 * A value of 50 --> 5 seconds.
 * @param id Dynamixel sensor ID
 * @param value Ringing time. Unit: 0.1 second
+* @return Write acknowledgement
 */
-void SensorControl::setBuzzerData1(int id, int value){
-    writeToDxl(id, sensorControlTableDictionary["buzzer data 1"], value);
+WriteResult SensorControl::setBuzzerData1(int id, int value){
+    return writeToDxl(id, controlTableAddress("buzzer data 1"), value);
 }
 
 
@@ -464,16 +533,17 @@ void SensorControl::setBuzzerData1(int id, int value){
 * @return False: 0, true: 1
 */
 int SensorControl::getRegistered(int id){
-    return readFromDxl(id, sensorControlTableDictionary["registered"]);
+    return readFromDxl(id, controlTableAddress("registered"));
 }
 
 /**
 * See online manual for instructions
 * @param id Dynamixel sensor ID
 * @param value
+* @return Write acknowledgement
 */
-void SensorControl::setRegistered(int id, int value){
-    writeToDxl(id, sensorControlTableDictionary["registered"], value);
+WriteResult SensorControl::setRegistered(int id, int value){
+    return writeToDxl(id, controlTableAddress("registered"), value);
 }
 
 /**
@@ -485,7 +555,7 @@ void SensorControl::setRegistered(int id, int value){
 * @return 2: new, unread data. 0: no new data
 */
 int SensorControl::getIRRemoconArrived(int id){
-    return readFromDxl(id, sensorControlTableDictionary["ir remocon arrived"]);
+    return readFromDxl(id, controlTableAddress("ir remocon arrived"));
 }
 
 /**
@@ -495,7 +565,7 @@ int SensorControl::getIRRemoconArrived(int id){
 * @return False: 0, true: 1
 */
 int SensorControl::getLock(int id){
-    return readFromDxl(id, sensorControlTableDictionary["lock"]);
+    return readFromDxl(id, controlTableAddress("lock"));
 }
 
 /**
@@ -503,10 +573,11 @@ int SensorControl::getLock(int id){
 * EEPROM is a memory area (addresses 0-18) that can be locked from modification
 * @param id Dynamixel actuator ID
 * @param value Lock: 1, unlock: 0
+* @return Write acknowledgement
 */
-void SensorControl::setLock(int id, int value){
-     if (value != 0 || value != 1) return;
-     else writeToDxl(id, sensorControlTableDictionary["lock"], value);
+WriteResult SensorControl::setLock(int id, int value){
+     if (value != 0 && value != 1) return rangeError(id);
+     else return writeToDxl(id, controlTableAddress("lock"), value);
 }
 
 /**
@@ -516,7 +587,7 @@ void SensorControl::setLock(int id, int value){
 * @return Received Remocon data
 */
 int SensorControl::getRemoconRXData(int id){
-    return readFromDxl(id, sensorControlTableDictionary["remocon rx data 0"]);
+    return readFromDxl(id, controlTableAddress("remocon rx data 0"));
 }
 
 /**
@@ -525,7 +596,7 @@ int SensorControl::getRemoconRXData(int id){
 * @return Remocon data to be transmitted
 */
 int SensorControl::getRemoconTXData(int id){
-    return readFromDxl(id, sensorControlTableDictionary["remocon tx data 0"]);
+    return readFromDxl(id, controlTableAddress("remocon tx data 0"));
 }
 
 /**
@@ -533,9 +604,10 @@ int SensorControl::getRemoconTXData(int id){
 * 2 bytes of data can be transmitted
 * @param id Dynamixel sensor ID
 * @param value Value to transmit via IR
+* @return Write acknowledgement
 */
-void SensorControl::setRemoconTXData(int id, int value){
-    writeToDxl(id, sensorControlTableDictionary["remocon tx data 0"], value);
+WriteResult SensorControl::setRemoconTXData(int id, int value){
+    return writeToDxl(id, controlTableAddress("remocon tx data 0"), value);
 }
 
 /**
@@ -548,7 +620,7 @@ void SensorControl::setRemoconTXData(int id, int value){
 * @return The current IR detection compare value
 */
 int SensorControl::getIRObstacleDetectCompareRD(int id){
-    return readFromDxl(id, sensorControlTableDictionary["ir obstacle detect comparerd"]);
+    return readFromDxl(id, controlTableAddress("ir obstacle detect comparerd"));
 }
 
 
@@ -559,9 +631,21 @@ int SensorControl::getIRObstacleDetectCompareRD(int id){
 * http://support.robotis.com/en/product/auxdevice/sensor/dxl_ax_s1.htm#Ax_S1_Address_34
 * @param id
 * @param value
+* @return Write acknowledgement
+*/
+WriteResult SensorControl::setIRObstacleDetectCompareRD(int id, int value){
+    return writeToDxl(id, controlTableAddress("ir obstacle detect comparerd"), value);
+}
+
+
+/**
+* Sets the IR obstacle detection compare value of several sensors in a single packet
+* @param ids Dynamixel sensor IDs
+* @param value New IR obstacle detect compare value
+* @return One acknowledgement per ID
 */
-void SensorControl::setIRObstacleDetectCompareRD(int id, int value){
-    writeToDxl(id, sensorControlTableDictionary["ir obstacle detect compared"], value);
+QList<WriteResult> SensorControl::setIRObstacleDetectCompareRD(const QList<int> &ids, int value){
+    return writeToDxls(controlTableAddress("ir obstacle detect comparerd"), ids, value);
 }
 
 /**
@@ -571,7 +655,7 @@ void SensorControl::setIRObstacleDetectCompareRD(int id, int value){
 * @return Light detect compare value
 */
 int SensorControl::getLightDetectCompareRD(int id){
-    return readFromDxl(id, sensorControlTableDictionary["light detect comparerd"]);
+    return readFromDxl(id, controlTableAddress("light detect comparerd"));
 }
 
 /**
@@ -579,9 +663,21 @@ int SensorControl::getLightDetectCompareRD(int id){
 * This value is used in the getLightDetected method.
 * @param id Dynamixel sensor ID
 * @param value New light detect compare value
+* @return Write acknowledgement
+*/
+WriteResult SensorControl::setLightDetectCompareRD(int id, int value){
+    return writeToDxl(id, controlTableAddress("light detect comparerd"), value);
+}
+
+
+/**
+* Sets the Light detect compare value of several sensors in a single packet
+* @param ids Dynamixel sensor IDs
+* @param value New light detect compare value
+* @return One acknowledgement per ID
 */
-void SensorControl::setLightDetectCompareRD(int id, int value){
-    writeToDxl(id, sensorControlTableDictionary["light detect compared"], value);
+QList<WriteResult> SensorControl::setLightDetectCompareRD(const QList<int> &ids, int value){
+    return writeToDxls(controlTableAddress("light detect comparerd"), ids, value);
 }
 
 
@@ -611,9 +707,21 @@ int SensorControl::getCurrentBuzzerNote(int id){
 * (http://support.robotis.com/en/product/auxdevice/sensor/dxl_ax_s1.htm#Ax_S1_Address_28)
 * @param id Dynamixel sensor ID
 * @param noteAddress Buzzer note to play
+* @return Write acknowledgement
 */
-void SensorControl::playBuzzerNote(int id, int noteAddress){
-    setBuzzerData0(id, noteAddress);
+WriteResult SensorControl::playBuzzerNote(int id, int noteAddress){
+    return setBuzzerData0(id, noteAddress);
+}
+
+
+/**
+* Plays the same note on several sensors at once
+* @param ids Dynamixel sensor IDs
+* @param noteAddress Note, see playBuzzerNote(int, int)
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> SensorControl::playBuzzerNote(const QList<int> &ids, int noteAddress){
+    return writeToDxls(controlTableAddress("buzzer data 0"), ids, noteAddress);
 }
 
 
@@ -634,35 +742,53 @@ int SensorControl::getBuzzerRingingTime(int id){
 *
 * @param id Dynamixel sensor ID
 * @param value Ringing time. Unit: 0.1 second
+* @return Write acknowledgement
 */
-void SensorControl::setBuzzerRingingTime(int id, int value){
-    setBuzzerData1(id, value);
+WriteResult SensorControl::setBuzzerRingingTime(int id, int value){
+    return setBuzzerData1(id, value);
+}
+
+
+/**
+* Sets the buzzer ringing time of several sensors in a single packet
+* @param ids Dynamixel sensor IDs
+* @param value Unit: 0.1 second
+* @return One acknowledgement per ID
+*/
+QList<WriteResult> SensorControl::setBuzzerRingingTime(const QList<int> &ids, int value){
+    return writeToDxls(controlTableAddress("buzzer data 1"), ids, value);
 }
 
 /**
 * Resets the Sound Data Max Hold, so that it is prepared for a new measurement.
 * @param id Dynamixel sensor ID
+* @return Write acknowledgement
 */
-void SensorControl::ResetSoundDataMaxHold(int id){
-    setSoundDataMaxHold(id, 0);
+WriteResult SensorControl::ResetSoundDataMaxHold(int id){
+    return setSoundDataMaxHold(id, 0);
 }
 
 // INTERNAL SUBROUTINES (private) ******************************************************************
 
-void SensorControl::writeByteToDxl(int id, int address, int value){
-    dxl_write_byte(id, address, value);
+WriteResult SensorControl::writeByteToDxl(int id, int address, int value){
+    return DynamixelBus::writeByte(id, address, value);
+}
+
+WriteResult SensorControl::writeWordToDxl(int id, int address, int value){
+    return DynamixelBus::writeWord(id, address, value);
 }
 
-void SensorControl::writeWordToDxl(int id, int address, int value){
-    dxl_write_word(id, address, value);
+WriteResult SensorControl::rangeError(int id){
+    WriteResult refused = { id, COMM_RANGEERROR, 0 };     // not sent, so no device error bits to report
+    return refused;
 }
 
 int SensorControl::readByteFromDxl(int id, int address){
-    return dxl_read_byte(id, address);
+    return DynamixelBus::readByte(id, address, DynamixelBus::readPriority(address));
 }
 
 int SensorControl::readWordFromDxl(int id, int address){
-    return dxl_read_word(id, address);
+    return DynamixelBus::readWord(id, address, DynamixelBus::readPriority(address));
 }
 
 bool SensorControl::isSingleByteSensorAddress(int address){
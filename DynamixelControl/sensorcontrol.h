@@ -3,6 +3,7 @@
 #include <QMap>
 #include <QList>
 #include <QString>
+#include "dynamixelbus.h"
 #include <iterator>
 #include <algorithm>
 
@@ -13,17 +14,20 @@ public:
     static int initialize(void);
     static void terminate(void);
     static int readFromDxl(int id, int address);
-    static void writeToDxl(int id, int address, int value);
+    static WriteResult writeToDxl(int id, int address, int value);
+    static QList<WriteResult> writeToDxls(int address, const QMap<int, int> &values);
+    static QList<WriteResult> writeToDxls(int address, const QList<int> &ids, int value);
+    static int controlTableAddress(const QString &name);
     static int getModelNumber(int id);
     static int getVersionOfFirmware(int id);
     static int getID(int id);
-    static void setID(int id, int newID);
+    static WriteResult setID(int id, int newID);
     static int getBaudrate(int id);
-    static void setBaudrate(int id, int newBaud);
+    static WriteResult setBaudrate(int id, int newBaud);
     static int getReturnDelayTime(int id);
-    static void setReturnDelayTime(int id, int newReturnDelayTime);
+    static WriteResult setReturnDelayTime(int id, int newReturnDelayTime);
     static int getStatusReturnLevel(int id);
-    static void setStatusReturnLevel(int id, int value);
+    static WriteResult setStatusReturnLevel(int id, int value);
     static int getIRLeftFireData(int id);
     static int getIRCenterFireData(int id);
     static int getIRRightFireData(int id);
@@ -34,38 +38,43 @@ public:
     static int getLightDetected(int id);
     static int getSoundData(int id);
     static int getSoundDataMaxHold(int id);
-    static void setSoundDataMaxHold(int id, int value);
+    static WriteResult setSoundDataMaxHold(int id, int value);
     static int getSoundDetectedCount(int id);
-    static void setSoundDetected(int id, int value);
+    static WriteResult setSoundDetected(int id, int value);
     static int getSoundDetectedTime(int id);
-    static void setSoundDetectedTime(int id, int value);
+    static WriteResult setSoundDetectedTime(int id, int value);
     static int getBuzzerData0(int id);
-    static void setBuzzerData0(int id, int noteAddress);
+    static WriteResult setBuzzerData0(int id, int noteAddress);
     static int getBuzzerData1(int id);
-    static void setBuzzerData1(int id, int value);
+    static WriteResult setBuzzerData1(int id, int value);
     static int getRegistered(int id);
-    static void setRegistered(int id, int value);
+    static WriteResult setRegistered(int id, int value);
     static int getIRRemoconArrived(int id);
     static int getLock(int id);
-    static void setLock(int id, int value);
+    static WriteResult setLock(int id, int value);
     static int getRemoconRXData(int id);
     static int getRemoconTXData(int id);
-    static void setRemoconTXData(int id, int value);
+    static WriteResult setRemoconTXData(int id, int value);
     static int getIRObstacleDetectCompareRD(int id);
-    static void setIRObstacleDetectCompareRD(int id, int value);
+    static WriteResult setIRObstacleDetectCompareRD(int id, int value);
+    static QList<WriteResult> setIRObstacleDetectCompareRD(const QList<int> &ids, int value);
     static int getLightDetectCompareRD(int id);
-    static void setLightDetectCompareRD(int id, int value);
+    static WriteResult setLightDetectCompareRD(int id, int value);
+    static QList<WriteResult> setLightDetectCompareRD(const QList<int> &ids, int value);
 
     static int getCurrentBuzzerNote(int id);
-    static void playBuzzerNote(int id, int noteAddress);
+    static WriteResult playBuzzerNote(int id, int noteAddress);
+    static QList<WriteResult> playBuzzerNote(const QList<int> &ids, int noteAddress);
     static int getBuzzerRingingTime(int id);
-    static void setBuzzerRingingTime(int id, int value);
-    static void ResetSoundDataMaxHold(int id);
+    static WriteResult setBuzzerRingingTime(int id, int value);
+    static QList<WriteResult> setBuzzerRingingTime(const QList<int> &ids, int value);
+    static WriteResult ResetSoundDataMaxHold(int id);
 
     private:
 
-    static void writeByteToDxl(int id, int address, int value);
-    static void writeWordToDxl(int id, int address, int value);
+    static WriteResult writeByteToDxl(int id, int address, int value);
+    static WriteResult writeWordToDxl(int id, int address, int value);
+    static WriteResult rangeError(int id);
     static int readByteFromDxl(int id, int address);
     static int readWordFromDxl(int id, int address);
 
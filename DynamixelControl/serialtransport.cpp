@@ -0,0 +1,304 @@
+#include "serialtransport.h"
+#include "dynamixel_control.h"
+#include <QSerialPort>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+const int DEFAULT_TIMEOUT = 20;                 // ms
+const int MODEL_NUMBER_ADDRESS = 0;
+const int BULK_READ_MODEL_COUNT = 4;
+const int BULK_READ_MODELS[BULK_READ_MODEL_COUNT] = { 29, 310, 320, 360 };    // MX-28, MX-64, MX-106, MX-12W
+
+
+SerialTransport::SerialTransport(QObject *parent) :
+    QObject(parent),
+    port(new QSerialPort(this)),
+    timeoutMsec(DEFAULT_TIMEOUT),
+    readCalls(0),
+    capture(0),
+    captureBus(0)
+{
+}
+
+
+SerialTransport::~SerialTransport(){
+    close();
+}
+
+
+/**
+* Opens a port, 8N1 without flow control
+* @param portName Port, e.g. "COM4" or "/dev/ttyUSB0"
+* @param baudRate Baud rate in bps, e.g. 1000000 for baud rate setting 1
+* @return true on success, see errorString() otherwise
+*/
+bool SerialTransport::open(const QString &portName, int baudRate){
+    if (!DynamixelBus::openPort(port, portName, baudRate)) return false;
+    statusParser.reset();
+    bulkReadCapable.clear();
+    return true;
+}
+
+
+/**
+* Closes the port
+*/
+void SerialTransport::close(void){
+    if (port->isOpen()) port->close();
+}
+
+
+/**
+* Returns whether the port is open
+* @return true/false
+*/
+bool SerialTransport::isOpen(void) const{
+    return port->isOpen();
+}
+
+
+/**
+* Returns the port name
+* @return Port name
+*/
+QString SerialTransport::portName(void) const{
+    return port->portName();
+}
+
+
+/**
+* Returns the last port error
+* @return Error description
+*/
+QString SerialTransport::errorString(void) const{
+    return port->errorString();
+}
+
+
+/**
+* Returns how long a transaction waits for its replies
+* @return Milliseconds
+*/
+int SerialTransport::timeout(void) const{
+    return timeoutMsec;
+}
+
+
+/**
+* Sets how long a transaction waits for its replies
+* @param msec Milliseconds
+*/
+void SerialTransport::setTimeout(int msec){
+    timeoutMsec = msec;
+}
+
+
+/**
+* Records every frame written and read into a capture (0 to stop); set it before
+* the first transaction, the capture must outlive the transport
+* @param capture Capture, see BusCapture::open
+* @param bus Bus index stored with the frames
+*/
+void SerialTransport::setCapture(BusCapture *capture, int bus){
+    this->capture = capture;
+    captureBus = bus;
+}
+
+
+/**
+* Returns the health tracker of the devices on this port
+* @return Health tracker
+*/
+DeviceHealth *SerialTransport::health(void){
+    return &deviceHealth;
+}
+
+
+/**
+* Sends one instruction packet and collects its status packets
+* @param packet Encoded packet, see DynamixelBus::encodePacket
+* @param expectedReplies Number of status packets to wait for, 0 for broadcasts
+* @param replies Receives the status packets in arrival order
+* @return COMM_TXSUCCESS (no reply expected), COMM_RXSUCCESS (all replies received),
+* COMM_RXCORRUPT (some missing, corrupt data seen), COMM_RXTIMEOUT (also for a dead ID) or COMM_TXFAIL
+*/
+int SerialTransport::transact(const InstructionPacket &packet, int expectedReplies, QList<StatusPacket> &replies){
+    QMutexLocker locker(&mutex);
+    replies.clear();
+    if (packet.wire.isEmpty()) return COMM_TXERROR;
+    if (!port->isOpen()) return COMM_TXFAIL;
+
+    // one device answering: skip it while dead, wait its adaptive timeout otherwise
+    bool tracked = expectedReplies == 1 && packet.id != BROADCAST_ID;
+    if (tracked && !deviceHealth.shouldAttempt(packet.id)) return COMM_RXTIMEOUT;
+    int waitMsec = tracked ? deviceHealth.timeoutMsec(packet.id, timeoutMsec) : timeoutMsec;
+
+    // anything still buffered belongs to an earlier transaction that timed out
+    port->clear(QSerialPort::Input);
+    statusParser.reset();
+    qint64 corruptBefore = statusParser.corruptCount();
+
+    if (capture) capture->record(captureBus, BusCapture::Transmit, packet.wire);
+    if (port->write(packet.wire) != packet.wire.size() || !port->waitForBytesWritten(timeoutMsec)) return COMM_TXFAIL;
+    if (expectedReplies <= 0) return COMM_TXSUCCESS;
+
+    QElapsedTimer clock;
+    clock.start();
+    while (replies.size() < expectedReplies){
+        qint64 remaining = waitMsec - clock.elapsed();
+        if (remaining <= 0 || !port->waitForReadyRead(remaining)) break;
+        QByteArray chunk = port->readAll();
+        if (capture) capture->record(captureBus, BusCapture::Receive, chunk);
+        statusParser.feed(chunk);
+        readCalls++;
+        replies << statusParser.takePackets();
+    }
+
+    if (replies.size() >= expectedReplies){
+        if (tracked) deviceHealth.recordSuccess(packet.id, clock.nsecsElapsed() / 1000);
+        return COMM_RXSUCCESS;
+    }
+    if (tracked && deviceHealth.owesReply(packet.id, packet.instruction)) deviceHealth.recordFailure(packet.id);
+    return statusParser.corruptCount() != corruptBefore ? COMM_RXCORRUPT : COMM_RXTIMEOUT;
+}
+
+
+/**
+* Reads a register range of one device
+* @param id Dynamixel ID
+* @param address Start address
+* @param length Number of bytes
+* @param data Receives the bytes read
+* @param error Receives the status packet error bits, if given
+* @return Communication result, COMM_RXSUCCESS on success
+*/
+int SerialTransport::readBlock(int id, int address, int length, QVector<int> &data, int *error){
+    QList<StatusPacket> replies;
+    int result = transact(DynamixelBus::encodeRead(id, address, length), 1, replies);
+    result = DynamixelBus::decodeStatus(result, replies, id, length, data, error);
+    if (result == COMM_RXSUCCESS) deviceHealth.updateStatusReturnLevel(id, address, data);
+    return result;
+}
+
+
+/**
+* Writes a register range of one device (no status packet is awaited for BROADCAST_ID
+* or below status return level 2)
+* @param id Dynamixel ID, BROADCAST_ID for all
+* @param address Start address
+* @param data Bytes to write
+* @param error Receives the status packet error bits, if given
+* @return Communication result
+*/
+int SerialTransport::writeBlock(int id, int address, const QVector<int> &data, int *error){
+    QList<StatusPacket> replies;
+    QVector<int> none;
+    int expected = deviceHealth.owesReply(id, INST_WRITE) ? 1 : 0;
+    int result = transact(DynamixelBus::encodeWrite(id, address, data), expected, replies);
+    result = DynamixelBus::decodeStatus(result, replies, id, 0, none, error);
+    if (result == COMM_RXSUCCESS || result == COMM_TXSUCCESS) deviceHealth.updateStatusReturnLevel(id, address, data);
+    return result;
+}
+
+
+/**
+* Reads several devices with BULK_READ (MX series): one instruction, one status packet per device.
+* An ID may appear only once per BULK_READ; repeated IDs go into a following instruction.
+* Devices without BULK_READ (AX series, told apart by their model number, which is
+* read once per ID) get a READ of their own. Dead IDs are left out and fail with COMM_RXTIMEOUT.
+* @param requests Devices and address ranges to read
+* @return One reply per request, in request order
+*/
+QList<BulkReadReply> SerialTransport::bulkRead(const QList<BulkReadRequest> &requests){
+    QList<BulkReadReply> replies;
+    QList<BulkReadRequest> pending;
+    QList<int> pendingIndex;
+    for (int i = 0; i < requests.size(); i++){
+        const BulkReadRequest &request = requests.at(i);
+        BulkReadReply reply = { request.id, request.address, COMM_RXTIMEOUT, 0, QVector<int>() };
+        if (!supportsBulkRead(request.id)){
+            reply.result = readBlock(request.id, request.address, request.length, reply.data, &reply.error);
+        } else if (deviceHealth.shouldAttempt(request.id)){
+            pending << request;
+            pendingIndex << i;
+        }
+        replies << reply;
+    }
+
+    QList<QList<int> > batches;
+    QList<InstructionPacket> packets = DynamixelBus::encodeBulkRead(pending, batches);
+    for (int p = 0; p < packets.size(); p++){
+        QList<StatusPacket> statuses;
+        int result = transact(packets.at(p), batches.at(p).size(), statuses);
+        foreach (int k, batches.at(p)){
+            BulkReadReply reply = DynamixelBus::decodeBulkRead(pending.at(k), result, statuses);
+            if (reply.result == COMM_RXSUCCESS) deviceHealth.recordSuccess(reply.id, -1);
+            else if (result != COMM_TXFAIL) deviceHealth.recordFailure(reply.id);
+            replies[pendingIndex.at(k)] = reply;
+        }
+    }
+    return replies;
+}
+
+
+/**
+* Writes the same address range on several devices with SYNC_WRITE (no status packets),
+* split into several packets if the data does not fit into one
+* @param address First memory address to write
+* @param length Bytes per device
+* @param data Bytes to write per ID; entries whose size differs from length and IDs
+* DeviceHealth considers dead are skipped
+* @return Communication result of the last packet, COMM_TXERROR if nothing was left to send
+*/
+int SerialTransport::syncWrite(int address, int length, const QMap<int, QVector<int> > &data){
+    QMap<int, QVector<int> > live;
+    QMap<int, QVector<int> >::const_iterator it;
+    for (it = data.constBegin(); it != data.constEnd(); ++it){
+        if (it.value().size() != length || deviceHealth.state(it.key()) == DeviceHealth::Dead) continue;
+        live.insert(it.key(), it.value());
+        deviceHealth.updateStatusReturnLevel(it.key(), address, it.value());
+    }
+
+    int result = COMM_TXERROR;
+    QList<StatusPacket> none;
+    foreach (const InstructionPacket &packet, DynamixelBus::encodeSyncWrite(address, length, live)) result = transact(packet, 0, none);
+    return result;
+}
+
+
+/**
+* Returns the status packet parser, e.g. for its resynchronisation statistics
+* @return Parser
+*/
+const StatusPacketParser &SerialTransport::parser(void) const{
+    return statusParser;
+}
+
+
+/**
+* Returns the number of port reads since construction; compare with parser().packetCount()
+* @return Number of reads
+*/
+qint64 SerialTransport::readCallCount(void) const{
+    return readCalls;
+}
+
+
+// INTERNAL SUBROUTINES (private) ************************************************************************
+
+/**
+* Returns whether a device understands BULK_READ, reading its model number on first use
+* @param id Dynamixel ID
+* @return true for MX series devices; false for others and while the model number cannot be read
+*/
+bool SerialTransport::supportsBulkRead(int id){
+    if (bulkReadCapable.contains(id)) return bulkReadCapable.value(id);
+
+    QVector<int> model;
+    if (readBlock(id, MODEL_NUMBER_ADDRESS, 2, model) != COMM_RXSUCCESS) return false;
+    int number = model.at(0) | (model.at(1) << 8);
+    bool capable = false;
+    for (int i = 0; i < BULK_READ_MODEL_COUNT; i++) capable = capable || number == BULK_READ_MODELS[i];
+    bulkReadCapable.insert(id, capable);
+    return capable;
+}
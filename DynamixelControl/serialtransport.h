@@ -0,0 +1,70 @@
+#ifndef SERIALTRANSPORT_H
+#define SERIALTRANSPORT_H
+#include "dynamixelbus.h"
+#include "statuspacketparser.h"
+#include "buscapture.h"
+#include <QObject>
+#include <QMutex>
+
+class QSerialPort;
+
+/**
+ * @brief The SerialTransport class : Protocol 1.0 over a QSerialPort, without the DLL.
+ *
+ * The DLL owns exactly one port and accepts one status packet per instruction.
+ * This transport writes encoded InstructionPackets itself and decodes replies with
+ * a StatusPacketParser, so every chunk a read returns is parsed completely and a
+ * single instruction may be answered by several devices. That makes BULK_READ (MX
+ * series) one bus transaction instead of one READ per device, and lets further
+ * buses run on other ports next to the DLL. AX devices on the same bus are read
+ * with one READ each.
+ * Single-device transactions wait DeviceHealth's adaptive timeout, bounded by
+ * timeout(), and transactions to dead IDs are skipped like on the DLL bus.
+ * Calls are blocking and serialised; use the transport from the thread that opened it.
+ */
+class SerialTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit SerialTransport(QObject *parent = 0);
+    ~SerialTransport();
+
+    bool open(const QString &portName, int baudRate = 1000000);
+    void close(void);
+    bool isOpen(void) const;
+    QString portName(void) const;
+    QString errorString(void) const;
+
+    int timeout(void) const;
+    void setTimeout(int msec);
+    void setCapture(BusCapture *capture, int bus = 0);
+    DeviceHealth *health(void);
+
+    int transact(const InstructionPacket &packet, int expectedReplies, QList<StatusPacket> &replies);
+    int readBlock(int id, int address, int length, QVector<int> &data, int *error = 0);
+    int writeBlock(int id, int address, const QVector<int> &data, int *error = 0);
+    QList<BulkReadReply> bulkRead(const QList<BulkReadRequest> &requests);
+    int syncWrite(int address, int length, const QMap<int, QVector<int> > &data);
+
+    const StatusPacketParser &parser(void) const;
+    qint64 readCallCount(void) const;
+
+private:
+
+    bool supportsBulkRead(int id);
+
+    QSerialPort *port;
+    StatusPacketParser statusParser;
+    QMutex mutex;
+    int timeoutMsec;
+    DeviceHealth deviceHealth;
+    qint64 readCalls;
+    BusCapture *capture;
+    int captureBus;
+    QMap<int, bool> bulkReadCapable;    // ID -> model number is MX series
+
+};
+
+#endif // SERIALTRANSPORT_H
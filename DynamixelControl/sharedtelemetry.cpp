@@ -0,0 +1,362 @@
+#include "sharedtelemetry.h"
+#include "dynamixelbus.h"
+#include <QElapsedTimer>
+#include <QMap>
+#include <QPair>
+#include <string.h>
+
+const quint32 SEGMENT_MAGIC = 0x44584C54;      // "DXLT"
+const quint32 SEGMENT_VERSION = 1;
+const int DEFAULT_SAMPLE_RATE = 50;
+const int SNAPSHOT_RETRIES = 64;
+
+
+// SHARED SEGMENT LAYOUT *********************************************************************************
+// Plain data only: every process maps the segment at its own address.
+
+struct SharedTelemetry::Slot
+{
+    QBasicAtomicInt sequence;   // odd while the owner is writing
+    qint32 id;
+    qint64 timestamp;
+    quint32 published;
+    quint8 registers[SharedDeviceState::TableSize];
+};
+
+struct SharedTelemetry::Cell
+{
+    QBasicAtomicInt sequence;   // position + 1 when full, position + capacity when free
+    SharedCommand command;
+};
+
+struct SharedTelemetry::Segment
+{
+    quint32 magic;
+    quint32 version;
+    qint32 deviceCount;
+    QBasicAtomicInt dropped;
+    QBasicAtomicInt head;       // consumer position, owner only
+    QBasicAtomicInt tail;       // producer position, claimed by CAS
+    Slot states[MaxDevices];
+    Cell cells[CommandCapacity];
+};
+
+
+SharedTelemetry::SharedTelemetry(const QString &key, QObject *parent) :
+    QThread(parent),
+    memory(key),
+    rate(DEFAULT_SAMPLE_RATE),
+    owner(false)
+{
+}
+
+
+/**
+* Stops the owner thread and detaches from the segment
+*/
+SharedTelemetry::~SharedTelemetry(){
+    stop();
+    detach();
+}
+
+
+/**
+* Creates the segment as the bus owner (a stale segment left by a crashed owner is replaced)
+* @param ids Devices to publish, at most MaxDevices
+* @return true on success, see errorString() otherwise
+*/
+bool SharedTelemetry::create(const QList<int> &ids){
+    if (ids.size() > MaxDevices) return false;
+
+    if (!memory.create(sizeof(Segment))){
+        if (memory.error() != QSharedMemory::AlreadyExists) return false;
+        // on Unix the segment outlives a crashed owner; attaching and detaching the last handle frees it
+        if (memory.attach()) memory.detach();
+        if (!memory.create(sizeof(Segment))) return false;
+    }
+
+    memory.lock();
+    Segment *s = segment();
+    memset(s, 0, sizeof(Segment));
+    s->version = SEGMENT_VERSION;
+    s->deviceCount = ids.size();
+    for (int i = 0; i < ids.size(); i++) s->states[i].id = ids.at(i);
+    for (int i = 0; i < CommandCapacity; i++) s->cells[i].sequence.store(i);
+    s->magic = SEGMENT_MAGIC;   // last, so attach() never sees a half-built segment
+    memory.unlock();
+
+    owner = true;
+    return true;
+}
+
+
+/**
+* Attaches to a segment created by the bus owner
+* @return true on success, false if there is no segment or its layout differs
+*/
+bool SharedTelemetry::attach(void){
+    if (!memory.attach()) return false;
+
+    memory.lock();
+    bool valid = memory.size() >= (int)sizeof(Segment) &&
+            segment()->magic == SEGMENT_MAGIC && segment()->version == SEGMENT_VERSION;
+    memory.unlock();
+
+    if (!valid) memory.detach();
+    owner = false;
+    return valid;
+}
+
+
+/**
+* Detaches from the segment
+*/
+void SharedTelemetry::detach(void){
+    if (memory.isAttached()) memory.detach();
+    owner = false;
+}
+
+
+/**
+* Returns the last shared memory error
+* @return Error description
+*/
+QString SharedTelemetry::errorString(void) const{
+    return memory.errorString();
+}
+
+
+/**
+* Returns the published device IDs
+* @return List of IDs
+*/
+QList<int> SharedTelemetry::devices(void) const{
+    QList<int> ids;
+    Segment *s = segment();
+    if (s == 0) return ids;
+    for (int i = 0; i < s->deviceCount; i++) ids << s->states[i].id;
+    return ids;
+}
+
+
+/**
+* Copies the latest snapshot of a device out of its seqlock slot
+* @param id Dynamixel ID
+* @param state Receives the snapshot
+* @return true if a consistent snapshot was read, false if the ID is unknown, never published or always torn
+*/
+bool SharedTelemetry::snapshot(int id, SharedDeviceState &state) const{
+    int index = slotIndex(id);
+    if (index < 0) return false;
+    Slot &slot = segment()->states[index];
+
+    for (int attempt = 0; attempt < SNAPSHOT_RETRIES; attempt++){
+        int before = slot.sequence.loadAcquire();
+        if (before & 1) continue;
+
+        state.id = slot.id;
+        state.timestamp = slot.timestamp;
+        state.sequence = slot.published;
+        memcpy(state.registers, slot.registers, sizeof(state.registers));
+
+        // a full barrier, so the copy above cannot be reordered past the check
+        if (slot.sequence.fetchAndAddOrdered(0) == before) return state.sequence != 0;
+    }
+    return false;
+}
+
+
+/**
+* Queues writes for the bus owner; it executes them after its next read pass
+* @param commands Writes, data length 1-SharedCommand::MaxData
+* @return Number of commands queued; the rest did not fit into the ring and were dropped
+*/
+int SharedTelemetry::submit(const QList<SharedCommand> &commands){
+    Segment *s = segment();
+    if (s == 0) return 0;
+
+    int queued = 0;
+    foreach (const SharedCommand &command, commands){
+        if (command.length < 1 || command.length > SharedCommand::MaxData) continue;
+
+        Cell *cell = 0;
+        int position = s->tail.load();
+        forever {
+            cell = &s->cells[(quint32)position % CommandCapacity];
+            int difference = (int)((quint32)cell->sequence.loadAcquire() - (quint32)position);
+            if (difference == 0){
+                if (s->tail.testAndSetOrdered(position, position + 1)) break;
+                position = s->tail.load();
+            } else if (difference < 0){
+                cell = 0;       // full
+                break;
+            } else {
+                position = s->tail.load();
+            }
+        }
+        if (cell == 0){
+            s->dropped.fetchAndAddRelaxed(commands.size() - queued);
+            break;
+        }
+
+        cell->command = command;
+        cell->sequence.storeRelease(position + 1);
+        queued++;
+    }
+    return queued;
+}
+
+
+/**
+* Returns the sample rate of the owner thread
+* @return Samples per second
+*/
+int SharedTelemetry::sampleRate(void) const{
+    return rate.load();
+}
+
+
+/**
+* Sets the sample rate of the owner thread
+* @param samplesPerSecond Samples per second, range: 1-1000
+*/
+void SharedTelemetry::setSampleRate(int samplesPerSecond){
+    rate.store(qBound(1, samplesPerSecond, 1000));
+}
+
+
+/**
+* Returns how many commands were dropped because the ring was full, by all processes
+* @return Number of commands
+*/
+int SharedTelemetry::droppedCommands(void) const{
+    Segment *s = segment();
+    return s != 0 ? s->dropped.load() : 0;
+}
+
+
+/**
+* Stops the owner thread and waits for it
+*/
+void SharedTelemetry::stop(void){
+    requestInterruption();
+    wait();
+}
+
+
+/**
+* Owner loop: one read pass over every device, then the queued commands
+*/
+void SharedTelemetry::run(){
+    if (!owner) return;
+    QList<int> ids = devices();
+    QVector<bool> complete(ids.size(), false);
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 nextSample = 0;
+
+    while (!isInterruptionRequested()){
+        // the EEPROM half is static; read the whole table once, then only RAM
+        QList<BulkReadRequest> requests;
+        for (int i = 0; i < ids.size(); i++){
+            int address = complete.at(i) ? DynamixelBus::RamStartAddress : 0;
+            BulkReadRequest request = { ids.at(i), address, SharedDeviceState::TableSize - address };
+            requests << request;
+        }
+
+        QList<BulkReadReply> replies = DynamixelBus::bulkRead(requests);
+        qint64 timestamp = clock.msecsSinceReference() * 1000000LL + clock.nsecsElapsed();
+        for (int i = 0; i < replies.size(); i++){
+            const BulkReadReply &reply = replies.at(i);
+            if (reply.data.size() != requests.at(i).length) continue;
+            publish(i, reply.data, reply.address, timestamp);
+            complete[i] = true;
+        }
+
+        drainCommands();
+
+        nextSample += 1000000000LL / rate.load();
+        qint64 remaining = nextSample - clock.nsecsElapsed();
+        if (remaining > 0) usleep(remaining / 1000);
+        else nextSample = clock.nsecsElapsed();
+    }
+}
+
+
+// INTERNAL SUBROUTINES (private) ************************************************************************
+
+/**
+* Returns the mapped segment
+* @return Segment pointer, 0 if not attached
+*/
+SharedTelemetry::Segment *SharedTelemetry::segment(void) const{
+    if (!memory.isAttached()) return 0;
+    return static_cast<Segment*>(const_cast<QSharedMemory&>(memory).data());
+}
+
+
+/**
+* Finds the slot of a device
+* @param id Dynamixel ID
+* @return Slot index, -1 if the ID is not published
+*/
+int SharedTelemetry::slotIndex(int id) const{
+    Segment *s = segment();
+    if (s == 0) return -1;
+    for (int i = 0; i < s->deviceCount; i++){
+        if (s->states[i].id == id) return i;
+    }
+    return -1;
+}
+
+
+/**
+* Writes a register range into a slot under its seqlock
+* @param index Slot index
+* @param data Register values
+* @param address Address of the first value
+* @param timestamp Monotonic nanoseconds
+*/
+void SharedTelemetry::publish(int index, const QVector<int> &data, int address, qint64 timestamp){
+    Slot &slot = segment()->states[index];
+
+    slot.sequence.fetchAndAddOrdered(1);
+    for (int i = 0; i < data.size(); i++) slot.registers[address + i] = (quint8)data.at(i);
+    slot.timestamp = timestamp;
+    slot.published++;
+    slot.sequence.fetchAndAddRelease(1);
+}
+
+
+/**
+* Executes the queued commands, one SYNC_WRITE per (address, length)
+* @return Number of commands executed
+*/
+int SharedTelemetry::drainCommands(void){
+    Segment *s = segment();
+    QMap<QPair<int, int>, QMap<int, QVector<int> > > groups;
+    int count = 0;
+
+    int position = s->head.load();
+    while (count < CommandCapacity){
+        Cell &cell = s->cells[(quint32)position % CommandCapacity];
+        if (cell.sequence.loadAcquire() != position + 1) break;
+
+        const SharedCommand &command = cell.command;
+        QVector<int> &data = groups[qMakePair(command.address, command.length)][command.id];
+        data.resize(command.length);
+        for (int i = 0; i < command.length; i++) data[i] = command.data[i];
+
+        cell.sequence.storeRelease(position + CommandCapacity);
+        position++;
+        count++;
+    }
+    s->head.store(position);
+
+    QMap<QPair<int, int>, QMap<int, QVector<int> > >::const_iterator group;
+    for (group = groups.constBegin(); group != groups.constEnd(); ++group){
+        DynamixelBus::syncWrite(group.key().first, group.key().second, group.value());
+    }
+    return count;
+}
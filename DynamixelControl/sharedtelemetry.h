@@ -0,0 +1,102 @@
+#ifndef SHAREDTELEMETRY_H
+#define SHAREDTELEMETRY_H
+#include <QThread>
+#include <QSharedMemory>
+#include <QAtomicInt>
+#include <QList>
+#include <QVector>
+
+/**
+ * @brief The SharedDeviceState struct : Copy of one device's control table as last read by the bus owner.
+ * Registers are indexed by control table address; EEPROM (0-23) is read once, RAM (24-49) every tick.
+ */
+struct SharedDeviceState
+{
+    enum { TableSize = 50 };
+
+    int id;
+    qint64 timestamp;           // nanoseconds on the system monotonic clock (QElapsedTimer reference)
+    quint32 sequence;           // snapshots published so far
+    quint8 registers[TableSize];
+
+    int byte(int address) const { return registers[address]; }
+    int word(int address) const { return registers[address] | (registers[address + 1] << 8); }
+};
+
+
+/**
+ * @brief The SharedCommand struct : A write submitted by another process, up to MaxData bytes.
+ */
+struct SharedCommand
+{
+    enum { MaxData = 8 };
+
+    int id;
+    int address;
+    int length;
+    quint8 data[MaxData];
+};
+
+
+/**
+ * @brief The SharedTelemetry class : Telemetry and command bus in shared memory.
+ *
+ * The process owning the serial port calls create() and start(); its thread reads
+ * every registered device once per period and publishes the result into a seqlock
+ * slot, then drains the command ring and executes the commands as SYNC_WRITEs
+ * grouped by (address, length). Any other process calls attach() and then reads
+ * snapshots with snapshot() or submits writes with submit(), both straight out of
+ * the shared segment without a lock or a system call.
+ *
+ * Slots are seqlocks: the writer makes the sequence odd, writes, and makes it even
+ * again; a reader retries while the sequence is odd or changed under it. The
+ * command ring is a bounded multi-producer single-consumer queue with a sequence
+ * number per cell, so concurrent submitters never block each other.
+ */
+class SharedTelemetry : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    enum { MaxDevices = 32, CommandCapacity = 256 };
+
+    explicit SharedTelemetry(const QString &key, QObject *parent = 0);
+    ~SharedTelemetry();
+
+    bool create(const QList<int> &ids);
+    bool attach(void);
+    void detach(void);
+    QString errorString(void) const;
+
+    QList<int> devices(void) const;
+    bool snapshot(int id, SharedDeviceState &state) const;
+    int submit(const QList<SharedCommand> &commands);
+
+    int sampleRate(void) const;
+    void setSampleRate(int samplesPerSecond);
+    int droppedCommands(void) const;
+    void stop(void);
+
+protected:
+
+    void run();
+
+private:
+
+    struct Slot;
+    struct Cell;
+    struct Segment;
+
+    Segment *segment(void) const;
+    int slotIndex(int id) const;
+    void publish(int index, const QVector<int> &data, int address, qint64 timestamp);
+    int drainCommands(void);
+
+    QSharedMemory memory;
+    QAtomicInt rate;
+    bool owner;
+
+};
+
+#endif // SHAREDTELEMETRY_H
@@ -0,0 +1,169 @@
+#include "soundsampler.h"
+#include "sensorcontrol.h"
+#include "dynamixelbus.h"
+#include "dynamixel_control.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <qmath.h>
+
+const int DEFAULT_SAMPLE_RATE = 100;
+const int DEFAULT_WINDOW_SIZE = 20;
+const int SOUND_BLOCK_LENGTH = 5;  // sound data, max hold, detected count, detected time(l/h)
+const int SILENT_SOUND_LEVEL = 128;
+
+
+/**
+* Creates a sampler for an AX-S1 sensor. Call start() to begin sampling.
+* @param id Dynamixel sensor ID
+* @param parent Parent object
+*/
+SoundSampler::SoundSampler(int id, QObject *parent) :
+    QThread(parent),
+    id(id),
+    rate(DEFAULT_SAMPLE_RATE),
+    window(DEFAULT_WINDOW_SIZE)
+{
+    qRegisterMetaType<SoundStatistics>("SoundStatistics");
+}
+
+
+/**
+* Stops the sampling thread before destruction
+*/
+SoundSampler::~SoundSampler(){
+    stop();
+}
+
+
+/**
+* Returns the sensor ID being sampled
+* @return Dynamixel sensor ID
+*/
+int SoundSampler::sensorId(void) const{
+    return id;
+}
+
+
+/**
+* Returns the sample rate
+* @return Block reads per second
+*/
+int SoundSampler::sampleRate(void) const{
+    return rate.load();
+}
+
+
+/**
+* Sets the sample rate. Takes effect on the next sample.
+* The real rate is bounded by the bus: one block read takes roughly 1 ms at 1 Mbps.
+* @param samplesPerSecond Block reads per second, range: 1-1000
+*/
+void SoundSampler::setSampleRate(int samplesPerSecond){
+    if (samplesPerSecond < 1) samplesPerSecond = 1;
+    if (samplesPerSecond > 1000) samplesPerSecond = 1000;
+    rate.store(samplesPerSecond);
+}
+
+
+/**
+* Returns the window size
+* @return Samples per window
+*/
+int SoundSampler::windowSize(void) const{
+    return window.load();
+}
+
+
+/**
+* Sets the window size. Takes effect from the next window.
+* @param samples Samples per window, minimum 1
+*/
+void SoundSampler::setWindowSize(int samples){
+    if (samples < 1) samples = 1;
+    window.store(samples);
+}
+
+
+/**
+* Stops sampling and waits for the thread to finish
+*/
+void SoundSampler::stop(void){
+    requestInterruption();
+    wait();
+}
+
+
+/**
+* Sampling loop. Runs until stop() is called.
+*/
+void SoundSampler::run(){
+    const int soundDataAddress = SensorControl::controlTableAddress("sound data");
+    const int maxHoldAddress = SensorControl::controlTableAddress("sound data max hold");
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 nextSample = 0;
+
+    // Start from a clean max hold/count so the first window is not polluted by old detections
+    resetWindow(id, maxHoldAddress);
+
+    SoundStatistics statistics;
+    int samplesInWindow = 0;
+    double sumOfSquares = 0;
+    QVector<int> block;
+
+    while (!isInterruptionRequested()){
+        if (samplesInWindow == 0){
+            statistics.id = id;
+            statistics.samples = 0;
+            statistics.failedReads = 0;
+            statistics.peak = 0;
+            statistics.eventCount = 0;
+            statistics.lastDetectedTime = 0;
+            sumOfSquares = 0;
+        }
+        bool closesWindow = ++samplesInWindow >= window.load();
+
+        int result;
+        {
+            DynamixelBus::Lock lock(BusArbiter::Telemetry);
+            result = DynamixelBus::readBlock(id, soundDataAddress, SOUND_BLOCK_LENGTH, block);
+            if (closesWindow) resetWindow(id, maxHoldAddress);
+        }
+
+        if (result == COMM_RXSUCCESS){
+            int level = block.at(0) - SILENT_SOUND_LEVEL;
+            sumOfSquares += level * level;
+            if (block.at(1) > statistics.peak) statistics.peak = block.at(1);
+            statistics.eventCount = block.at(2);
+            statistics.lastDetectedTime = block.at(3) | (block.at(4) << 8);
+            statistics.samples++;
+        }
+        else statistics.failedReads++;
+
+        if (closesWindow){
+            statistics.timestamp = clock.elapsed();
+            statistics.rms = statistics.samples > 0 ? qSqrt(sumOfSquares / statistics.samples) : 0;
+            emit windowReady(statistics);
+            samplesInWindow = 0;
+        }
+
+        // Fixed-rate schedule; after an overrun, resynchronise instead of bursting to catch up
+        nextSample += 1000000000LL / rate.load();
+        qint64 remaining = nextSample - clock.nsecsElapsed();
+        if (remaining > 0) usleep(remaining / 1000);
+        else nextSample = clock.nsecsElapsed();
+    }
+}
+
+
+/**
+* Clears Sound Data Max Hold and Sound Detected Count (adjacent addresses) with one WRITE
+* @param id Dynamixel sensor ID
+* @param maxHoldAddress Address of Sound Data Max Hold
+* @return Communication result
+*/
+int SoundSampler::resetWindow(int id, int maxHoldAddress){
+    QVector<int> zeros(2, 0);
+    return DynamixelBus::writeBlock(id, maxHoldAddress, zeros);
+}
@@ -0,0 +1,66 @@
+#ifndef SOUNDSAMPLER_H
+#define SOUNDSAMPLER_H
+#include <QThread>
+#include <QAtomicInt>
+#include <QMetaType>
+
+/**
+ * @brief The SoundStatistics struct : Summary of one sampling window on an AX-S1
+ */
+struct SoundStatistics
+{
+    int id;                 // Dynamixel sensor ID
+    qint64 timestamp;       // Window close time, ms since the sampler was started
+    int samples;            // Successful block reads in the window
+    int failedReads;        // Block reads that did not return a status packet
+    double rms;             // RMS of the sound level around the silent level (128)
+    int peak;               // Highest Sound Data Max Hold seen in the window, 0-255
+    int eventCount;         // Sound Detected Count at window close
+    int lastDetectedTime;   // Sound Detected Time at window close
+};
+
+Q_DECLARE_METATYPE(SoundStatistics)
+
+
+/**
+ * @brief The SoundSampler class : Background sampler for the AX-S1 sound sensor.
+ * Reads Sound Data through Sound Detected Time (addresses 35-39) as one block at a
+ * fixed rate and emits windowReady() once per window. Max hold and detected count
+ * are reset while still holding the bus after the window's last read, so no detection falls
+ * between two windows.
+ */
+class SoundSampler : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    explicit SoundSampler(int id, QObject *parent = 0);
+    ~SoundSampler();
+
+    int sensorId(void) const;
+    int sampleRate(void) const;
+    void setSampleRate(int samplesPerSecond);
+    int windowSize(void) const;
+    void setWindowSize(int samples);
+    void stop(void);
+
+signals:
+
+    void windowReady(const SoundStatistics &statistics);
+
+protected:
+
+    void run();
+
+private:
+
+    static int resetWindow(int id, int maxHoldAddress);
+
+    int id;
+    QAtomicInt rate;
+    QAtomicInt window;
+
+};
+
+#endif // SOUNDSAMPLER_H
@@ -0,0 +1,209 @@
+#include "statepoller.h"
+#include "actuatorcontrol.h"
+#include "sensorcontrol.h"
+#include "dynamixelbus.h"
+#include "dynamixel_control.h"
+#include <QVector>
+
+const int DEFAULT_POLL_INTERVAL = 20;
+
+
+// SUBSCRIPTION: ******************************************************************
+
+StateSubscription::StateSubscription(int id, Condition condition, int threshold, int address, QObject *parent) :
+    QObject(parent),
+    dxlId(id),
+    watchedCondition(condition),
+    conditionThreshold(threshold),
+    address(address),
+    refCount(1),
+    hasBaseline(false),
+    active(false)
+{
+}
+
+
+/**
+* Returns the watched Dynamixel ID
+* @return Dynamixel ID
+*/
+int StateSubscription::id(void) const{
+    return dxlId;
+}
+
+
+/**
+* Returns the watched condition
+* @return Condition
+*/
+StateSubscription::Condition StateSubscription::condition(void) const{
+    return watchedCondition;
+}
+
+
+/**
+* Returns the threshold (only used by TemperatureAbove)
+* @return Threshold
+*/
+int StateSubscription::threshold(void) const{
+    return conditionThreshold;
+}
+
+
+/**
+* Returns whether the condition held at the last poll
+* @return true/false
+*/
+bool StateSubscription::isActive(void) const{
+    return active;
+}
+
+
+/**
+* Evaluates the condition against a freshly read register value and emits on edges.
+* The first value only sets the baseline.
+* @param value Register value
+*/
+void StateSubscription::evaluate(int value){
+    bool now;
+    switch (watchedCondition){
+    case MotionFinished: now = (value == 0); break;
+    case TemperatureAbove: now = (value > conditionThreshold); break;
+    default: now = (value != 0); break;
+    }
+
+    if (!hasBaseline){
+        hasBaseline = true;
+        active = now;
+        return;
+    }
+    if (now == active) return;
+
+    active = now;
+    if (now) emit triggered(dxlId, value);
+    else emit cleared(dxlId, value);
+}
+
+
+
+// POLLER: ******************************************************************
+
+/**
+* Creates a poller. Polling starts with the first subscription.
+* @param parent Parent object
+*/
+StatePoller::StatePoller(QObject *parent) :
+    QObject(parent),
+    timer(this)
+{
+    timer.setInterval(DEFAULT_POLL_INTERVAL);
+    connect(&timer, SIGNAL(timeout()), this, SLOT(poll()));
+}
+
+
+/**
+* Subscribes to a condition. Identical subscriptions share one object.
+* @param id Dynamixel ID
+* @param condition Condition to watch
+* @param threshold Threshold for TemperatureAbove (degrees Celsius), ignored otherwise
+* @return Subscription to connect to; release with unsubscribe()
+*/
+StateSubscription *StatePoller::subscribe(int id, StateSubscription::Condition condition, int threshold){
+    if (condition != StateSubscription::TemperatureAbove) threshold = 0;
+
+    QList<StateSubscription *> &subscriptions = subscriptionsById[id];
+    foreach (StateSubscription *subscription, subscriptions){
+        if (subscription->condition() == condition && subscription->threshold() == threshold){
+            subscription->refCount++;
+            return subscription;
+        }
+    }
+
+    StateSubscription *subscription = new StateSubscription(id, condition, threshold, addressOf(condition), this);
+    subscriptions.append(subscription);
+    if (!timer.isActive()) timer.start();
+    return subscription;
+}
+
+
+/**
+* Releases a subscription obtained from subscribe().
+* The shared object is deleted when its last subscriber leaves.
+* @param subscription Subscription to release
+*/
+void StatePoller::unsubscribe(StateSubscription *subscription){
+    if (subscription == 0 || --subscription->refCount > 0) return;
+
+    QList<StateSubscription *> &subscriptions = subscriptionsById[subscription->id()];
+    subscriptions.removeOne(subscription);
+    if (subscriptions.isEmpty()) subscriptionsById.remove(subscription->id());
+    subscription->deleteLater();
+
+    if (subscriptionsById.isEmpty()) timer.stop();
+}
+
+
+/**
+* Returns the poll interval
+* @return Interval in ms
+*/
+int StatePoller::interval(void) const{
+    return timer.interval();
+}
+
+
+/**
+* Sets the poll interval
+* @param msec Interval in ms
+*/
+void StatePoller::setInterval(int msec){
+    timer.setInterval(msec);
+}
+
+
+/**
+* Reads every subscribed ID once and evaluates its subscriptions
+*/
+void StatePoller::poll(void){
+    // Slots connected to the signals may (un)subscribe; iterate over a copy
+    const QMap<int, QList<StateSubscription *> > snapshot = subscriptionsById;
+
+    QVector<int> block;
+    QMap<int, QList<StateSubscription *> >::const_iterator it;
+    for (it = snapshot.constBegin(); it != snapshot.constEnd(); ++it){
+        const QList<StateSubscription *> &subscriptions = it.value();
+
+        int first = subscriptions.first()->address;
+        int last = first;
+        foreach (StateSubscription *subscription, subscriptions){
+            first = qMin(first, subscription->address);
+            last = qMax(last, subscription->address);
+        }
+
+        int result = DynamixelBus::readBlock(it.key(), first, last - first + 1, block);
+        if (result != COMM_RXSUCCESS){
+            emit readFailed(it.key(), result);
+            continue;
+        }
+
+        foreach (StateSubscription *subscription, subscriptions){
+            subscription->evaluate(block.at(subscription->address - first));
+        }
+    }
+}
+
+
+/**
+* Returns the control table address a condition is evaluated on
+* @param condition Condition
+* @return Memory address
+*/
+int StatePoller::addressOf(StateSubscription::Condition condition){
+    switch (condition){
+    case StateSubscription::MotionFinished: return ActuatorControl::controlTableAddress("moving");
+    case StateSubscription::TemperatureAbove: return ActuatorControl::controlTableAddress("present temperature");
+    case StateSubscription::ObstacleDetected: return SensorControl::controlTableAddress("ir obstacle detected");
+    case StateSubscription::LightDetected: return SensorControl::controlTableAddress("light detected");
+    default: return SensorControl::controlTableAddress("ir remocon arrived");
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef STATEPOLLER_H
+#define STATEPOLLER_H
+#include <QObject>
+#include <QTimer>
+#include <QMap>
+#include <QList>
+
+
+/**
+ * @brief The StateSubscription class : Edge notifications for one watched condition.
+ * Obtained from StatePoller::subscribe(); shared by every client that subscribed to
+ * the same (ID, condition, threshold), so connect to the signals rather than owning it.
+ */
+class StateSubscription : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    enum Condition {
+        MotionFinished,     // actuator: Moving went from 1 to 0
+        TemperatureAbove,   // actuator: Present Temperature > threshold
+        ObstacleDetected,   // AX-S1: IR Obstacle Detected != 0
+        LightDetected,      // AX-S1: Light Detected != 0
+        RemoconArrived      // AX-S1: IR Remocon Arrived != 0
+    };
+
+    int id(void) const;
+    Condition condition(void) const;
+    int threshold(void) const;
+    bool isActive(void) const;
+
+signals:
+
+    void triggered(int id, int value);  // condition became true
+    void cleared(int id, int value);    // condition became false
+
+private:
+
+    friend class StatePoller;
+
+    StateSubscription(int id, Condition condition, int threshold, int address, QObject *parent);
+    void evaluate(int value);
+
+    int dxlId;
+    Condition watchedCondition;
+    int conditionThreshold;
+    int address;
+    int refCount;
+    bool hasBaseline;
+    bool active;
+
+};
+
+
+/**
+ * @brief The StatePoller class : Shared poller behind StateSubscription.
+ * Each tick, every ID with at least one subscription is read with a single block READ
+ * covering all of its watched addresses; each subscription is then evaluated against
+ * that block and emits only on edges. N subscribers to one condition cost one read.
+ */
+class StatePoller : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit StatePoller(QObject *parent = 0);
+
+    StateSubscription *subscribe(int id, StateSubscription::Condition condition, int threshold = 0);
+    void unsubscribe(StateSubscription *subscription);
+    int interval(void) const;
+    void setInterval(int msec);
+
+signals:
+
+    void readFailed(int id, int result);
+
+public slots:
+
+    void poll(void);
+
+private:
+
+    static int addressOf(StateSubscription::Condition condition);
+
+    QTimer timer;
+    QMap<int, QList<StateSubscription *> > subscriptionsById;
+
+};
+
+#endif // STATEPOLLER_H
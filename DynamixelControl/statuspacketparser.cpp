@@ -0,0 +1,179 @@
+#include "statuspacketparser.h"
+
+const int HEADER_BYTE = 0xFF;
+const int DEFAULT_MAX_PARAMETERS = 143;         // longest READ reply the protocol allows
+
+
+StatusPacketParser::StatusPacketParser() :
+    maxParameters(DEFAULT_MAX_PARAMETERS),
+    packets(0),
+    corrupt(0),
+    discarded(0)
+{
+}
+
+
+/**
+* Consumes received bytes and decodes every packet they complete
+* @param data Received bytes
+* @param size Number of bytes
+* @return Number of decoded packets waiting to be taken
+*/
+int StatusPacketParser::feed(const char *data, int size){
+    buffer.append(data, size);
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(buffer.constData());
+    int available = buffer.size();
+    int position = 0;
+
+    forever {
+        int start = position;
+        while (position + 1 < available && !(bytes[position] == HEADER_BYTE && bytes[position + 1] == HEADER_BYTE)) position++;
+        discarded += position - start;
+        if (position + 4 > available) break;    // no header, or header without id and length yet
+
+        int id = bytes[position + 2];
+        int length = bytes[position + 3];
+        if (id == HEADER_BYTE){
+            // padding before the real header, e.g. FF FF FF id
+            position++;
+            discarded++;
+            continue;
+        }
+        if (length < 2 || length - 2 > maxParameters){
+            position++;
+            discarded++;
+            corrupt++;
+            continue;
+        }
+        if (position + length + 4 > available) break;
+
+        int checksum = id + length;
+        for (int i = 0; i < length - 1; i++) checksum += bytes[position + 4 + i];
+        if ((~checksum & 0xFF) != bytes[position + length + 3]){
+            position++;
+            discarded++;
+            corrupt++;
+            continue;
+        }
+
+        StatusPacket packet;
+        packet.id = id;
+        packet.error = bytes[position + 4];
+        packet.parameters.resize(length - 2);
+        for (int i = 0; i < length - 2; i++) packet.parameters[i] = bytes[position + 5 + i];
+        ready << packet;
+        packets++;
+        position += length + 4;
+    }
+
+    // keep a trailing single 0xFF, it may be the first half of the next header
+    if (position + 1 == available && bytes[position] != HEADER_BYTE){
+        position++;
+        discarded++;
+    }
+    buffer.remove(0, position);
+    return ready.size();
+}
+
+
+/**
+* Consumes received bytes and decodes every packet they complete
+* @param data Received bytes
+* @return Number of decoded packets waiting to be taken
+*/
+int StatusPacketParser::feed(const QByteArray &data){
+    return feed(data.constData(), data.size());
+}
+
+
+/**
+* Returns whether a decoded packet is waiting
+* @return true/false
+*/
+bool StatusPacketParser::hasPacket(void) const{
+    return !ready.isEmpty();
+}
+
+
+/**
+* Removes and returns the oldest decoded packet (hasPacket() must be true)
+* @return Status packet
+*/
+StatusPacket StatusPacketParser::takePacket(void){
+    return ready.takeFirst();
+}
+
+
+/**
+* Removes and returns every decoded packet
+* @return Status packets in stream order
+*/
+QList<StatusPacket> StatusPacketParser::takePackets(void){
+    QList<StatusPacket> packets = ready;
+    ready.clear();
+    return packets;
+}
+
+
+/**
+* Returns the number of buffered bytes of an incomplete packet
+* @return Number of bytes
+*/
+int StatusPacketParser::pendingBytes(void) const{
+    return buffer.size();
+}
+
+
+/**
+* Drops buffered bytes and undelivered packets, e.g. before a new transaction
+*/
+void StatusPacketParser::reset(void){
+    discarded += buffer.size();
+    buffer.clear();
+    ready.clear();
+}
+
+
+/**
+* Returns the largest parameter count accepted before a length byte is treated as corrupt
+* @return Number of parameters
+*/
+int StatusPacketParser::maximumParameters(void) const{
+    return maxParameters;
+}
+
+
+/**
+* Sets the largest parameter count accepted; a tighter bound resyncs faster after a corrupt length byte
+* @param count Number of parameters, range: 0-253
+*/
+void StatusPacketParser::setMaximumParameters(int count){
+    maxParameters = qBound(0, count, 253);
+}
+
+
+/**
+* Returns the number of packets decoded since construction
+* @return Number of packets
+*/
+qint64 StatusPacketParser::packetCount(void) const{
+    return packets;
+}
+
+
+/**
+* Returns the number of candidate packets rejected for a bad checksum or length
+* @return Number of packets
+*/
+qint64 StatusPacketParser::corruptCount(void) const{
+    return corrupt;
+}
+
+
+/**
+* Returns the number of bytes skipped while resynchronising
+* @return Number of bytes
+*/
+qint64 StatusPacketParser::discardedBytes(void) const{
+    return discarded;
+}
@@ -0,0 +1,59 @@
+#ifndef STATUSPACKETPARSER_H
+#define STATUSPACKETPARSER_H
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+/**
+ * @brief The StatusPacket struct : One decoded status packet
+ */
+struct StatusPacket
+{
+    int id;
+    int error;                  // Error bits (ERRBIT_*)
+    QVector<int> parameters;
+};
+
+
+/**
+ * @brief The StatusPacketParser class : Incremental Protocol 1.0 status packet decoder.
+ *
+ * Bytes are fed in whatever chunks the port delivers; every complete packet in
+ * the stream is decoded, so one read can yield the replies of several devices.
+ * Bytes that cannot start a packet are skipped until the next 0xFF 0xFF header,
+ * and a packet with a bad checksum or an impossible length is dropped one byte at
+ * a time, so a valid packet hidden behind garbage or a truncated packet is still
+ * found. Incomplete packets stay buffered until the next feed().
+ */
+class StatusPacketParser
+{
+public:
+
+    StatusPacketParser();
+
+    int feed(const char *data, int size);
+    int feed(const QByteArray &data);
+    bool hasPacket(void) const;
+    StatusPacket takePacket(void);
+    QList<StatusPacket> takePackets(void);
+    int pendingBytes(void) const;
+    void reset(void);
+
+    int maximumParameters(void) const;
+    void setMaximumParameters(int count);
+    qint64 packetCount(void) const;
+    qint64 corruptCount(void) const;
+    qint64 discardedBytes(void) const;
+
+private:
+
+    QByteArray buffer;
+    QList<StatusPacket> ready;
+    int maxParameters;
+    qint64 packets;
+    qint64 corrupt;
+    qint64 discarded;
+
+};
+
+#endif // STATUSPACKETPARSER_H
@@ -0,0 +1,268 @@
+#include "telemetrycodec.h"
+#include <QIODevice>
+
+const int MAX_VARINT32_BYTES = 5;
+const int MAX_VARINT64_BYTES = 10;
+const int MAX_BLOCK_SIZE = 64 * 1024 * 1024;    // sanity bound for readBlock()
+const int MAX_BLOCK_VALUES = 16 * 1024 * 1024;  // frames * channels per block, bounds what decode() allocates
+
+
+// VARINT HELPERS *************************************************************
+
+static inline quint32 zigZag32(qint32 value){
+    return ((quint32)value << 1) ^ (quint32)(value >> 31);
+}
+
+
+static inline qint32 unZigZag32(quint32 value){
+    return (qint32)(value >> 1) ^ -(qint32)(value & 1);
+}
+
+
+static inline quint64 zigZag64(qint64 value){
+    return ((quint64)value << 1) ^ (quint64)(value >> 63);
+}
+
+
+static inline qint64 unZigZag64(quint64 value){
+    return (qint64)(value >> 1) ^ -(qint64)(value & 1);
+}
+
+
+static inline uchar *putVarint(uchar *out, quint64 value){
+    while (value >= 0x80){
+        *out++ = (uchar)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uchar)value;
+    return out;
+}
+
+
+/**
+* Reads one varint; returns 0 on truncated or overlong input
+*/
+static inline const uchar *getVarint(const uchar *in, const uchar *end, quint64 &value){
+    // fast path: single byte, by far the most common case in telemetry
+    if (in < end && *in < 0x80){
+        value = *in;
+        return in + 1;
+    }
+    value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7){
+        uchar byte = *in++;
+        value |= (quint64)(byte & 0x7F) << shift;
+        if (byte < 0x80) return in;
+    }
+    return 0;
+}
+
+
+// CODEC: *********************************************************************
+
+/**
+* Encodes a block of frames
+* @param timestamps One timestamp per frame, e.g. nanoseconds
+* @param values Raw register values, frame-major: values[frame * channels + channel]
+* @param channels Values per frame
+* @return Encoded block, empty if the sizes do not match or exceed 16M values
+*/
+QByteArray TelemetryCodec::encode(const QVector<qint64> &timestamps, const QVector<int> &values, int channels){
+    int frames = timestamps.size();
+    if (channels < 1 || values.size() != frames * channels || values.size() > MAX_BLOCK_VALUES) return QByteArray();
+
+    // worst case: every number takes its longest varint
+    QByteArray block;
+    block.resize(2 * MAX_VARINT32_BYTES + frames * MAX_VARINT64_BYTES + values.size() * MAX_VARINT32_BYTES);
+    uchar *out = reinterpret_cast<uchar*>(block.data());
+    uchar *begin = out;
+
+    out = putVarint(out, frames);
+    out = putVarint(out, channels);
+
+    const qint64 *time = timestamps.constData();
+    qint64 previousTime = 0, previousDelta = 0;
+    for (int f = 0; f < frames; f++){
+        qint64 delta = time[f] - previousTime;
+        out = putVarint(out, zigZag64(delta - previousDelta));
+        previousTime = time[f];
+        previousDelta = delta;
+    }
+
+    const int *value = values.constData();
+    for (int c = 0; c < channels; c++){
+        qint32 previous = 0;
+        int f = 0;
+        while (f < frames){
+            int run = 0;
+            while (f + run < frames && value[(f + run) * channels + c] == previous) run++;
+            if (run > 1){
+                // run of unchanged values: 0, then the run length minus two
+                *out++ = 0;
+                out = putVarint(out, run - 2);
+                f += run;
+                continue;
+            }
+            qint32 current = value[f * channels + c];
+            out = putVarint(out, (quint64)zigZag32((qint32)((quint32)current - (quint32)previous)) + 1);
+            previous = current;
+            f++;
+        }
+    }
+
+    block.resize(out - begin);
+    return block;
+}
+
+
+/**
+* Decodes a block produced by encode()
+* @param block Encoded block
+* @param timestamps Receives one timestamp per frame
+* @param values Receives the values, frame-major
+* @param channels Receives the values per frame
+* @return true on success, false if the block is truncated or malformed
+*/
+bool TelemetryCodec::decode(const QByteArray &block, QVector<qint64> &timestamps, QVector<int> &values, int &channels){
+    const uchar *in = reinterpret_cast<const uchar*>(block.constData());
+    const uchar *end = in + block.size();
+    quint64 frameCount, channelCount;
+    if ((in = getVarint(in, end, frameCount)) == 0) return false;
+    if ((in = getVarint(in, end, channelCount)) == 0) return false;
+    // each frame costs at least one timestamp byte and each channel at least one value byte
+    if (frameCount > (quint64)block.size() || channelCount < 1 || channelCount > (quint64)block.size()) return false;
+    if (frameCount * channelCount > (quint64)MAX_BLOCK_VALUES) return false;
+
+    int frames = (int)frameCount;
+    channels = (int)channelCount;
+    timestamps.resize(frames);
+    values.resize(frames * channels);
+
+    qint64 *time = timestamps.data();
+    qint64 previousTime = 0, previousDelta = 0;
+    for (int f = 0; f < frames; f++){
+        quint64 raw;
+        if ((in = getVarint(in, end, raw)) == 0) return false;
+        previousDelta += unZigZag64(raw);
+        previousTime += previousDelta;
+        time[f] = previousTime;
+    }
+
+    int *value = values.data();
+    for (int c = 0; c < channels; c++){
+        qint32 previous = 0;
+        int f = 0;
+        while (f < frames){
+            quint64 raw;
+            if ((in = getVarint(in, end, raw)) == 0 || raw > 0x100000000ULL) return false;
+            if (raw != 0){
+                previous = (qint32)((quint32)previous + (quint32)unZigZag32((quint32)(raw - 1)));
+                value[f * channels + c] = previous;
+                f++;
+                continue;
+            }
+            quint64 run;
+            if ((in = getVarint(in, end, run)) == 0 || frames - f < 2 || run > (quint64)(frames - f - 2)) return false;
+            for (int i = 0; i < (int)run + 2; i++) value[(f + i) * channels + c] = previous;
+            f += (int)run + 2;
+        }
+    }
+    return in == end;
+}
+
+
+// LOG: ***********************************************************************
+
+/**
+* @param device Open, writable device, e.g. a QFile
+* @param channels Values per frame
+* @param framesPerBlock Frames buffered before a block is written, at most 16M values per block
+*/
+TelemetryLog::TelemetryLog(QIODevice *device, int channels, int framesPerBlock) :
+    device(device),
+    channels(channels),
+    framesPerBlock(qBound(1, framesPerBlock, MAX_BLOCK_VALUES / qMax(1, channels))),
+    raw(0),
+    encoded(0)
+{
+    timestamps.reserve(this->framesPerBlock);
+    values.reserve(this->framesPerBlock * channels);
+}
+
+
+/**
+* Writes the frames still buffered
+*/
+TelemetryLog::~TelemetryLog(){
+    flush();
+}
+
+
+/**
+* Buffers one frame; writes a block once framesPerBlock frames are buffered
+* @param timestamp Frame timestamp
+* @param values One raw register value per channel
+*/
+void TelemetryLog::append(qint64 timestamp, const int *values){
+    timestamps << timestamp;
+    for (int c = 0; c < channels; c++) this->values << values[c];
+    if (timestamps.size() >= framesPerBlock) flush();
+}
+
+
+/**
+* Encodes the buffered frames and writes them as one block: a 4-byte little-endian size, then the block
+* @return true on success (or nothing to write)
+*/
+bool TelemetryLog::flush(void){
+    if (timestamps.isEmpty()) return true;
+    QByteArray block = TelemetryCodec::encode(timestamps, values, channels);
+    raw += timestamps.size() * (qint64)sizeof(qint64) + values.size() * (qint64)sizeof(int);
+    timestamps.clear();
+    values.clear();
+
+    char size[4];
+    for (int i = 0; i < 4; i++) size[i] = (char)((block.size() >> (8 * i)) & 0xFF);
+    bool ok = device->write(size, 4) == 4 && device->write(block) == block.size();
+    encoded += 4 + block.size();
+    return ok;
+}
+
+
+/**
+* Returns the size of the frames logged so far as plain arrays
+* @return Bytes
+*/
+qint64 TelemetryLog::rawBytes(void) const{
+    return raw;
+}
+
+
+/**
+* Returns the bytes written so far
+* @return Bytes
+*/
+qint64 TelemetryLog::encodedBytes(void) const{
+    return encoded;
+}
+
+
+/**
+* Reads and decodes the next block of a log
+* @param device Open, readable device positioned at a block boundary
+* @param timestamps Receives one timestamp per frame
+* @param values Receives the values, frame-major
+* @param channels Receives the values per frame
+* @return true on success, false at the end of the log or on a damaged block
+*/
+bool TelemetryLog::readBlock(QIODevice *device, QVector<qint64> &timestamps, QVector<int> &values, int &channels){
+    char sizeBytes[4];
+    if (device->read(sizeBytes, 4) != 4) return false;
+    int size = 0;
+    for (int i = 0; i < 4; i++) size |= (uchar)sizeBytes[i] << (8 * i);
+    if (size < 0 || size > MAX_BLOCK_SIZE) return false;
+
+    QByteArray block = device->read(size);
+    if (block.size() != size) return false;
+    return TelemetryCodec::decode(block, timestamps, values, channels);
+}
@@ -0,0 +1,61 @@
+#ifndef TELEMETRYCODEC_H
+#define TELEMETRYCODEC_H
+#include <QByteArray>
+#include <QVector>
+
+class QIODevice;
+
+/**
+ * @brief The TelemetryCodec class : Compact encoding of recorded telemetry frames.
+ *
+ * A frame is one timestamp plus one raw register value per channel; a block holds
+ * a sequence of frames with the same channel count. Timestamps are stored as
+ * delta-of-delta (a fixed sample rate encodes to one zero byte per frame), values
+ * column by column as zig-zag varint deltas plus one, and a run of two or more
+ * unchanged values as a zero followed by the run length minus two (a single
+ * repeat is just the delta 0, one byte). A slowly changing temperature channel thus
+ * costs a few bytes per block, and a moving position about one byte per sample.
+ *
+ * Block layout: varint frameCount, varint channelCount, timestamps, then each channel.
+ * Encoding and decoding work on raw byte pointers with one allocation per block.
+ */
+class TelemetryCodec
+{
+public:
+
+    static QByteArray encode(const QVector<qint64> &timestamps, const QVector<int> &values, int channels);
+    static bool decode(const QByteArray &block, QVector<qint64> &timestamps, QVector<int> &values, int &channels);
+
+};
+
+
+/**
+ * @brief The TelemetryLog class : Appends frames to a device as length-prefixed compressed blocks.
+ */
+class TelemetryLog
+{
+public:
+
+    TelemetryLog(QIODevice *device, int channels, int framesPerBlock = 1000);
+    ~TelemetryLog();
+
+    void append(qint64 timestamp, const int *values);
+    bool flush(void);
+    qint64 rawBytes(void) const;
+    qint64 encodedBytes(void) const;
+
+    static bool readBlock(QIODevice *device, QVector<qint64> &timestamps, QVector<int> &values, int &channels);
+
+private:
+
+    QIODevice *device;
+    int channels;
+    int framesPerBlock;
+    QVector<qint64> timestamps;
+    QVector<int> values;
+    qint64 raw;
+    qint64 encoded;
+
+};
+
+#endif // TELEMETRYCODEC_H
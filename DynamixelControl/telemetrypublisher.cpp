@@ -0,0 +1,200 @@
+#include "telemetrypublisher.h"
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QTimer>
+
+
+TelemetryPublisher::TelemetryPublisher(int intervalMsec, QObject *parent) :
+    QObject(parent),
+    flushPending(false),
+    unchangedPublished(false),
+    ackRequired(false),
+    unacknowledged(false),
+    received(0),
+    emitted(0),
+    flushTimer(new QTimer(this)),
+    intervalMsec(qMax(1, intervalMsec))
+{
+    qRegisterMetaType<TelemetryDelta>("TelemetryDelta");
+    flushTimer->setSingleShot(true);
+    connect(flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+    sinceFlush.start();
+}
+
+
+/**
+* Records a value; thread-safe and cheap enough to call for every sample
+* @param id Dynamixel ID
+* @param address Register address
+* @param value Register value
+*/
+void TelemetryPublisher::update(int id, int address, int value){
+    int k = key(id, address);
+    QMutexLocker locker(&mutex);
+    received++;
+
+    if (!unchangedPublished && latest.contains(k) && latest.value(k) == value) return;
+    latest.insert(k, value);
+
+    if (!dirtyKeys.contains(k)){
+        dirtyKeys.insert(k);
+        dirty << k;
+    }
+    if (!flushPending){
+        flushPending = true;
+        QMetaObject::invokeMethod(this, "scheduleFlush", Qt::QueuedConnection);
+    }
+}
+
+
+/**
+* Returns the newest value of a register, published or not
+* @param id Dynamixel ID
+* @param address Register address
+* @return Value, -1 if never updated
+*/
+int TelemetryPublisher::value(int id, int address) const{
+    QMutexLocker locker(&mutex);
+    return latest.value(key(id, address), -1);
+}
+
+
+/**
+* Returns the minimum time between two deltas
+* @return Milliseconds
+*/
+int TelemetryPublisher::interval(void) const{
+    return intervalMsec;
+}
+
+
+/**
+* Sets the minimum time between two deltas (call from the publisher's thread)
+* @param msec Milliseconds, at least 1
+*/
+void TelemetryPublisher::setInterval(int msec){
+    intervalMsec = qMax(1, msec);
+}
+
+
+/**
+* Returns whether updates that repeat the previous value are published
+* @return true/false
+*/
+bool TelemetryPublisher::publishUnchanged(void) const{
+    QMutexLocker locker(&mutex);
+    return unchangedPublished;
+}
+
+
+/**
+* Sets whether updates that repeat the previous value are published, e.g. as a liveness sign
+* @param enabled true/false
+*/
+void TelemetryPublisher::setPublishUnchanged(bool enabled){
+    QMutexLocker locker(&mutex);
+    unchangedPublished = enabled;
+}
+
+
+/**
+* Returns whether each delta has to be acknowledged before the next one is emitted
+* @return true/false
+*/
+bool TelemetryPublisher::acknowledgeRequired(void) const{
+    QMutexLocker locker(&mutex);
+    return ackRequired;
+}
+
+
+/**
+* Sets whether each delta has to be acknowledged before the next one is emitted;
+* use it when the consumer may fall behind the interval
+* @param enabled true/false
+*/
+void TelemetryPublisher::setAcknowledgeRequired(bool enabled){
+    {
+        QMutexLocker locker(&mutex);
+        ackRequired = enabled;
+    }
+    if (!enabled) acknowledge();
+}
+
+
+/**
+* Tells the publisher the consumer has handled the last delta; thread-safe, call it
+* at the end of the slot connected to updated()
+*/
+void TelemetryPublisher::acknowledge(void){
+    QMutexLocker locker(&mutex);
+    unacknowledged = false;
+    if (flushPending) QMetaObject::invokeMethod(this, "scheduleFlush", Qt::QueuedConnection);
+}
+
+
+/**
+* Returns the number of update() calls since construction
+* @return Number of updates
+*/
+qint64 TelemetryPublisher::updateCount(void) const{
+    QMutexLocker locker(&mutex);
+    return received;
+}
+
+
+/**
+* Returns the number of deltas emitted since construction
+* @return Number of signals
+*/
+qint64 TelemetryPublisher::signalCount(void) const{
+    QMutexLocker locker(&mutex);
+    return emitted;
+}
+
+
+// SLOTS (private) ***************************************************************************************
+
+/**
+* Arms the flush timer so that deltas stay at least one interval apart
+*/
+void TelemetryPublisher::scheduleFlush(void){
+    qint64 wait = intervalMsec - sinceFlush.elapsed();
+    flushTimer->start(wait > 0 ? (int)wait : 0);
+}
+
+
+/**
+* Emits everything that changed since the last delta, unless the last one is still unacknowledged
+*/
+void TelemetryPublisher::flush(void){
+    TelemetryDelta delta;
+    {
+        QMutexLocker locker(&mutex);
+        if (unacknowledged && !dirty.isEmpty()) return;     // stays pending, acknowledge() reschedules
+        flushPending = false;
+        if (dirty.isEmpty()) return;
+
+        delta.ids.resize(dirty.size());
+        delta.addresses.resize(dirty.size());
+        delta.values.resize(dirty.size());
+        for (int i = 0; i < dirty.size(); i++){
+            delta.ids[i] = dirty.at(i) >> 8;
+            delta.addresses[i] = dirty.at(i) & 0xFF;
+            delta.values[i] = latest.value(dirty.at(i));
+        }
+        dirty.clear();
+        dirtyKeys.clear();
+        emitted++;
+        unacknowledged = ackRequired;
+    }
+    sinceFlush.restart();
+    delta.timestamp = sinceFlush.msecsSinceReference();
+    emit updated(delta);
+}
+
+
+// INTERNAL SUBROUTINES (private) ************************************************************************
+
+int TelemetryPublisher::key(int id, int address){
+    return (id << 8) | (address & 0xFF);
+}
@@ -0,0 +1,94 @@
+#ifndef TELEMETRYPUBLISHER_H
+#define TELEMETRYPUBLISHER_H
+#include <QObject>
+#include <QMetaType>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QVector>
+
+class QTimer;
+
+/**
+ * @brief The TelemetryDelta struct : Register values that changed since the previous delta.
+ * Entry i is the newest value of register addresses[i] of device ids[i].
+ */
+struct TelemetryDelta
+{
+    qint64 timestamp;           // milliseconds, QElapsedTimer::msecsSinceReference() clock
+    QVector<int> ids;
+    QVector<int> addresses;
+    QVector<int> values;
+
+    int size() const { return ids.size(); }
+};
+
+Q_DECLARE_METATYPE(TelemetryDelta)
+
+
+/**
+ * @brief The TelemetryPublisher class : Coalesces telemetry into at most one signal per interval.
+ *
+ * Sampling threads call update() for every value they read, at any rate. Only the
+ * newest value per (device, register) is kept, and the publisher's own thread (e.g.
+ * the GUI thread it was created in) emits them as one updated() delta no more than
+ * once per interval. Nothing is scheduled while no value changes. The pending delta
+ * never holds more than one entry per register, but a delta already emitted to a
+ * consumer in another thread is a queued event: one that takes longer than the
+ * interval to handle them lets deltas pile up in its event queue. With
+ * acknowledgeRequired set, the next delta is held back (and keeps coalescing) until
+ * the consumer calls acknowledge(), so at most one is ever queued.
+ * Values that did not change are dropped unless publishUnchanged is set.
+ */
+class TelemetryPublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit TelemetryPublisher(int intervalMsec = 50, QObject *parent = 0);
+
+    void update(int id, int address, int value);
+    int value(int id, int address) const;
+
+    int interval(void) const;
+    void setInterval(int msec);
+    bool publishUnchanged(void) const;
+    void setPublishUnchanged(bool enabled);
+    bool acknowledgeRequired(void) const;
+    void setAcknowledgeRequired(bool enabled);
+    void acknowledge(void);
+    qint64 updateCount(void) const;
+    qint64 signalCount(void) const;
+
+signals:
+
+    void updated(const TelemetryDelta &delta);
+
+private slots:
+
+    void scheduleFlush(void);
+    void flush(void);
+
+private:
+
+    static int key(int id, int address);
+
+    mutable QMutex mutex;
+    QHash<int, int> latest;     // every register ever seen
+    QVector<int> dirty;         // keys changed since the last delta, in arrival order
+    QSet<int> dirtyKeys;
+    bool flushPending;
+    bool unchangedPublished;
+    bool ackRequired;
+    bool unacknowledged;        // a delta was emitted and acknowledge() was not called yet
+    qint64 received;
+    qint64 emitted;
+    QTimer *flushTimer;
+    QElapsedTimer sinceFlush;
+    int intervalMsec;
+
+};
+
+#endif // TELEMETRYPUBLISHER_H
@@ -0,0 +1,290 @@
+#include "telemetrystore.h"
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <qmath.h>
+
+
+// READ LOCK: *****************************************************************
+
+TelemetryStore::ReadLock::ReadLock(const TelemetryStore &store) :
+    lock(&store.lock)
+{
+    lock->lockForRead();
+}
+
+
+TelemetryStore::ReadLock::~ReadLock(){
+    lock->unlock();
+}
+
+
+// STORE: *********************************************************************
+
+/**
+* @param defaultCapacity Capacity of channels created implicitly by append(), rounded up to a power of two
+*/
+TelemetryStore::TelemetryStore(int defaultCapacity) :
+    lock(QReadWriteLock::Recursive),
+    defaultCapacity(defaultCapacity)
+{
+}
+
+
+TelemetryStore::~TelemetryStore(){
+    qDeleteAll(store);
+}
+
+
+/**
+* Creates (or recreates, dropping its history) a channel
+* @param id Dynamixel ID
+* @param address Register address
+* @param capacity Samples kept, rounded up to a power of two
+*/
+void TelemetryStore::addChannel(int id, int address, int capacity){
+    QWriteLocker locker(&lock);
+    delete store.take(key(id, address));
+    store.insert(key(id, address), createChannel(capacity));
+}
+
+
+/**
+* Removes a channel and its history
+* @param id Dynamixel ID
+* @param address Register address
+*/
+void TelemetryStore::removeChannel(int id, int address){
+    QWriteLocker locker(&lock);
+    delete store.take(key(id, address));
+}
+
+
+/**
+* Returns every channel
+* @return (ID, address) pairs
+*/
+QList<QPair<int, int> > TelemetryStore::channels(void) const{
+    QReadLocker locker(&lock);
+    QList<QPair<int, int> > list;
+    foreach (int k, store.keys()) list << qMakePair(k >> 8, k & 0xFF);
+    return list;
+}
+
+
+/**
+* Appends a sample, creating the channel with the default capacity if needed
+* @param id Dynamixel ID
+* @param address Register address
+* @param timestamp Sample time, not earlier than the channel's last sample
+* @param value Sample value
+* @return true if stored, false if the timestamp went backwards
+*/
+bool TelemetryStore::append(int id, int address, qint64 timestamp, double value){
+    QWriteLocker locker(&lock);
+    Channel *channel = store.value(key(id, address), 0);
+    if (channel == 0){
+        channel = createChannel(defaultCapacity);
+        store.insert(key(id, address), channel);
+    }
+    if (channel->size > 0 && timestamp < channel->time.at((channel->head - 1) & channel->mask)) return false;
+
+    channel->time[channel->head] = timestamp;
+    channel->value[channel->head] = value;
+    channel->head = (channel->head + 1) & channel->mask;
+    if (channel->size <= channel->mask) channel->size++;
+    return true;
+}
+
+
+/**
+* Returns the number of samples held by a channel
+* @param id Dynamixel ID
+* @param address Register address
+* @return Number of samples, 0 for an unknown channel
+*/
+int TelemetryStore::count(int id, int address) const{
+    QReadLocker locker(&lock);
+    const Channel *channel = store.value(key(id, address), 0);
+    return channel != 0 ? channel->size : 0;
+}
+
+
+/**
+* Returns the newest samples of a channel (hold a ReadLock while using the view)
+* @param id Dynamixel ID
+* @param address Register address
+* @param n Number of samples
+* @return Up to n samples, oldest first
+*/
+TelemetryView TelemetryStore::last(int id, int address, int n) const{
+    QReadLocker locker(&lock);
+    const Channel *channel = store.value(key(id, address), 0);
+    if (channel == 0) return view(0, 0, 0);
+    n = qBound(0, n, channel->size);
+    return view(channel, channel->size - n, n);
+}
+
+
+/**
+* Returns the samples of a channel with from <= timestamp < to (hold a ReadLock while using the view)
+* @param id Dynamixel ID
+* @param address Register address
+* @param from Window start, inclusive
+* @param to Window end, exclusive
+* @return Samples in the window, oldest first
+*/
+TelemetryView TelemetryStore::window(int id, int address, qint64 from, qint64 to) const{
+    QReadLocker locker(&lock);
+    const Channel *channel = store.value(key(id, address), 0);
+    if (channel == 0 || to <= from) return view(0, 0, 0);
+    int begin = lowerBound(channel, from);
+    int end = lowerBound(channel, to);
+    return view(channel, begin, end - begin);
+}
+
+
+/**
+* Computes minimum, maximum and mean of a view in one pass
+* @param view Samples
+* @return Statistics; count 0 and zero values for an empty view
+*/
+TelemetryStatistics TelemetryStore::statistics(const TelemetryView &view){
+    TelemetryStatistics stats = { 0, 0, 0, 0 };
+    if (view.size() == 0) return stats;
+
+    double minimum = view.value(0), maximum = minimum, sum = 0;
+    const double *runs[2] = { view.firstValue, view.secondValue };
+    int lengths[2] = { view.firstLength, view.secondLength };
+    for (int r = 0; r < 2; r++){
+        const double *values = runs[r];
+        for (int i = 0; i < lengths[r]; i++){
+            minimum = qMin(minimum, values[i]);
+            maximum = qMax(maximum, values[i]);
+            sum += values[i];
+        }
+    }
+    stats.count = view.size();
+    stats.minimum = minimum;
+    stats.maximum = maximum;
+    stats.mean = sum / stats.count;
+    return stats;
+}
+
+
+/**
+* Reduces a view to a number of points with Largest-Triangle-Three-Buckets, which keeps
+* the visual shape (peaks, dips) of the series far better than picking every k-th sample
+* @param view Samples
+* @param threshold Number of points wanted, at least 3
+* @return Selected samples, oldest first; all samples if there are no more than threshold
+*/
+QVector<TelemetryPoint> TelemetryStore::downsample(const TelemetryView &view, int threshold){
+    int n = view.size();
+    QVector<TelemetryPoint> points;
+    if (threshold >= n || threshold < 3){
+        points.resize(n);
+        for (int i = 0; i < n; i++){
+            points[i].timestamp = view.timestamp(i);
+            points[i].value = view.value(i);
+        }
+        return points;
+    }
+
+    points.resize(threshold);
+    points[0].timestamp = view.timestamp(0);
+    points[0].value = view.value(0);
+
+    // first and last points are kept; the rest is split into threshold - 2 buckets
+    double bucketSize = double(n - 2) / (threshold - 2);
+    int selected = 0;
+    for (int b = 0; b < threshold - 2; b++){
+        // average of the next bucket is the third triangle corner
+        int nextStart = int((b + 1) * bucketSize) + 1;
+        int nextEnd = qMin(int((b + 2) * bucketSize) + 1, n);
+        double averageTime = 0, averageValue = 0;
+        for (int i = nextStart; i < nextEnd; i++){
+            averageTime += view.timestamp(i);
+            averageValue += view.value(i);
+        }
+        averageTime /= (nextEnd - nextStart);
+        averageValue /= (nextEnd - nextStart);
+
+        double selectedTime = view.timestamp(selected);
+        double selectedValue = view.value(selected);
+        int start = int(b * bucketSize) + 1;
+        int end = int((b + 1) * bucketSize) + 1;
+        double largestArea = -1;
+        int largest = start;
+        for (int i = start; i < end; i++){
+            double area = qAbs((selectedTime - averageTime) * (view.value(i) - selectedValue) -
+                               (selectedTime - view.timestamp(i)) * (averageValue - selectedValue));
+            if (area > largestArea){
+                largestArea = area;
+                largest = i;
+            }
+        }
+        points[b + 1].timestamp = view.timestamp(largest);
+        points[b + 1].value = view.value(largest);
+        selected = largest;
+    }
+
+    points[threshold - 1].timestamp = view.timestamp(n - 1);
+    points[threshold - 1].value = view.value(n - 1);
+    return points;
+}
+
+
+// INTERNAL SUBROUTINES (private) ************************************************************************
+
+int TelemetryStore::key(int id, int address){
+    return (id << 8) | (address & 0xFF);
+}
+
+
+/**
+* Builds a view of logical samples [begin, begin + length) of a channel, oldest = 0
+*/
+TelemetryView TelemetryStore::view(const Channel *channel, int begin, int length){
+    TelemetryView v = { 0, 0, 0, 0, 0, 0 };
+    if (channel == 0 || length <= 0) return v;
+
+    int capacity = channel->mask + 1;
+    int start = (channel->head - channel->size + begin) & channel->mask;
+    v.firstTime = channel->time.constData() + start;
+    v.firstValue = channel->value.constData() + start;
+    v.firstLength = qMin(length, capacity - start);
+    v.secondTime = channel->time.constData();
+    v.secondValue = channel->value.constData();
+    v.secondLength = length - v.firstLength;
+    return v;
+}
+
+
+TelemetryStore::Channel *TelemetryStore::createChannel(int capacity){
+    int size = 1;
+    while (size < capacity) size <<= 1;
+
+    Channel *channel = new Channel;
+    channel->time.resize(size);
+    channel->value.resize(size);
+    channel->mask = size - 1;
+    channel->head = 0;
+    channel->size = 0;
+    return channel;
+}
+
+
+/**
+* Finds the first logical sample with a timestamp not earlier than the given one
+* @return Logical index, channel->size if there is none
+*/
+int TelemetryStore::lowerBound(const Channel *channel, qint64 timestamp) const{
+    int oldest = channel->head - channel->size;
+    int low = 0, high = channel->size;
+    while (low < high){
+        int middle = (low + high) / 2;
+        if (channel->time.at((oldest + middle) & channel->mask) < timestamp) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
@@ -0,0 +1,120 @@
+#ifndef TELEMETRYSTORE_H
+#define TELEMETRYSTORE_H
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QVector>
+
+/**
+ * @brief The TelemetryPoint struct : One sample, as returned by downsampling
+ */
+struct TelemetryPoint
+{
+    qint64 timestamp;
+    double value;
+};
+
+
+/**
+ * @brief The TelemetryStatistics struct : Aggregate over a TelemetryView
+ */
+struct TelemetryStatistics
+{
+    int count;
+    double minimum;
+    double maximum;
+    double mean;
+};
+
+
+/**
+ * @brief The TelemetryView struct : Samples of one channel, in place in its ring buffer.
+ * A ring wraps at most once, so the samples are at most two contiguous runs:
+ * first[0..firstLength) followed by second[0..secondLength).
+ */
+struct TelemetryView
+{
+    const qint64 *firstTime;
+    const double *firstValue;
+    int firstLength;
+    const qint64 *secondTime;
+    const double *secondValue;
+    int secondLength;
+
+    int size() const { return firstLength + secondLength; }
+    qint64 timestamp(int i) const { return i < firstLength ? firstTime[i] : secondTime[i - firstLength]; }
+    double value(int i) const { return i < firstLength ? firstValue[i] : secondValue[i - firstLength]; }
+};
+
+
+/**
+ * @brief The TelemetryStore class : In-memory history of register values.
+ *
+ * Each channel, one (device ID, register address) pair, is a fixed-capacity ring
+ * with the timestamps and the values in two separate arrays, so scans over either
+ * touch only the memory they need. Appends are O(1) and overwrite the oldest sample
+ * once the ring is full; timestamps must not decrease within a channel, which lets
+ * time windows be found by binary search.
+ *
+ * Queries return TelemetryViews pointing into the rings instead of copies. A view
+ * is valid while a ReadLock on the store is held, e.g.
+ *
+ *     TelemetryStore::ReadLock lock(store);
+ *     TelemetryView view = store.window(4, address, from, to);
+ *     TelemetryStatistics stats = TelemetryStore::statistics(view);
+ */
+class TelemetryStore
+{
+public:
+
+    /**
+     * @brief The ReadLock class : Keeps views valid (appends wait) for the lifetime of the object
+     */
+    class ReadLock
+    {
+    public:
+        explicit ReadLock(const TelemetryStore &store);
+        ~ReadLock();
+    private:
+        Q_DISABLE_COPY(ReadLock)
+        QReadWriteLock *lock;
+    };
+
+    explicit TelemetryStore(int defaultCapacity = 4096);
+    ~TelemetryStore();
+
+    void addChannel(int id, int address, int capacity);
+    void removeChannel(int id, int address);
+    QList<QPair<int, int> > channels(void) const;
+    bool append(int id, int address, qint64 timestamp, double value);
+
+    int count(int id, int address) const;
+    TelemetryView last(int id, int address, int n) const;
+    TelemetryView window(int id, int address, qint64 from, qint64 to) const;
+
+    static TelemetryStatistics statistics(const TelemetryView &view);
+    static QVector<TelemetryPoint> downsample(const TelemetryView &view, int threshold);
+
+private:
+
+    struct Channel {
+        QVector<qint64> time;
+        QVector<double> value;
+        int mask;       // capacity - 1, capacity is a power of two
+        int head;       // next write position
+        int size;
+    };
+
+    static int key(int id, int address);
+    static TelemetryView view(const Channel *channel, int begin, int length);
+    Channel *createChannel(int capacity);
+    int lowerBound(const Channel *channel, qint64 timestamp) const;
+
+    mutable QReadWriteLock lock;
+    QHash<int, Channel *> store;
+    int defaultCapacity;
+
+};
+
+#endif // TELEMETRYSTORE_H
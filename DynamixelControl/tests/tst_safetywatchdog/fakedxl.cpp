@@ -0,0 +1,178 @@
+#include "fakedxl.h"
+#include "dynamixel_control.h"
+#include <QThread>
+#include <QAtomicInt>
+
+const int TORQUE_ENABLE_ADDRESS = 24;
+
+static QAtomicInt transactionUsec(1000);
+static QAtomicInt torqueOffs(0);
+static QAtomicInt overlaps(0);
+static QAtomicInt busy(0);
+
+// the DLL's single packet buffer
+static int txId = 0;
+static int txInstruction = 0;
+static int txParameters[MAXNUM_TXPARAM];
+static int txLength = 0;
+static int rxParameters[MAXNUM_RXPARAM];
+static int rxLength = 0;
+static int result = COMM_RXSUCCESS;
+
+
+/**
+* Sets how long every transaction occupies the bus
+* @param usec Microseconds
+*/
+void FakeDxl::setTransactionTime(int usec){
+    transactionUsec.store(usec);
+}
+
+
+/**
+* Returns the number of broadcast Torque Enable = 0 writes
+* @return Count
+*/
+int FakeDxl::torqueOffCount(void){
+    return torqueOffs.load();
+}
+
+
+/**
+* Returns the number of transactions that started while another was running
+* @return Count
+*/
+int FakeDxl::overlapCount(void){
+    return overlaps.load();
+}
+
+
+/**
+* Clears the counters
+*/
+void FakeDxl::reset(void){
+    torqueOffs.store(0);
+    overlaps.store(0);
+}
+
+
+// DLL **************************************************************************************************
+
+int __stdcall dxl_initialize(int devIndex, int baudnum){
+    Q_UNUSED(devIndex);
+    Q_UNUSED(baudnum);
+    return 1;
+}
+
+void __stdcall dxl_terminate(){
+}
+
+void __stdcall dxl_set_txpacket_id(int id){
+    txId = id;
+}
+
+void __stdcall dxl_set_txpacket_instruction(int instruction){
+    txInstruction = instruction;
+}
+
+void __stdcall dxl_set_txpacket_parameter(int index, int value){
+    if (index >= 0 && index < MAXNUM_TXPARAM) txParameters[index] = value;
+}
+
+void __stdcall dxl_set_txpacket_length(int length){
+    txLength = length;
+}
+
+int __stdcall dxl_get_rxpacket_error(int errbit){
+    Q_UNUSED(errbit);
+    return 0;
+}
+
+int __stdcall dxl_get_rxpacket_parameter(int index){
+    return index >= 0 && index < rxLength ? rxParameters[index] : 0;
+}
+
+int __stdcall dxl_get_rxpacket_length(){
+    return rxLength + 2;
+}
+
+int __stdcall dxl_makeword(int lowbyte, int highbyte){
+    return (lowbyte & 0xFF) | ((highbyte & 0xFF) << 8);
+}
+
+int __stdcall dxl_get_lowbyte(int word){
+    return word & 0xFF;
+}
+
+int __stdcall dxl_get_highbyte(int word){
+    return (word >> 8) & 0xFF;
+}
+
+void __stdcall dxl_tx_packet(){
+}
+
+void __stdcall dxl_rx_packet(){
+}
+
+void __stdcall dxl_txrx_packet(){
+    if (!busy.testAndSetOrdered(0, 1)) overlaps.fetchAndAddOrdered(1);
+    QThread::usleep(transactionUsec.load());
+
+    if (txId == BROADCAST_ID && txInstruction == INST_WRITE && txLength == 4 &&
+            txParameters[0] == TORQUE_ENABLE_ADDRESS && txParameters[1] == 0) torqueOffs.fetchAndAddOrdered(1);
+    rxLength = txInstruction == INST_READ ? qBound(0, txParameters[1], (int)MAXNUM_RXPARAM) : 0;
+    for (int i = 0; i < rxLength; i++) rxParameters[i] = 0;
+    result = COMM_RXSUCCESS;
+
+    busy.store(0);
+}
+
+int __stdcall dxl_get_result(){
+    return result;
+}
+
+void __stdcall dxl_ping(int id){
+    dxl_set_txpacket_id(id);
+    dxl_set_txpacket_instruction(INST_PING);
+    dxl_set_txpacket_length(2);
+    dxl_txrx_packet();
+}
+
+int __stdcall dxl_read_byte(int id, int address){
+    dxl_set_txpacket_id(id);
+    dxl_set_txpacket_instruction(INST_READ);
+    dxl_set_txpacket_parameter(0, address);
+    dxl_set_txpacket_parameter(1, 1);
+    dxl_set_txpacket_length(4);
+    dxl_txrx_packet();
+    return rxParameters[0];
+}
+
+void __stdcall dxl_write_byte(int id, int address, int value){
+    dxl_set_txpacket_id(id);
+    dxl_set_txpacket_instruction(INST_WRITE);
+    dxl_set_txpacket_parameter(0, address);
+    dxl_set_txpacket_parameter(1, value);
+    dxl_set_txpacket_length(4);
+    dxl_txrx_packet();
+}
+
+int __stdcall dxl_read_word(int id, int address){
+    dxl_set_txpacket_id(id);
+    dxl_set_txpacket_instruction(INST_READ);
+    dxl_set_txpacket_parameter(0, address);
+    dxl_set_txpacket_parameter(1, 2);
+    dxl_set_txpacket_length(4);
+    dxl_txrx_packet();
+    return dxl_makeword(rxParameters[0], rxParameters[1]);
+}
+
+void __stdcall dxl_write_word(int id, int address, int value){
+    dxl_set_txpacket_id(id);
+    dxl_set_txpacket_instruction(INST_WRITE);
+    dxl_set_txpacket_parameter(0, address);
+    dxl_set_txpacket_parameter(1, dxl_get_lowbyte(value));
+    dxl_set_txpacket_parameter(2, dxl_get_highbyte(value));
+    dxl_set_txpacket_length(5);
+    dxl_txrx_packet();
+}
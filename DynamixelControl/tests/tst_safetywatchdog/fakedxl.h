@@ -0,0 +1,24 @@
+#ifndef FAKEDXL_H
+#define FAKEDXL_H
+
+/**
+ * @brief The FakeDxl class : Simulated Dynamixel DLL for the tests.
+ *
+ * Implements the functions of dynamixel_control.h without a port: every
+ * transaction sleeps for the configured transaction time, every device answers
+ * with zeros, and broadcast writes of Torque Enable = 0 are counted. Two
+ * transactions running at the same time mean the bus was not serialised and are
+ * counted as overlaps.
+ */
+class FakeDxl
+{
+public:
+
+    static void setTransactionTime(int usec);
+    static int torqueOffCount(void);
+    static int overlapCount(void);
+    static void reset(void);
+
+};
+
+#endif // FAKEDXL_H
@@ -0,0 +1,91 @@
+#include <QtTest>
+#include <QThread>
+#include "fakedxl.h"
+#include "dynamixelbus.h"
+#include "safetywatchdog.h"
+
+const int TRANSACTION_TIME = 10000;     // usec per simulated transaction
+const int JOINTS = 12;                  // one bulk read holds the bus for 12 transactions
+const int DEADLINE = 40;                // msec
+const int TRIPS = 5;
+
+
+/**
+ * @brief The BusHolder class : Keeps the bus busy with bulk reads, each inside one held Lock
+ */
+class BusHolder : public QThread
+{
+protected:
+
+    void run(){
+        QList<BulkReadRequest> requests;
+        for (int id = 1; id <= JOINTS; id++){
+            BulkReadRequest request = { id, 36, 6 };
+            requests << request;
+        }
+        while (!isInterruptionRequested()){
+            DynamixelBus::Lock lock(BusArbiter::Telemetry);
+            DynamixelBus::bulkRead(requests, BusArbiter::Telemetry);
+        }
+    }
+
+};
+
+
+class TestSafetyWatchdog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void initTestCase();
+    void tripsWithinBoundWhileBusIsHeld();
+
+};
+
+
+void TestSafetyWatchdog::initTestCase(){
+    FakeDxl::setTransactionTime(TRANSACTION_TIME);
+    FakeDxl::reset();
+}
+
+
+/**
+* The watchdog trips while another thread holds the bus for a whole bulk read
+* (12 transactions, far longer than the bound); every trip must still stay
+* within latencyBound(), which needs the holder to be preempted.
+*/
+void TestSafetyWatchdog::tripsWithinBoundWhileBusIsHeld(){
+    BusHolder holder;
+    holder.start();
+    QTest::qWait(2 * TRANSACTION_TIME / 1000);
+
+    int preemptionsBefore = DynamixelBus::arbiter()->preemptionCount();
+    SafetyWatchdog watchdog(DEADLINE);
+    QVERIFY(JOINTS * TRANSACTION_TIME > watchdog.latencyBound());
+    watchdog.start();
+
+    // no heartbeat at all: every rearm() starts the next deadline
+    for (int trip = 1; trip <= TRIPS; trip++){
+        QTRY_COMPARE_WITH_TIMEOUT(watchdog.statistics().trips, trip, 10 * DEADLINE + 1000);
+        watchdog.rearm();
+    }
+
+    watchdog.stop();
+    holder.requestInterruption();
+    holder.wait();
+
+    SafetyStatistics statistics = watchdog.statistics();
+    qDebug("latency: last %.0f usec, max %.0f usec, bound %.0f usec",
+           statistics.lastLatencyUsec, statistics.maxLatencyUsec, watchdog.latencyBound());
+    QVERIFY(statistics.maxLatencyUsec <= watchdog.latencyBound());
+    QCOMPARE(statistics.boundViolations, 0);
+    QVERIFY(DynamixelBus::arbiter()->preemptionCount() > preemptionsBefore);
+    QVERIFY(FakeDxl::torqueOffCount() >= TRIPS);
+    QCOMPARE(FakeDxl::overlapCount(), 0);
+}
+
+
+QTEST_MAIN(TestSafetyWatchdog)
+
+#include "tst_safetywatchdog.moc"
@@ -0,0 +1,38 @@
+#-------------------------------------------------
+#
+# SafetyWatchdog reaction time against a simulated bus
+#
+#-------------------------------------------------
+
+QT       += core serialport testlib
+
+QT       -= gui
+
+TARGET = tst_safetywatchdog
+CONFIG   += console testcase
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+# The bus classes are built against fakedxl.cpp instead of -ldynamixel, so the
+# test runs without a USB2Dynamixel and with known transaction times.
+INCLUDEPATH += ../..
+
+SOURCES += tst_safetywatchdog.cpp \
+    fakedxl.cpp \
+    ../../actuatorcontrol.cpp \
+    ../../dynamixelbus.cpp \
+    ../../busarbiter.cpp \
+    ../../buscapture.cpp \
+    ../../devicehealth.cpp \
+    ../../safetywatchdog.cpp
+
+HEADERS += fakedxl.h \
+    ../../dynamixel_control.h \
+    ../../actuatorcontrol.h \
+    ../../dynamixelbus.h \
+    ../../busarbiter.h \
+    ../../buscapture.h \
+    ../../devicehealth.h \
+    ../../statuspacketparser.h \
+    ../../safetywatchdog.h
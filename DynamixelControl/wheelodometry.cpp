@@ -0,0 +1,273 @@
+#include "wheelodometry.h"
+#include "actuatorcontrol.h"
+#include "dynamixelbus.h"
+#include "dynamixel_control.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <qmath.h>
+
+const int DEFAULT_SAMPLE_RATE = 50;
+const double DEFAULT_SPEED_UNIT = 0.111 * 2 * M_PI / 60;   // 0.111 rpm per unit
+const double POSITION_UNIT = 0.29 * M_PI / 180;            // radians per position unit
+const int POSITION_RANGE = 1024;                           // positions over 300 degrees
+const int DEAD_ZONE_MARGIN = 16;                           // distrust positions this close to 0/1023
+const double MAX_POSITION_TRAVEL = M_PI / 2;               // per sample, larger deltas may have wrapped
+
+
+/**
+* Creates an odometry integrator. Add the wheels, then call start().
+* @param type Differential (two or more wheels on one axis) or Omni (holonomic)
+* @param parent Parent object
+*/
+WheelOdometry::WheelOdometry(DriveType type, QObject *parent) :
+    QThread(parent),
+    driveType(type),
+    rate(DEFAULT_SAMPLE_RATE)
+{
+    qRegisterMetaType<OdometryState>("OdometryState");
+    resetPose();
+}
+
+
+/**
+* Stops the odometry thread before destruction
+*/
+WheelOdometry::~WheelOdometry(){
+    stop();
+}
+
+
+/**
+* Adds a wheel (only before start())
+* @param id Dynamixel actuator ID, in wheel mode
+* @param x Wheel contact point, body frame (forward)
+* @param y Wheel contact point, body frame (left)
+* @param rollingDirection Direction the wheel rolls in for a positive wheel speed, radians from body x
+* @param radius Wheel radius; sets the unit of the pose
+* @param direction 1 if CCW rotation (Present Speed 0-1023) rolls the wheel forward, -1 otherwise
+* @return Wheel index
+*/
+int WheelOdometry::addWheel(int id, double x, double y, double rollingDirection, double radius, int direction){
+    Wheel wheel;
+    wheel.id = id;
+    wheel.x = x;
+    wheel.y = y;
+    wheel.rollingDirection = rollingDirection;
+    wheel.radius = radius;
+    wheel.direction = direction < 0 ? -1 : 1;
+    wheel.speedUnit = DEFAULT_SPEED_UNIT;
+    wheel.lastPosition = -1;
+    wheel.lastReadAt = -1;
+    wheels.append(wheel);
+    return wheels.size() - 1;
+}
+
+
+/**
+* Sets the wheel angular speed per Present Speed unit (only before start())
+* @param wheel Wheel index
+* @param radiansPerSecondPerUnit Angular speed per unit (default: 0.111 rpm)
+*/
+void WheelOdometry::setSpeedUnit(int wheel, double radiansPerSecondPerUnit){
+    wheels[wheel].speedUnit = radiansPerSecondPerUnit;
+}
+
+
+/**
+* Returns the sample rate
+* @return Samples per second
+*/
+int WheelOdometry::sampleRate(void) const{
+    return rate.load();
+}
+
+
+/**
+* Sets the sample rate
+* @param samplesPerSecond Samples per second, range: 1-1000
+*/
+void WheelOdometry::setSampleRate(int samplesPerSecond){
+    rate.store(qBound(1, samplesPerSecond, 1000));
+}
+
+
+/**
+* Returns the latest pose and velocity
+* @return Odometry state
+*/
+OdometryState WheelOdometry::state(void) const{
+    QMutexLocker locker(&stateMutex);
+    return current;
+}
+
+
+/**
+* Resets the pose to the origin (velocity and timestamp are kept)
+*/
+void WheelOdometry::resetPose(void){
+    QMutexLocker locker(&stateMutex);
+    current.x = 0;
+    current.y = 0;
+    current.heading = 0;
+    if (!isRunning()){
+        current.timestamp = 0;
+        current.vx = 0;
+        current.vy = 0;
+        current.omega = 0;
+        current.failedReads = 0;
+    }
+}
+
+
+/**
+* Stops the odometry thread and waits for it
+*/
+void WheelOdometry::stop(void){
+    requestInterruption();
+    wait();
+}
+
+
+/**
+* Sampling and integration loop
+*/
+void WheelOdometry::run(){
+    if (!computePseudoInverse()) return;
+
+    int address = ActuatorControl::controlTableAddress("present position(l)");
+    for (int i = 0; i < wheels.size(); i++){
+        wheels[i].lastPosition = -1;
+        wheels[i].lastReadAt = -1;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 nextSample = 0;
+    QVector<double> travel(wheels.size());
+    QVector<QVector<int> > replies(wheels.size());
+    QVector<qint64> readAt(wheels.size());
+
+    while (!isInterruptionRequested()){
+        // one READ per wheel, each timed on its own; a missing wheel skips the sample
+        bool complete = true;
+        for (int i = 0; complete && i < wheels.size(); i++){
+            qint64 start = clock.nsecsElapsed();
+            complete = DynamixelBus::readBlock(wheels.at(i).id, address, 4, replies[i], BusArbiter::Telemetry) == COMM_RXSUCCESS;
+            readAt[i] = start + (clock.nsecsElapsed() - start) / 2;
+        }
+
+        if (!complete){
+            QMutexLocker locker(&stateMutex);
+            current.failedReads++;
+        }
+        else{
+            qint64 timestamp = 0;
+            double dt = 0;
+            for (int i = 0; i < wheels.size(); i++){
+                const QVector<int> &data = replies.at(i);
+                double wheelDt = wheels.at(i).lastReadAt < 0 ? 0 : (readAt.at(i) - wheels.at(i).lastReadAt) / 1e9;
+                wheels[i].lastReadAt = readAt.at(i);
+                travel[i] = wheelTravel(wheels[i], data.at(0) | (data.at(1) << 8), data.at(2) | (data.at(3) << 8), wheelDt);
+                timestamp += readAt.at(i);
+                dt += wheelDt;
+            }
+            timestamp /= wheels.size();
+            dt /= wheels.size();
+
+            // Body displacement by least squares: [dx, dy, dtheta] = pinv(H) * travel
+            double body[3] = { 0, 0, 0 };
+            for (int row = 0; row < 3; row++){
+                for (int i = 0; i < wheels.size(); i++) body[row] += pseudoInverse.at(row * wheels.size() + i) * travel.at(i);
+            }
+
+            QMutexLocker locker(&stateMutex);
+            double midHeading = current.heading + body[2] / 2;
+            current.x += body[0] * qCos(midHeading) - body[1] * qSin(midHeading);
+            current.y += body[0] * qSin(midHeading) + body[1] * qCos(midHeading);
+            current.heading += body[2];
+            if (dt > 0){
+                current.vx = body[0] / dt;
+                current.vy = body[1] / dt;
+                current.omega = body[2] / dt;
+            }
+            current.timestamp = timestamp;
+            OdometryState published = current;
+            locker.unlock();
+            emit updated(published);
+        }
+
+        nextSample += 1000000000LL / rate.load();
+        qint64 remaining = nextSample - clock.nsecsElapsed();
+        if (remaining > 0) usleep(remaining / 1000);
+        else nextSample = clock.nsecsElapsed();
+    }
+}
+
+
+/**
+* Precomputes pinv(H) = (H^T H)^-1 H^T, where row i of H maps the body velocity to the
+* surface speed of wheel i: [cos b, sin b, x sin b - y cos b]. Differential bases cannot
+* move sideways, so vy is left out of their solution.
+* @return false if the geometry does not determine the body velocity
+*/
+bool WheelOdometry::computePseudoInverse(void){
+    const int n = wheels.size();
+    QVector<double> h(3 * n);
+    for (int i = 0; i < n; i++){
+        const Wheel &w = wheels.at(i);
+        double c = qCos(w.rollingDirection), s = qSin(w.rollingDirection);
+        h[i * 3] = c;
+        h[i * 3 + 1] = driveType == Omni ? s : 0;
+        h[i * 3 + 2] = w.x * s - w.y * c;
+    }
+
+    // H^T H (3x3); for differential drive the vy row/column is replaced by identity
+    double a[9] = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    for (int i = 0; i < n; i++){
+        for (int r = 0; r < 3; r++){
+            for (int c = 0; c < 3; c++) a[r * 3 + c] += h[i * 3 + r] * h[i * 3 + c];
+        }
+    }
+    if (driveType == Differential) a[4] = 1;
+
+    double c00 = a[4] * a[8] - a[5] * a[7], c01 = a[2] * a[7] - a[1] * a[8], c02 = a[1] * a[5] - a[2] * a[4];
+    double c10 = a[5] * a[6] - a[3] * a[8], c11 = a[0] * a[8] - a[2] * a[6], c12 = a[2] * a[3] - a[0] * a[5];
+    double c20 = a[3] * a[7] - a[4] * a[6], c21 = a[1] * a[6] - a[0] * a[7], c22 = a[0] * a[4] - a[1] * a[3];
+    double determinant = a[0] * c00 + a[1] * c10 + a[2] * c20;
+    if (qAbs(determinant) < 1e-12) return false;
+    double inverse[9] = { c00, c01, c02, c10, c11, c12, c20, c21, c22 };
+
+    pseudoInverse.resize(3 * n);
+    for (int r = 0; r < 3; r++){
+        for (int i = 0; i < n; i++){
+            double sum = 0;
+            for (int k = 0; k < 3; k++) sum += inverse[r * 3 + k] * h[i * 3 + k];
+            pseudoInverse[r * n + i] = sum / determinant;
+        }
+    }
+    return true;
+}
+
+
+/**
+* Returns the distance a wheel's contact point rolled since the previous sample
+* @param wheel Wheel (its last position is updated)
+* @param position Present Position
+* @param speed Present Speed (0-1023 CCW, 1024-2047 CW)
+* @param dt Seconds since the previous sample
+* @return Rolled distance, positive forward
+*/
+double WheelOdometry::wheelTravel(Wheel &wheel, int position, int speed, double dt) const{
+    double angularSpeed = (speed & 0x3FF) * wheel.speedUnit * ((speed & 0x400) ? -1 : 1);
+    double angle = angularSpeed * dt;
+
+    bool positionValid = position >= DEAD_ZONE_MARGIN && position < POSITION_RANGE - DEAD_ZONE_MARGIN;
+    if (positionValid && wheel.lastPosition >= 0){
+        double positionAngle = (position - wheel.lastPosition) * POSITION_UNIT;
+        bool consistent = qAbs(positionAngle) < MAX_POSITION_TRAVEL && (positionAngle * angle >= 0 || qAbs(angle) < POSITION_UNIT);
+        if (consistent) angle = positionAngle;
+    }
+    wheel.lastPosition = positionValid ? position : -1;
+
+    return wheel.direction * angle * wheel.radius;
+}
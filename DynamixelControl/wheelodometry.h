@@ -0,0 +1,98 @@
+#ifndef WHEELODOMETRY_H
+#define WHEELODOMETRY_H
+#include <QThread>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QVector>
+#include <QMetaType>
+
+/**
+ * @brief The OdometryState struct : Integrated pose and body velocity of a drive base
+ */
+struct OdometryState
+{
+    qint64 timestamp;   // ns since the odometry thread was started, mean of the wheels' read times
+    double x;           // odometry frame, wheel radius unit
+    double y;
+    double heading;     // radians, counter-clockwise
+    double vx;          // body frame, unit per second
+    double vy;
+    double omega;       // radians per second
+    int failedReads;    // samples skipped because a wheel did not answer
+};
+
+Q_DECLARE_METATYPE(OdometryState)
+
+
+/**
+ * @brief The WheelOdometry class : Dead reckoning for wheel-mode drive bases.
+ *
+ * At a fixed rate, reads Present Position and Present Speed of every wheel, one READ
+ * per wheel, converts them to wheel surface speeds and solves for the body velocity by
+ * least squares (pseudo-inverse precomputed from the wheel geometry). Differential
+ * bases are solved for (vx, omega), omni bases for (vx, vy, omega). The wheels are not
+ * read at one instant, so each wheel's travel is taken over the measured time between
+ * its own reads (middle of each READ), and the body velocity over the mean of those
+ * intervals, not the nominal period.
+ *
+ * Wheel travel comes from the position delta when it is trustworthy (both samples
+ * outside the 300-360 degree dead zone and consistent with the measured speed) and
+ * from speed * dt otherwise.
+ */
+class WheelOdometry : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    enum DriveType {
+        Differential,
+        Omni
+    };
+
+    explicit WheelOdometry(DriveType type, QObject *parent = 0);
+    ~WheelOdometry();
+
+    int addWheel(int id, double x, double y, double rollingDirection, double radius, int direction = 1);
+    void setSpeedUnit(int wheel, double radiansPerSecondPerUnit);
+    int sampleRate(void) const;
+    void setSampleRate(int samplesPerSecond);
+    OdometryState state(void) const;
+    void resetPose(void);
+    void stop(void);
+
+signals:
+
+    void updated(const OdometryState &state);
+
+protected:
+
+    void run();
+
+private:
+
+    struct Wheel {
+        int id;
+        double x;
+        double y;
+        double rollingDirection;
+        double radius;
+        int direction;
+        double speedUnit;
+        int lastPosition;
+        qint64 lastReadAt;  // ns, middle of the wheel's last successful READ
+    };
+
+    bool computePseudoInverse(void);
+    double wheelTravel(Wheel &wheel, int position, int speed, double dt) const;
+
+    DriveType driveType;
+    QVector<Wheel> wheels;
+    QVector<double> pseudoInverse;  // 3 rows (vx, vy, omega) x wheel count
+    QAtomicInt rate;
+    mutable QMutex stateMutex;
+    OdometryState current;
+
+};
+
+#endif // WHEELODOMETRY_H